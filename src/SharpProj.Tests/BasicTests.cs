@@ -3,6 +3,7 @@ using System.Collections.Generic;
 using System.Diagnostics;
 using System.IO;
 using System.Linq;
+using System.Runtime.CompilerServices;
 using Microsoft.VisualStudio.TestTools.UnitTesting;
 using SharpProj.Proj;
 using PJ = SharpProj.CoordinateTransform;
@@ -32,6 +33,20 @@ namespace SharpProj.Tests
             }
         }
 
+        [TestMethod]
+        [DataRow("Amersfoort"), DataRow("Überprüfung ✓ 𝔘nicode"), DataRow(null)]
+        public void Utf8Definitions(string name)
+        {
+            // Short names use the inline UTF-8 buffer, the long variant the heap fallback
+            name ??= string.Concat(Enumerable.Repeat("Ünïcødé ", 80));
+
+            using (var pc = new ProjContext())
+            using (var crs = pc.CreateFromWellKnownText($"GEOGCS[\"{name}\",DATUM[\"WGS_1984\",SPHEROID[\"WGS 84\",6378137,298.257223563]],PRIMEM[\"Greenwich\",0],UNIT[\"degree\",0.0174532925199433]]"))
+            {
+                Assert.AreEqual(name, crs.Name);
+            }
+        }
+
         [TestMethod]
         public void EpsgVersionTest()
         {
@@ -104,6 +119,63 @@ namespace SharpProj.Tests
         }
 
 
+        [TestMethod]
+        public void NativeMemoryBytes()
+        {
+            using (var pc = new ProjContext())
+            {
+                long initial = pc.NativeMemoryBytes;
+                long used;
+                Assert.IsTrue(initial > 0);
+
+                using (var crs = CoordinateReferenceSystem.CreateFromEpsg(28992, pc))
+                {
+                    // Database opened and an object allocated
+                    used = pc.NativeMemoryBytes;
+                    Assert.IsTrue(used > initial);
+                }
+
+                Assert.IsTrue(pc.NativeMemoryBytes < used);
+            }
+        }
+
+        [TestMethod]
+        [DoNotParallelize]
+        public void FinalizedObjectsFlushed()
+        {
+            using (var pc = new ProjContext())
+            {
+                CreateGarbage(pc);
+                long used = pc.NativeMemoryBytes;
+
+                GC.Collect();
+                GC.WaitForPendingFinalizers();
+
+                // Finalizers only queued the native handles
+                Assert.AreEqual(used, pc.NativeMemoryBytes);
+
+                pc.Flush();
+                Assert.IsTrue(pc.NativeMemoryBytes < used);
+            }
+
+            // Finalized after the context is disposed: destroyed on their own context, never on PROJ's default context
+            var disposed = new ProjContext();
+            CreateGarbage(disposed);
+            disposed.Dispose();
+
+            GC.Collect();
+            GC.WaitForPendingFinalizers();
+
+            Assert.AreEqual(0, ProjContext.DefaultContextDestroys);
+        }
+
+        [MethodImpl(MethodImplOptions.NoInlining)]
+        static void CreateGarbage(ProjContext pc)
+        {
+            for (int i = 0; i < 20; i++)
+                CoordinateReferenceSystem.CreateFromEpsg(28992, pc);
+        }
+
         [TestMethod]
         public void CreateAndDestroyContextEPSG()
         {
@@ -1105,5 +1177,451 @@ namespace SharpProj.Tests
 
             Console.WriteLine(cm.AsWellKnownText());
         }
+
+        [TestMethod]
+        [DoNotParallelize]
+        public void OperationCache()
+        {
+            string dir = Path.Combine(TestContext.TestResultsDirectory, "ops-" + Guid.NewGuid().ToString("N"));
+            var points = new[] { new PPoint(40, -100), new PPoint(52, -110), new PPoint(30, -85) };
+
+            ProjContext.OperationCacheDirectory = dir;
+            try
+            {
+                PPoint[] expected = null;
+                int[] suggested = null;
+                int count = 0;
+
+                for (int i = 0; i < 3; i++)
+                {
+                    // New contexts, as a new process would have
+                    using var pc = new ProjContext() { EnableNetworkConnections = false };
+
+                    // Another grid directory may provide grids that were missing
+                    if (i == 2)
+                        pc.AddSearchPath(Directory.CreateDirectory(Path.Combine(dir, "grids")).FullName);
+
+                    using var nad27 = CoordinateReferenceSystem.CreateFromEpsg(4267, pc);
+                    using var nad83 = CoordinateReferenceSystem.CreateFromEpsg(4269, pc);
+                    using var t = CoordinateTransform.Create(nad27, nad83);
+
+                    var r = points.Select(p => t.Apply(p)).ToArray();
+                    var back = r.Select(p => t.ApplyReversed(p)).ToArray();
+                    var stats = pc.NetworkStatistics;
+                    // The same operation must be picked for each point, with or without the cache
+                    var choice = points.Select(p => (t as ChooseCoordinateTransform)?.SuggestedOperation(p) ?? -1).ToArray();
+
+                    if (i == 0)
+                    {
+                        expected = r;
+                        suggested = choice;
+                        count = t.Options().Count;
+                        Assert.AreEqual(0L, stats.OperationCacheHits);
+                        Assert.AreEqual(1L, stats.OperationCacheMisses);
+                        Assert.AreEqual(1, Directory.GetFiles(dir, "*.ops", SearchOption.AllDirectories).Length);
+                    }
+                    else
+                    {
+                        if (i == 1)
+                        {
+                            Assert.AreEqual(1L, stats.OperationCacheHits, "Served from cache");
+                            Assert.AreEqual(0L, stats.OperationCacheMisses);
+                        }
+                        else
+                        {
+                            Assert.AreEqual(0L, stats.OperationCacheHits, "Grid directories changed");
+                            Assert.AreEqual(1L, stats.OperationCacheMisses);
+                            Assert.AreEqual(2, Directory.GetFiles(dir, "*.ops", SearchOption.AllDirectories).Length);
+                        }
+
+                        Assert.AreEqual(count, t.Options().Count, "Same operations");
+                        CollectionAssert.AreEqual(suggested, choice, "Same suggested operations");
+                        for (int j = 0; j < r.Length; j++)
+                        {
+                            Assert.AreEqual(expected[j].ToXY(7), r[j].ToXY(7));
+                            Assert.AreEqual(points[j].ToXY(5), back[j].ToXY(5));
+                        }
+                    }
+                }
+            }
+            finally
+            {
+                ProjContext.OperationCacheDirectory = null;
+            }
+        }
+
+        [TestMethod]
+        public void CreateTransformsBulk()
+        {
+            using var pc = new ProjContext() { EnableNetworkConnections = false };
+            var crss = new[] { 4326, 3857, 28992, 25831, 4258, 32631 }.Select(x => CoordinateReferenceSystem.CreateFromEpsg(x, pc)).ToArray();
+
+            var requests = (from s in crss from t in crss where s != t select new CoordinateTransformRequest(s, t)).ToList();
+            // Fails: ForceOver needs BestOnly
+            requests.Insert(3, new CoordinateTransformRequest(crss[0], crss[1], new CoordinateTransformOptions { ForceOver = true }));
+
+            var results = pc.CreateTransforms(requests);
+
+            Assert.AreEqual(requests.Count, results.Count);
+            for (int i = 0; i < results.Count; i++)
+            {
+                Assert.AreSame(requests[i], results[i].Request);
+
+                if (i == 3)
+                {
+                    Assert.IsFalse(results[i].Succeeded);
+                    Assert.IsInstanceOfType(results[i].Error, typeof(ArgumentOutOfRangeException));
+                    continue;
+                }
+
+                Assert.IsTrue(results[i].Succeeded, $"{requests[i].SourceCrs.Name} -> {requests[i].TargetCrs.Name}");
+
+                using var serial = CoordinateTransform.Create(requests[i].SourceCrs, requests[i].TargetCrs, pc);
+                Assert.AreEqual(serial.Options().Count, results[i].Transform.Options().Count);
+            }
+
+            // Resolved on worker contexts, returned on the caller's context
+            Assert.IsTrue(results.Where(x => x.Succeeded).All(x => x.Transform.Context == pc));
+
+            foreach (var r in results)
+                r.Transform?.Dispose();
+            foreach (var c in crss)
+                c.Dispose();
+        }
+
+        [TestMethod]
+        public void ThenComposition()
+        {
+            using var pc = new ProjContext() { EnableNetworkConnections = false };
+            using var wgs84 = CoordinateReferenceSystem.CreateFromEpsg(4326, pc);
+            using var webMercator = CoordinateReferenceSystem.CreateFromEpsg(3857, pc);
+            using var utm31 = CoordinateReferenceSystem.CreateFromEpsg(32631, pc);
+            using var rd = CoordinateReferenceSystem.CreateFromEpsg(28992, pc);
+
+            using var toWeb = CoordinateTransform.Create(wgs84, webMercator, pc);
+            using var fromWeb = CoordinateTransform.Create(webMercator, wgs84, pc);
+            using var webToUtm = CoordinateTransform.Create(webMercator, utm31, pc);
+
+            PPoint p = new PPoint(52.1, 5.1);
+
+            // Both plain operations: fused into one pipeline
+            using (var fused = toWeb.Then(webToUtm))
+            {
+                Assert.IsNotInstanceOfType(fused, typeof(ChainedCoordinateTransform));
+                PPoint expected = webToUtm.Apply(toWeb.Apply(p));
+                PPoint r = fused.Apply(p);
+                Assert.AreEqual(expected.X, r.X, 0.001);
+                Assert.AreEqual(expected.Y, r.Y, 0.001);
+            }
+
+            // All steps cancel each other
+            using (var roundTrip = toWeb.Then(fromWeb))
+            {
+                Assert.IsFalse(roundTrip.AsProjString().Contains("webmerc"), roundTrip.AsProjString());
+                Assert.IsFalse(roundTrip.AsProjString().Contains("axisswap"), roundTrip.AsProjString());
+                PPoint r = roundTrip.Apply(p);
+                Assert.AreEqual(p.X, r.X, 1e-9);
+                Assert.AreEqual(p.Y, r.Y, 1e-9);
+            }
+
+            // The next transform must start where this one ends
+            try
+            {
+                toWeb.Then(toWeb);
+                Assert.Fail("Should have thrown");
+            }
+            catch (ArgumentException)
+            { }
+
+            // A choose transform can't be fused: runs the stages block by block
+            using var rdToWgs84 = CoordinateTransform.Create(rd, wgs84, pc);
+            Assert.IsInstanceOfType(rdToWgs84, typeof(ChooseCoordinateTransform));
+
+            using var chain = rdToWgs84.Then(toWeb);
+            Assert.IsInstanceOfType(chain, typeof(ChainedCoordinateTransform));
+            Assert.AreEqual(2, chain.Steps().Count);
+
+            const int n = 1500; // More than one block
+            double[] xs = new double[n], ys = new double[n], ex = new double[n], ey = new double[n];
+            for (int i = 0; i < n; i++)
+            {
+                ex[i] = xs[i] = 100000 + i * 50;
+                ey[i] = ys[i] = 400000 + i * 30;
+            }
+
+            rdToWgs84.Apply(ex, ey);
+            toWeb.Apply(ex, ey);
+            chain.Apply(xs, ys);
+
+            for (int i = 0; i < n; i++)
+            {
+                Assert.AreEqual(ex[i], xs[i], 0.001);
+                Assert.AreEqual(ey[i], ys[i], 0.001);
+            }
+
+            PPoint back = chain.ApplyReversed(chain.Apply(new PPoint(155000, 463000)));
+            Assert.AreEqual(155000, back.X, 0.01);
+            Assert.AreEqual(463000, back.Y, 0.01);
+        }
+
+        [TestMethod]
+        public void MultiTarget()
+        {
+            using var pc = new ProjContext() { EnableNetworkConnections = false };
+            using var wgs84 = CoordinateReferenceSystem.CreateFromEpsg(4326, pc);
+            var targets = new[] { 3857, 32631, 32632, 3395 }.Select(x => CoordinateReferenceSystem.CreateFromEpsg(x, pc)).ToArray();
+
+            using var multi = MultiTargetTransform.Create(wgs84, targets, ctx: pc);
+            Assert.AreEqual(targets.Length, multi.Count);
+            Assert.IsTrue(multi.SharedStepCount >= 2, "Axis swap and unit conversion are shared");
+
+            const int n = 1200;
+            double[,] points = new double[n, 2];
+            for (int i = 0; i < n; i++)
+            {
+                points[i, 0] = 50 + i * 0.005;
+                points[i, 1] = 3 + i * 0.004;
+            }
+
+            var results = multi.Apply(points);
+            Assert.AreEqual(targets.Length, results.Length);
+
+            for (int t = 0; t < targets.Length; t++)
+            {
+                double[,] expected = (double[,])points.Clone();
+                multi[t].Apply(expected);
+
+                for (int i = 0; i < n; i++)
+                {
+                    Assert.AreEqual(expected[i, 0], results[t][i, 0], 0.001);
+                    Assert.AreEqual(expected[i, 1], results[t][i, 1], 0.001);
+                }
+            }
+
+            PPoint[] single = multi.Apply(new PPoint(52, 5));
+            for (int t = 0; t < targets.Length; t++)
+            {
+                PPoint expected = multi[t].Apply(new PPoint(52, 5));
+                Assert.AreEqual(expected.X, single[t].X, 0.001);
+                Assert.AreEqual(expected.Y, single[t].Y, 0.001);
+            }
+
+            try
+            {
+                multi.Apply(new PPoint(100, 5)); // Latitude out of range
+                Assert.Fail("Should have thrown");
+            }
+            catch (ProjException)
+            { }
+
+            foreach (var c in targets)
+                c.Dispose();
+        }
+
+        [TestMethod]
+        public void FastPathAffine()
+        {
+            using var pc = new ProjContext() { EnableNetworkConnections = false };
+            string[] definitions =
+            {
+                "+proj=helmert +x=-81.07 +y=-89.36 +z=-115.75 +rx=0.485 +ry=0.024 +rz=0.413 +s=-0.54 +convention=position_vector",
+                "+proj=helmert +x=565.2369 +y=50.0087 +z=465.658 +rx=1.9725 +ry=-1.7004 +rz=9.0677 +s=4.0812 +convention=coordinate_frame +exact",
+                "+proj=pipeline +step +proj=axisswap +order=2,-1 +step +proj=unitconvert +xy_in=us-ft +xy_out=m +z_in=ft +z_out=km +step +inv +proj=helmert +x=1 +y=2 +z=3",
+                "+proj=affine +xoff=100 +yoff=-50 +zoff=3 +s11=0.9 +s12=0.1 +s21=-0.2 +s22=1.1 +s33=1.5",
+            };
+
+            const int n = 100000;
+            var rnd = new Random(42);
+            double[] xs = new double[n], ys = new double[n], zs = new double[n];
+            for (int i = 0; i < n; i++)
+            {
+                xs[i] = 3900000 + rnd.NextDouble() * 100000;
+                ys[i] = 300000 + rnd.NextDouble() * 100000;
+                zs[i] = 5000000 + rnd.NextDouble() * 100000;
+            }
+            xs[7] = double.PositiveInfinity; // HUGE_VAL: failed coordinate
+
+            foreach (string def in definitions)
+            {
+                using var t = CoordinateTransform.Create(def, pc);
+                Assert.IsTrue(t.UsesFastPath, def);
+
+                foreach (bool forward in new[] { true, false })
+                {
+                    double[][] fast = { (double[])xs.Clone(), (double[])ys.Clone(), (double[])zs.Clone() };
+                    double[][] proj = { (double[])xs.Clone(), (double[])ys.Clone(), (double[])zs.Clone() };
+
+                    t.EnableFastPaths = false;
+                    var sw = Stopwatch.StartNew();
+                    if (forward) t.Apply(proj); else t.ApplyReversed(proj);
+                    TimeSpan projTime = sw.Elapsed;
+
+                    t.EnableFastPaths = true;
+                    sw.Restart();
+                    if (forward) t.Apply(fast); else t.ApplyReversed(fast);
+                    TimeSpan fastTime = sw.Elapsed;
+
+                    Console.WriteLine($"{def} ({(forward ? "fwd" : "inv")}): PROJ {projTime.TotalMilliseconds:F1} ms, fast path {fastTime.TotalMilliseconds:F1} ms for {n} points");
+
+                    for (int d = 0; d < 3; d++)
+                    {
+                        for (int i = 0; i < n; i++)
+                        {
+                            if (double.IsInfinity(proj[d][i]))
+                                Assert.IsTrue(double.IsInfinity(fast[d][i]), $"Infinity at {d}, {i}");
+                            else
+                                Assert.AreEqual(proj[d][i], fast[d][i], 1e-6, $"{def}: ordinate {d} of point {i}");
+                        }
+                    }
+                }
+            }
+        }
+
+        [TestMethod]
+        public void FastPathProjections()
+        {
+            using var pc = new ProjContext() { EnableNetworkConnections = false };
+
+            // Other Transverse Mercator algorithms are left to PROJ
+            foreach (string algo in new[] { "evenden_snyder", "auto" })
+            {
+                using var t = CoordinateTransform.Create($"+proj=tmerc +lon_0=3 +ellps=GRS80 +algo={algo}", pc);
+                Assert.IsFalse(t.UsesFastPath, algo);
+            }
+
+            // Web Mercator, UTM north and south and a Transverse Mercator with a false northing
+            foreach (int epsg in new[] { 3857, 32631, 32733, 2193 })
+            {
+                using var crs = CoordinateReferenceSystem.CreateFromEpsg(epsg, pc);
+                using var t = CoordinateTransform.Create(crs.BaseCRS, crs, pc);
+                Assert.IsTrue(t.UsesFastPath, $"EPSG:{epsg}");
+                var area = crs.UsageArea;
+
+                // A grid over the whole usage area, in the latitude, longitude order of the base CRS
+                const int steps = 400;
+                const int n = steps * steps;
+                double[] lat = new double[n], lon = new double[n];
+                for (int i = 0; i < steps; i++)
+                {
+                    for (int j = 0; j < steps; j++)
+                    {
+                        lat[i * steps + j] = area.SouthLatitude + (area.NorthLatitude - area.SouthLatitude) * i / (steps - 1);
+                        lon[i * steps + j] = area.WestLongitude + (area.EastLongitude - area.WestLongitude) * j / (steps - 1);
+                    }
+                }
+
+                foreach (bool forward in new[] { true, false })
+                {
+                    double[][] input = { lat, lon };
+                    if (!forward)
+                    {
+                        // Start from the projected coordinates PROJ calculates
+                        input = new[] { (double[])lat.Clone(), (double[])lon.Clone() };
+                        t.EnableFastPaths = false;
+                        t.Apply(input);
+                    }
+
+                    double[][] fast = { (double[])input[0].Clone(), (double[])input[1].Clone() };
+                    double[][] proj = { (double[])input[0].Clone(), (double[])input[1].Clone() };
+
+                    t.EnableFastPaths = false;
+                    var sw = Stopwatch.StartNew();
+                    if (forward) t.Apply(proj); else t.ApplyReversed(proj);
+                    TimeSpan projTime = sw.Elapsed;
+
+                    t.EnableFastPaths = true;
+                    sw.Restart();
+                    if (forward) t.Apply(fast); else t.ApplyReversed(fast);
+                    TimeSpan fastTime = sw.Elapsed;
+
+                    Console.WriteLine($"EPSG:{epsg} ({(forward ? "fwd" : "inv")}): PROJ {projTime.TotalMilliseconds:F1} ms, fast path {fastTime.TotalMilliseconds:F1} ms for {n} points");
+
+                    // Sub-millimeter: 0.1 mm, or about 0.01 mm in degrees
+                    double tolerance = forward ? 1e-4 : 1e-10;
+                    for (int d = 0; d < 2; d++)
+                    {
+                        for (int i = 0; i < n; i++)
+                        {
+                            if (double.IsInfinity(proj[d][i]))
+                                Assert.IsTrue(double.IsInfinity(fast[d][i]), $"Infinity at {d}, {i}");
+                            else
+                                Assert.AreEqual(proj[d][i], fast[d][i], tolerance, $"EPSG:{epsg}: ordinate {d} of point {i}");
+                        }
+                    }
+                }
+            }
+        }
+
+        [TestMethod]
+        public void ApplyByEpoch()
+        {
+            using var pc = new ProjContext() { EnableNetworkConnections = false };
+            using var t = CoordinateTransform.Create("+proj=helmert +x=0.0127 +y=0.0065 +z=-0.0209 +s=0.00195 +rx=-0.00039 +ry=0.0008 +rz=-0.00114 "
+                                                     + "+dx=-0.0029 +dy=-0.0002 +dz=-0.0006 +ds=0.0001 +drx=-0.00011 +dry=-0.00019 +drz=0.00007 "
+                                                     + "+t_epoch=1988.0 +convention=coordinate_frame", pc);
+
+            const int n = 10000;
+            var rnd = new Random(12);
+            double[] epochs = { 2000, 2005.5, 2010, 2015.25, 2020 };
+            double[] xs = new double[n], ys = new double[n], zs = new double[n], ts = new double[n];
+            for (int i = 0; i < n; i++)
+            {
+                xs[i] = 3900000 + rnd.NextDouble() * 100000;
+                ys[i] = 300000 + rnd.NextDouble() * 100000;
+                zs[i] = 5000000 + rnd.NextDouble() * 100000;
+                ts[i] = epochs[rnd.Next(epochs.Length)];
+            }
+
+            foreach (bool forward in new[] { true, false })
+            {
+                double[][] grouped = { (double[])xs.Clone(), (double[])ys.Clone(), (double[])zs.Clone(), (double[])ts.Clone() };
+                double[][] perPoint = { (double[])xs.Clone(), (double[])ys.Clone(), (double[])zs.Clone(), (double[])ts.Clone() };
+
+                if (forward)
+                {
+                    t.ApplyByEpoch(grouped);
+                    t.Apply(perPoint);
+                }
+                else
+                {
+                    t.ApplyReversedByEpoch(grouped);
+                    t.ApplyReversed(perPoint);
+                }
+
+                for (int d = 0; d < 4; d++)
+                {
+                    for (int i = 0; i < n; i++)
+                        Assert.AreEqual(perPoint[d][i], grouped[d][i], 1e-9, $"ordinate {d} of point {i}");
+                }
+            }
+
+            // A dataset tagged with a single epoch
+            using var itrf2014 = CoordinateReferenceSystem.CreateFromEpsg(7789, pc);
+            using var metadata = itrf2014.CreateMetadata(2020);
+            double[][] tagged = { (double[])xs.Clone(), (double[])ys.Clone(), (double[])zs.Clone() };
+            double[][] expected = { (double[])xs.Clone(), (double[])ys.Clone(), (double[])zs.Clone(), Enumerable.Repeat(2020.0, n).ToArray() };
+
+            t.Apply(metadata, tagged);
+            t.Apply(expected);
+
+            for (int d = 0; d < 3; d++)
+            {
+                for (int i = 0; i < n; i++)
+                    Assert.AreEqual(expected[d][i], tagged[d][i], 1e-9, $"ordinate {d} of point {i}");
+            }
+
+            // The metadata must describe the crs the coordinates are in
+            using var itrf2008 = CoordinateReferenceSystem.CreateFromEpsg(5332, pc);
+            using var between = CoordinateTransform.Create(itrf2014, itrf2008, pc);
+
+            between.Apply(metadata, new[] { xs[0] }, new[] { ys[0] }, new[] { zs[0] });
+            try
+            {
+                between.ApplyReversed(metadata, new[] { xs[0] }, new[] { ys[0] }, new[] { zs[0] });
+                Assert.Fail("Should have thrown");
+            }
+            catch (ArgumentException)
+            { }
+        }
     }
 }
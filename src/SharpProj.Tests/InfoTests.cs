@@ -184,5 +184,81 @@ namespace SharpProj.Tests
             using var ob = CoordinateTransform.CreateFromDatabase(item1);
             Assert.IsNotNull(ob);
         }
+
+        [TestMethod]
+        public void CrsCatalog()
+        {
+            using var pc = new ProjContext() { EnableNetworkConnections = false };
+            var catalog = pc.GetCrsCatalog();
+
+            using (var pc2 = new ProjContext() { EnableNetworkConnections = false })
+                Assert.AreSame(catalog, pc2.GetCrsCatalog(), "Shared per database");
+
+            var all = pc.GetCoordinateReferenceSystems(new CoordinateReferenceSystemFilter { AllowDeprecated = true });
+            Assert.AreEqual(all.Count, catalog.Count);
+            Assert.AreEqual(all[0].Identifier, catalog[0].Identifier);
+            Assert.AreEqual(all[all.Count - 1].Identifier, catalog[catalog.Count - 1].Identifier);
+
+            var rd = catalog.Find("EPSG", "28992");
+            Assert.IsNotNull(rd);
+            Assert.AreEqual("Amersfoort / RD New", rd.Name);
+            Assert.IsNull(catalog.Find("EPSG", "-1"));
+
+            // Amsterdam
+            var here = catalog.FindAt(4.89, 52.37);
+            Assert.IsTrue(here.Contains(rd));
+            Assert.IsTrue(here.Any(x => x.Code == "32631"), "UTM zone 31N");
+            Assert.IsFalse(here.Any(x => x.Code == "32632"), "UTM zone 32N");
+
+            // Same as a scan over all items
+            List<Identifier> Scan(double lon, double lat) => all.Where(x => !x.IsDeprecated && x.BoundingBox != null
+                                       && x.BoundingBox.SouthLatitude <= lat && x.BoundingBox.NorthLatitude >= lat
+                                       && (x.BoundingBox.WestLongitude <= x.BoundingBox.EastLongitude
+                                            ? (x.BoundingBox.WestLongitude <= lon && x.BoundingBox.EastLongitude >= lon)
+                                            : (x.BoundingBox.WestLongitude <= lon || x.BoundingBox.EastLongitude >= lon)))
+                               .Select(x => x.Identifier).ToList();
+
+            CollectionAssert.AreEqual(Scan(4.89, 52.37), here.Select(x => x.Identifier).ToList());
+
+            // Crossing the antimeridian
+            var pacific = catalog.FindAt(-170, 0);
+            Assert.IsTrue(pacific.Any(x => x.Code == "3832"), "PDC Mercator");
+            CollectionAssert.AreEqual(Scan(-170, 0), pacific.Select(x => x.Identifier).ToList());
+
+            Assert.IsTrue(catalog.FindContaining(new ProjArea(4, 51, 5, 52)).Contains(rd));
+            Assert.IsFalse(catalog.FindContaining(new ProjArea(4, 51, 10, 52)).Contains(rd));
+            Assert.IsTrue(catalog.FindIntersecting(new ProjArea(6, 53, 10, 54)).Contains(rd));
+
+            var byName = catalog.FindByName("rd new");
+            Assert.IsTrue(byName.Contains(rd));
+            Assert.IsTrue(byName.All(x => x.Name.IndexOf("rd new", StringComparison.OrdinalIgnoreCase) >= 0));
+            Assert.IsTrue(catalog.FindByName("Amersfoort").First().Name.StartsWith("Amersfoort"));
+            Assert.AreEqual(3, catalog.FindByName("WGS", 3).Count);
+        }
+
+        [TestMethod]
+        public void IdentifyPrj()
+        {
+            // ESRI WKT, as found in shapefile .prj files
+            const string rdNew = "PROJCS[\"RD_New\",GEOGCS[\"GCS_Amersfoort\",DATUM[\"D_Amersfoort\",SPHEROID[\"Bessel_1841\",6377397.155,299.1528128]],PRIMEM[\"Greenwich\",0.0],UNIT[\"Degree\",0.0174532925199433]],"
+                + "PROJECTION[\"Double_Stereographic\"],PARAMETER[\"False_Easting\",155000.0],PARAMETER[\"False_Northing\",463000.0],PARAMETER[\"Central_Meridian\",5.38763888888889],"
+                + "PARAMETER[\"Scale_Factor\",0.9999079],PARAMETER[\"Latitude_Of_Origin\",52.15616055555555],UNIT[\"Meter\",1.0]]";
+            const string wgs84 = "GEOGCS[\"GCS_WGS_1984\",DATUM[\"D_WGS_1984\",SPHEROID[\"WGS_1984\",6378137.0,298.257223563]],PRIMEM[\"Greenwich\",0.0],UNIT[\"Degree\",0.0174532925199433]]";
+
+            using var pc = new ProjContext() { EnableNetworkConnections = false };
+
+            Assert.AreEqual(new Identifier("EPSG", "28992"), pc.Identify(rdNew, "EPSG"));
+
+            var r = pc.Identify(new[] { wgs84, rdNew, rdNew.Replace(",", ", ") + "\r\n", wgs84, "GEOGCS[\"Nothing\"]", wgs84, rdNew }, "EPSG");
+
+            Assert.AreEqual(7, r.Count);
+            Assert.AreEqual(new Identifier("EPSG", "4326"), r[0]);
+            Assert.AreEqual(new Identifier("EPSG", "28992"), r[1]);
+            Assert.AreEqual(r[1], r[2]);
+            Assert.AreEqual(r[0], r[3]);
+            Assert.IsNull(r[4]);
+            Assert.AreEqual(r[0], r[5]);
+            Assert.AreEqual(r[1], r[6]);
+        }
     }
 }
@@ -26,5 +26,37 @@ namespace SharpProj.Tests
                 Assert.IsInstanceOfType(p, typeof(CoordinateTransform));
             }
         }
+
+        [TestMethod]
+        [DoNotParallelize]
+        public void FileCacheAcrossContexts()
+        {
+            // Later lookups are served from the process wide file cache, until it is cleared. The first context may
+            // copy ITRF2000 to the user directory, which makes the watchers clear the cache once, so allow two tries
+            long hits = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                using (var pc = new ProjContext())
+                {
+                    using (var p = pc.Create("+init=ITRF2000:ITRF2005 +t_obs=2010.5"))
+                    {
+                        Assert.IsInstanceOfType(p, typeof(CoordinateTransform));
+                    }
+
+                    var stats = pc.NetworkStatistics;
+
+                    if (i == 1 || i == 2)
+                        hits += stats.FileCacheHits;
+                    else if (i == 3)
+                    {
+                        Assert.IsTrue(hits > 0, "Found by an earlier context");
+                        Assert.IsTrue(stats.FileCacheMisses > 0, "Searched again after clearing");
+                    }
+                }
+
+                if (i == 2)
+                    ProjContext.ClearFileCache();
+            }
+        }
     }
 }
@@ -0,0 +1,459 @@
+using System;
+using System.Diagnostics;
+using System.IO;
+using System.Linq;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using SharpProj.Proj;
+
+namespace SharpProj.Tests
+{
+    [TestClass]
+    public class NetworkTests
+    {
+        public TestContext TestContext { get; set; }
+
+        static readonly PPoint[] NLPoints =
+        {
+            new PPoint(51, 4),
+            new PPoint(52.37, 4.89),
+            new PPoint(53.2, 6.56),
+            new PPoint(50.85, 5.69),
+            new PPoint(52.09, 5.12),
+        };
+
+        ProjContext CreateContext(RangeServer server, string cacheFile = null, bool gridCache = true)
+        {
+            var pc = new ProjContext();
+            // Private cache, to make sure we use the network
+            pc.SetGridCache(gridCache, cacheFile ?? Path.Combine(TestContext.TestResultsDirectory, Guid.NewGuid().ToString("N") + ".cache"), 300, 3600);
+            pc.EnableNetworkConnections = true;
+            pc.EndpointUrl = server.Url;
+            return pc;
+        }
+
+        [TestMethod]
+        [TestCategory("NeedsNetwork")]
+        [DataRow(0), DataRow(25)]
+        public void GridViaLocalServer(int latencyMs)
+        {
+            using (var server = new RangeServer { Latency = TimeSpan.FromMilliseconds(latencyMs) })
+            using (var pc = CreateContext(server))
+            using (var crsAmersfoort = CoordinateReferenceSystem.CreateFromEpsg(4289, pc))
+            using (var crsETRS89 = CoordinateReferenceSystem.CreateFromEpsg(4258, pc))
+            using (var t = CoordinateTransform.Create(crsAmersfoort, crsETRS89))
+            {
+                var sw = Stopwatch.StartNew();
+
+                Assert.AreEqual(new PPoint(50.999, 4.0), t.Apply(NLPoints[0]).ToXY(3));
+
+                foreach (var p in NLPoints)
+                    t.Apply(p);
+
+                TestContext.WriteLine($"Latency {latencyMs} ms: {server.RequestCount} requests, {server.BytesServed} bytes in {sw.Elapsed}");
+                Assert.IsTrue(server.RequestCount > 0, "Used local server");
+            }
+        }
+
+        [TestMethod]
+        [TestCategory("NeedsNetwork")]
+        [DoNotParallelize]
+        public void ReadAheadCoalescesRequests()
+        {
+            int blockSize = ProjContext.NetworkBlockSize;
+            long cacheSize = ProjContext.NetworkBlockCacheSize;
+
+            try
+            {
+                int[] requests = new int[2];
+
+                for (int i = 0; i < requests.Length; i++)
+                {
+                    // First pass reads just the chunks PROJ asks for
+                    ProjContext.NetworkBlockSize = i == 0 ? 16 * 1024 : blockSize;
+                    ProjContext.NetworkBlockCacheSize = i == 0 ? 0 : cacheSize;
+
+                    using (var server = new RangeServer { Latency = TimeSpan.FromMilliseconds(10) })
+                    using (var pc = CreateContext(server))
+                    using (var crsAmersfoort = CoordinateReferenceSystem.CreateFromEpsg(4289, pc))
+                    using (var crsETRS89 = CoordinateReferenceSystem.CreateFromEpsg(4258, pc))
+                    using (var t = CoordinateTransform.Create(crsAmersfoort, crsETRS89))
+                    {
+                        var sw = Stopwatch.StartNew();
+
+                        foreach (var p in NLPoints)
+                            t.Apply(p);
+
+                        requests[i] = server.RequestCount;
+                        TestContext.WriteLine($"Block size {ProjContext.NetworkBlockSize}, cache {ProjContext.NetworkBlockCacheSize}: {server.RequestCount} requests, {server.BytesServed} bytes in {sw.Elapsed}");
+                    }
+                }
+
+                Assert.IsTrue(requests[1] > 0);
+                Assert.IsTrue(requests[1] <= requests[0], "Read-ahead should not need more requests");
+            }
+            finally
+            {
+                ProjContext.NetworkBlockSize = blockSize;
+                ProjContext.NetworkBlockCacheSize = cacheSize;
+            }
+        }
+
+        [TestMethod]
+        [TestCategory("NeedsNetwork")]
+        public void PrefetchGrids()
+        {
+            string cacheFile = Path.Combine(TestContext.TestResultsDirectory, Guid.NewGuid().ToString("N") + ".cache");
+
+            using (var server = new RangeServer { Latency = TimeSpan.FromMilliseconds(10) })
+            {
+                using (var pc = CreateContext(server, cacheFile))
+                using (var crsAmersfoort = CoordinateReferenceSystem.CreateFromEpsg(4289, pc))
+                using (var crsETRS89 = CoordinateReferenceSystem.CreateFromEpsg(4258, pc))
+                using (var t = CoordinateTransform.Create(crsAmersfoort, crsETRS89))
+                {
+                    var sw = Stopwatch.StartNew();
+                    t.PrefetchGrids(new ProjArea(3.2, 50.7, 7.3, 53.6));
+
+                    TestContext.WriteLine($"Prefetch: {server.RequestCount} requests, {server.BytesServed} bytes in {sw.Elapsed}");
+                    Assert.IsTrue(server.RequestCount > 0, "Prefetched");
+
+                    // The options were only inspected, on clones
+                    if (t is ChooseCoordinateTransform choose)
+                        Assert.IsFalse(Enumerable.Range(0, choose.Count).Any(choose.IsInstantiated));
+                }
+
+                server.ResetCounters();
+
+                using (var pc = CreateContext(server, cacheFile))
+                using (var crsAmersfoort = CoordinateReferenceSystem.CreateFromEpsg(4289, pc))
+                using (var crsETRS89 = CoordinateReferenceSystem.CreateFromEpsg(4258, pc))
+                using (var t = CoordinateTransform.Create(crsAmersfoort, crsETRS89))
+                {
+                    Assert.AreEqual(new PPoint(50.999, 4.0), t.Apply(NLPoints[0]).ToXY(3));
+
+                    foreach (var p in NLPoints)
+                        t.Apply(p);
+
+                    TestContext.WriteLine($"After prefetch: {server.RequestCount} requests, {server.BytesServed} bytes");
+                    Assert.IsTrue(server.RequestCount <= 1, "Grid data served from the cache");
+                }
+            }
+        }
+
+        [TestMethod]
+        [TestCategory("NeedsNetwork")]
+        public void GridBundleOffline()
+        {
+            string dir = Path.Combine(TestContext.TestResultsDirectory, "bundle-" + Guid.NewGuid().ToString("N"));
+
+            using (var server = new RangeServer())
+            using (var pc = CreateContext(server))
+            using (var crsAmersfoort = CoordinateReferenceSystem.CreateFromEpsg(4289, pc))
+            using (var crsETRS89 = CoordinateReferenceSystem.CreateFromEpsg(4258, pc))
+            {
+                var builder = new GridBundleBuilder(new ProjArea(3.2, 50.7, 7.3, 53.6), pc);
+                builder.Add(crsAmersfoort, crsETRS89);
+
+                var bundle = builder.Build(dir);
+
+                Assert.IsTrue(bundle.Files.Contains("nl_nsgi_rdtrans2018.tif"), "Has RDNAPTRANS grid");
+                Assert.IsTrue(File.Exists(Path.Combine(dir, GridBundle.ManifestName)));
+            }
+
+            var opened = GridBundle.Open(dir);
+            Assert.IsTrue(opened.Verify(), "Checksums match");
+
+            using (var pc = new ProjContext())
+            {
+                pc.EnableNetworkConnections = false;
+                opened.Mount(pc);
+
+                using (var crsAmersfoort = CoordinateReferenceSystem.CreateFromEpsg(4289, pc))
+                using (var crsETRS89 = CoordinateReferenceSystem.CreateFromEpsg(4258, pc))
+                using (var t = CoordinateTransform.Create(crsAmersfoort, crsETRS89))
+                {
+                    Assert.AreEqual(new PPoint(50.999, 4.0), t.Apply(NLPoints[0]).ToXY(3));
+                }
+
+                // Clones keep the bundle directory
+                using (var clone = pc.Clone())
+                    Assert.AreEqual(pc.GetGridSearchKey(), clone.GetGridSearchKey());
+            }
+        }
+
+        [TestMethod]
+        [TestCategory("NeedsNetwork")]
+        [DoNotParallelize]
+        public void DirectRead()
+        {
+            long cacheSize = ProjContext.NetworkBlockCacheSize;
+
+            try
+            {
+                // Direct reads, and a block cache too small to hold the grid, so evicted blocks are reused
+                foreach (long size in new[] { 0, 2 * ProjContext.NetworkBlockSize })
+                {
+                    ProjContext.NetworkBlockCacheSize = size;
+
+                    using (var server = new RangeServer())
+                    using (var pc = CreateContext(server))
+                    using (var crsAmersfoort = CoordinateReferenceSystem.CreateFromEpsg(4289, pc))
+                    using (var crsETRS89 = CoordinateReferenceSystem.CreateFromEpsg(4258, pc))
+                    using (var t = CoordinateTransform.Create(crsAmersfoort, crsETRS89))
+                    {
+                        var sw = Stopwatch.StartNew();
+#if NET
+                        long allocated = GC.GetAllocatedBytesForCurrentThread();
+#endif
+                        Assert.AreEqual(new PPoint(50.999, 4.0), t.Apply(NLPoints[0]).ToXY(3));
+
+                        foreach (var p in NLPoints)
+                            t.Apply(p);
+
+#if NET
+                        allocated = GC.GetAllocatedBytesForCurrentThread() - allocated;
+                        TestContext.WriteLine($"Block cache {size}: {server.BytesServed} bytes served, {allocated} bytes allocated in {sw.Elapsed}");
+                        Assert.IsTrue(allocated < server.BytesServed, $"Block cache {size}: {allocated} bytes allocated for {server.BytesServed} bytes served");
+#else
+                        TestContext.WriteLine($"Block cache {size}: {server.BytesServed} bytes served in {sw.Elapsed}");
+#endif
+                    }
+                }
+            }
+            finally
+            {
+                ProjContext.NetworkBlockCacheSize = cacheSize;
+            }
+        }
+
+        [TestMethod]
+        [TestCategory("NeedsNetwork")]
+        [DoNotParallelize]
+        public void ConcurrentFetch()
+        {
+            int maxConnections = ProjContext.NetworkMaxConnectionsPerServer;
+
+            try
+            {
+                foreach (int connections in new[] { 1, maxConnections })
+                {
+                    ProjContext.NetworkMaxConnectionsPerServer = connections;
+
+                    using (var server = new RangeServer { Latency = TimeSpan.FromMilliseconds(50) })
+                    using (var pc = CreateContext(server))
+                    using (var crsAmersfoort = CoordinateReferenceSystem.CreateFromEpsg(4289, pc))
+                    using (var crsETRS89 = CoordinateReferenceSystem.CreateFromEpsg(4258, pc))
+                    using (var t = CoordinateTransform.Create(crsAmersfoort, crsETRS89))
+                    {
+                        var sw = Stopwatch.StartNew();
+                        t.PrefetchGrids(new ProjArea(3.2, 50.7, 7.3, 53.6));
+
+                        Assert.AreEqual(new PPoint(50.999, 4.0), t.Apply(NLPoints[0]).ToXY(3));
+
+                        TestContext.WriteLine($"{connections} connections: {server.RequestCount} requests, {server.BytesServed} bytes in {sw.Elapsed}");
+                    }
+                }
+            }
+            finally
+            {
+                ProjContext.NetworkMaxConnectionsPerServer = maxConnections;
+            }
+        }
+
+        [TestMethod]
+        [TestCategory("NeedsNetwork")]
+        [DoNotParallelize]
+        public void ConcurrentRuns()
+        {
+            const string file = "/us_nga_egm96_15.tif";
+            int maxConnections = ProjContext.NetworkMaxConnectionsPerServer;
+
+            try
+            {
+                ProjContext.NetworkMaxConnectionsPerServer = 4;
+
+                using (var server = new RangeServer { Latency = TimeSpan.FromMilliseconds(50) })
+                using (var pc = CreateContext(server))
+                using (var http = new System.Net.Http.HttpClient())
+                {
+                    byte[] expected = http.GetByteArrayAsync(server.Url + file).Result;
+                    int blockSize = ProjContext.NetworkBlockSize;
+                    int size = 1024 * 1024; // Four runs of 256 KB
+
+                    if (expected.Length < blockSize + size)
+                        Assert.Inconclusive($"{file} is too small");
+
+                    // Learns the file length, so the next read can be split
+                    pc.ReadNetworkRange(server.Url + file, 0, 16);
+                    server.ResetCounters();
+
+                    var sw = Stopwatch.StartNew();
+                    byte[] data = pc.ReadNetworkRange(server.Url + file, blockSize, size);
+
+                    TestContext.WriteLine($"{server.RequestCount} requests, at most {server.PeakConcurrency} at once, in {sw.Elapsed}");
+                    Assert.IsTrue(server.RequestCount >= 4, "Split in runs");
+                    Assert.IsTrue(server.PeakConcurrency >= 2, "Runs overlapped");
+                    Assert.IsTrue(sw.Elapsed < TimeSpan.FromMilliseconds(50 * server.RequestCount), "Faster than one run after another");
+                    CollectionAssert.AreEqual(expected.Skip(blockSize).Take(size).ToArray(), data, "Bytes in order");
+                }
+            }
+            finally
+            {
+                ProjContext.NetworkMaxConnectionsPerServer = maxConnections;
+            }
+        }
+
+        [TestMethod]
+        [TestCategory("NeedsNetwork")]
+        public void NetworkStatistics()
+        {
+            using (var server = new RangeServer { Latency = TimeSpan.FromMilliseconds(10) })
+            using (var pc = CreateContext(server))
+            using (var crsAmersfoort = CoordinateReferenceSystem.CreateFromEpsg(4289, pc))
+            using (var crsETRS89 = CoordinateReferenceSystem.CreateFromEpsg(4258, pc))
+            using (var t = CoordinateTransform.Create(crsAmersfoort, crsETRS89))
+            {
+                foreach (var p in NLPoints)
+                    t.Apply(p);
+
+                var stats = pc.NetworkStatistics;
+
+                TestContext.WriteLine($"Requests: {stats.Requests}, bytes: {stats.BytesDownloaded}, block hits/misses: {stats.BlockCacheHits}/{stats.BlockCacheMisses}");
+                TestContext.WriteLine($"File cache hits/misses: {stats.FileCacheHits}/{stats.FileCacheMisses}, retries: {stats.Retries}, failures: {stats.Failures}");
+                TestContext.WriteLine($"Latency: average {stats.AverageLatency}, p99 {stats.P99Latency}");
+
+                Assert.AreEqual(server.RequestCount, stats.Requests);
+                Assert.AreEqual(server.BytesServed, stats.BytesDownloaded);
+                Assert.IsTrue(stats.AverageLatency >= TimeSpan.FromMilliseconds(10));
+                Assert.IsTrue(stats.P99Latency >= stats.AverageLatency || stats.Requests < 2);
+                Assert.IsTrue(ProjContext.GlobalNetworkStatistics.Requests >= stats.Requests);
+            }
+        }
+
+        [TestMethod]
+        [TestCategory("NeedsNetwork")]
+        [DoNotParallelize]
+        public void SharedBlockCache()
+        {
+            using (var server = new RangeServer { Latency = TimeSpan.FromMilliseconds(10) })
+            {
+                for (int i = 0; i < 2; i++)
+                {
+                    server.ResetCounters();
+
+                    // Separate context and private grid cache, so only the process wide block cache can help
+                    using (var pc = CreateContext(server))
+                    using (var crsAmersfoort = CoordinateReferenceSystem.CreateFromEpsg(4289, pc))
+                    using (var crsETRS89 = CoordinateReferenceSystem.CreateFromEpsg(4258, pc))
+                    using (var t = CoordinateTransform.Create(crsAmersfoort, crsETRS89))
+                    {
+                        foreach (var p in NLPoints)
+                            t.Apply(p);
+
+                        var stats = pc.NetworkStatistics;
+                        TestContext.WriteLine($"Context {i}: {server.RequestCount} requests, block hits/misses: {stats.BlockCacheHits}/{stats.BlockCacheMisses}");
+
+                        if (i == 0)
+                            Assert.IsTrue(server.RequestCount > 0, "Used local server");
+                        else
+                        {
+                            Assert.AreEqual(0, server.RequestCount, "Second context served from memory");
+                            Assert.IsTrue(stats.BlockCacheHits > 0);
+                        }
+                    }
+                }
+            }
+        }
+
+        [TestMethod]
+        [TestCategory("NeedsNetwork")]
+        public void GeoidModelSampling()
+        {
+            using var server = new RangeServer();
+            using var pc = CreateContext(server);
+            using var geoid = GeoidModel.Open("nl_nsgi_nlgeo2018.tif", pc);
+            using var t = CoordinateTransform.Create("+proj=pipeline +step +proj=unitconvert +xy_in=deg +xy_out=rad +step +proj=vgridshift +grids=nl_nsgi_nlgeo2018.tif +multiplier=1", pc);
+
+            // More than one chunk, to sample on multiple threads
+            const int n = 50000;
+            var rnd = new Random(7);
+            double[] lon = new double[n], lat = new double[n];
+            for (int i = 0; i < n; i++)
+            {
+                lon[i] = 3.5 + rnd.NextDouble() * 3.5;
+                lat[i] = 50.8 + rnd.NextDouble() * 2.7;
+            }
+
+            var sw = Stopwatch.StartNew();
+            double[] undulations = geoid.Sample(lon, lat);
+            TestContext.WriteLine($"Sampled {n} points in {sw.Elapsed}");
+
+            double[][] expected = { (double[])lon.Clone(), (double[])lat.Clone(), new double[n] };
+            t.Apply(expected);
+
+            for (int i = 0; i < n; i++)
+                Assert.AreEqual(expected[2][i], undulations[i], 1e-9, $"Point {i}");
+
+            Assert.AreEqual(undulations[0], geoid.Sample(lon[0], lat[0]), 1e-9);
+            Assert.IsTrue(double.IsNaN(geoid.Sample(-60, -30)), "Outside the grid");
+        }
+
+        [TestMethod]
+        [TestCategory("NeedsNetwork")]
+        [DoNotParallelize]
+        public void HilbertOrderReducesGridReads()
+        {
+            long cacheSize = ProjContext.NetworkBlockCacheSize;
+
+            // Random points over the Netherlands, in the latitude, longitude order of EPSG:4289
+            const int n = 20000;
+            var rnd = new Random(3);
+            double[] lat = new double[n], lon = new double[n];
+            for (int i = 0; i < n; i++)
+            {
+                lat[i] = 50.8 + rnd.NextDouble() * 2.7;
+                lon[i] = 3.5 + rnd.NextDouble() * 3.5;
+            }
+
+            try
+            {
+                // Without the process wide block cache, so each run reads the grid itself
+                ProjContext.NetworkBlockCacheSize = 0;
+                int[] requests = new int[2];
+                double[][][] results = new double[2][][];
+
+                for (int i = 0; i < 2; i++)
+                {
+                    using (var server = new RangeServer())
+                    using (var pc = CreateContext(server, gridCache: false)) // Nor the grid cache, so chunks PROJ drops from memory are read again
+                    using (var crsAmersfoort = CoordinateReferenceSystem.CreateFromEpsg(4289, pc))
+                    using (var crsETRS89 = CoordinateReferenceSystem.CreateFromEpsg(4258, pc))
+                    using (var t = CoordinateTransform.Create(crsAmersfoort, crsETRS89))
+                    {
+                        t.HilbertOrder = (i == 1);
+                        results[i] = new[] { (double[])lat.Clone(), (double[])lon.Clone() };
+
+                        var sw = Stopwatch.StartNew();
+                        t.Apply(results[i]);
+
+                        requests[i] = server.RequestCount;
+                        TestContext.WriteLine($"Hilbert order {t.HilbertOrder}: {server.RequestCount} requests, {server.BytesServed} bytes in {sw.Elapsed}");
+                    }
+                }
+
+                Assert.IsTrue(requests[1] > 0, "Used local server");
+                Assert.IsTrue(requests[1] < requests[0], $"Hilbert order should need fewer requests: {requests[1]} vs {requests[0]}");
+
+                for (int d = 0; d < 2; d++)
+                {
+                    for (int i = 0; i < n; i++)
+                        Assert.AreEqual(results[0][d][i], results[1][d][i], 1e-12, $"ordinate {d} of point {i}");
+                }
+            }
+            finally
+            {
+                ProjContext.NetworkBlockCacheSize = cacheSize;
+            }
+        }
+    }
+}
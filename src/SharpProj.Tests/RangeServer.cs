@@ -0,0 +1,167 @@
+using System;
+using System.Collections.Concurrent;
+using System.Globalization;
+using System.Net;
+using System.Net.Http;
+using System.Net.Sockets;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace SharpProj.Tests
+{
+    /// <summary>
+    /// Local stand-in for the PROJ CDN. Files are fetched once from the real CDN and from then on served
+    /// from memory, with range support and an optional injected latency per request. Tests using it need
+    /// internet access, so they are in the NeedsNetwork category.
+    /// </summary>
+    internal sealed class RangeServer : IDisposable
+    {
+        static readonly HttpClient _upstream = new HttpClient();
+        static readonly ConcurrentDictionary<string, Task<byte[]>> _files = new ConcurrentDictionary<string, Task<byte[]>>();
+        readonly HttpListener _listener = new HttpListener();
+        readonly string _upstreamUrl;
+        int _requests;
+        int _inFlight;
+        int _peakInFlight;
+        long _bytes;
+
+        public RangeServer(string upstreamUrl = "https://cdn.proj.org")
+        {
+            _upstreamUrl = upstreamUrl.TrimEnd('/');
+
+            var tcp = new TcpListener(IPAddress.Loopback, 0);
+            tcp.Start();
+            int port = ((IPEndPoint)tcp.LocalEndpoint).Port;
+            tcp.Stop();
+
+            Url = $"http://localhost:{port}";
+            _listener.Prefixes.Add(Url + "/");
+            _listener.Start();
+
+            Task.Run(ListenAsync);
+        }
+
+        public string Url { get; }
+
+        public TimeSpan Latency { get; set; }
+
+        public int RequestCount => Volatile.Read(ref _requests);
+
+        public long BytesServed => Interlocked.Read(ref _bytes);
+
+        /// <summary>
+        /// Gets the largest number of requests that were handled at the same time
+        /// </summary>
+        public int PeakConcurrency => Volatile.Read(ref _peakInFlight);
+
+        public void ResetCounters()
+        {
+            Interlocked.Exchange(ref _requests, 0);
+            Interlocked.Exchange(ref _peakInFlight, 0);
+            Interlocked.Exchange(ref _bytes, 0);
+        }
+
+        async Task ListenAsync()
+        {
+            while (_listener.IsListening)
+            {
+                HttpListenerContext ctx;
+                try
+                {
+                    ctx = await _listener.GetContextAsync();
+                }
+                catch (Exception) when (!_listener.IsListening)
+                {
+                    return;
+                }
+
+                _ = Task.Run(() => HandleAsync(ctx));
+            }
+        }
+
+        async Task HandleAsync(HttpListenerContext ctx)
+        {
+            var rp = ctx.Response;
+            int inFlight = Interlocked.Increment(ref _inFlight);
+            try
+            {
+                Interlocked.Increment(ref _requests);
+
+                for (int peak = Volatile.Read(ref _peakInFlight); inFlight > peak; peak = Volatile.Read(ref _peakInFlight))
+                    Interlocked.CompareExchange(ref _peakInFlight, inFlight, peak);
+
+                if (Latency > TimeSpan.Zero)
+                    await Task.Delay(Latency);
+
+                byte[] data;
+                try
+                {
+                    string path = ctx.Request.Url.AbsolutePath;
+                    data = await _files.GetOrAdd(path, p => _upstream.GetByteArrayAsync(_upstreamUrl + p));
+                }
+                catch (HttpRequestException)
+                {
+                    rp.StatusCode = 404;
+                    rp.Close();
+                    return;
+                }
+
+                rp.AddHeader("ETag", "\"" + data.Length.ToString("x", CultureInfo.InvariantCulture) + "\"");
+                rp.AddHeader("Last-Modified", "Mon, 01 Jan 2024 00:00:00 GMT");
+
+                long start = 0, end = data.Length - 1;
+                if (TryParseRange(ctx.Request.Headers["Range"], data.Length, out long s, out long e))
+                {
+                    start = s;
+                    end = e;
+                    rp.StatusCode = 206;
+                    rp.AddHeader("Content-Range", $"bytes {start}-{end}/{data.Length}");
+                }
+                else
+                    rp.StatusCode = 200;
+
+                int len = (int)(end - start + 1);
+                rp.ContentLength64 = len;
+                await rp.OutputStream.WriteAsync(data, (int)start, len);
+                Interlocked.Add(ref _bytes, len);
+                rp.Close();
+            }
+            catch (Exception)
+            {
+                try
+                {
+                    rp.Abort();
+                }
+                catch (Exception)
+                { }
+            }
+            finally
+            {
+                Interlocked.Decrement(ref _inFlight);
+            }
+        }
+
+        static bool TryParseRange(string range, long length, out long start, out long end)
+        {
+            start = end = 0;
+
+            if (string.IsNullOrEmpty(range) || !range.StartsWith("bytes=", StringComparison.OrdinalIgnoreCase) || range.Contains(","))
+                return false;
+
+            string[] parts = range.Substring(6).Split('-');
+
+            if (parts.Length != 2 || !long.TryParse(parts[0], out start))
+                return false;
+
+            if (!long.TryParse(parts[1], out end) || end >= length)
+                end = length - 1;
+
+            return start <= end;
+        }
+
+        public void Dispose()
+        {
+            _listener.Close();
+        }
+    }
+}
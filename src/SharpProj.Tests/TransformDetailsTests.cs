@@ -163,6 +163,35 @@ namespace SharpProj.Tests
             }
         }
 
+        [TestMethod]
+        public void ChooseInstantiatesOnUse()
+        {
+            using (ProjContext pc = new ProjContext())
+            using (CoordinateReferenceSystem crsFrom = CoordinateReferenceSystem.CreateFromEpsg(2964, pc))
+            using (CoordinateReferenceSystem crsTo = CoordinateReferenceSystem.CreateFromEpsg(4326, pc))
+            using (var cct = (ChooseCoordinateTransform)CoordinateTransform.Create(crsFrom, crsTo))
+            {
+                Assert.IsTrue(cct.Count > 1);
+                Assert.IsFalse(Enumerable.Range(0, cct.Count).Any(i => cct.IsInstantiated(i)));
+
+                // Queried without instantiating the options
+                Assert.IsTrue(cct.HasInverse);
+                Assert.IsTrue(cct.IsAvailable);
+                Assert.IsFalse(Enumerable.Range(0, cct.Count).Any(i => cct.IsInstantiated(i)));
+
+                PPoint center = crsFrom.UsageArea.Center;
+                cct.Apply(center);
+                cct.Apply(center);
+
+                int used = Enumerable.Range(0, cct.Count).Count(i => cct.IsInstantiated(i));
+                Assert.IsTrue(used >= 1 && used < cct.Count, $"{used} of {cct.Count} instantiated");
+                Assert.IsTrue(Enumerable.Range(0, cct.Count).Sum(i => cct.GetUsageCount(i)) >= 2);
+
+                // Enumerating gives all options
+                Assert.AreEqual(cct.Count, cct.Count(x => x != null));
+            }
+        }
+
         [TestMethod]
         [DynamicData(nameof(AsCRS100))]
         public void TestBoundsCRS100(Identifier id)
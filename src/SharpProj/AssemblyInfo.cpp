@@ -22,3 +22,5 @@ using namespace System::Security::Permissions;
 
 [assembly:CLSCompliantAttribute(true)];
 
+// The tests are signed with the same key
+[assembly:InternalsVisibleTo(L"SharpProj.Tests, PublicKey=002400000480000094000000060200000024000052534131000400000100010021a3ac6d17437e900220bf0993cdd9b8576f2b247282fa0cc4490729d989826cd784a71ded1c50a8eef31ef370b1f59ecc0db6b05f4bd55eb7e8146c24c49303c5d1eb58fd6a912cce99bbf1bafcab12f3ecae44e889ba76225a3e3ad0f75e0c7f48cabbb81c5852a483f185c2a01dbfea3932676c5eacfaf335a93771a66ece")];
@@ -0,0 +1,198 @@
+#include "pch.h"
+#include "ChainedCoordinateTransform.h"
+#include "CoordinateReferenceSystem.h"
+#include "GridUsage.h"
+#include "ProjException.h"
+
+using namespace SharpProj;
+
+using System::Collections::Generic::IEnumerable;
+using System::Collections::Generic::List;
+
+ChainedCoordinateTransform::ChainedCoordinateTransform(ProjContext^ ctx, array<CoordinateTransform^>^ stages, array<bool>^ owned)
+    : CoordinateTransform(ctx, proj_clone(ctx, stages[0]))
+{
+    m_stages = stages;
+    m_owned = owned;
+
+    ForceUnknownInfo();
+    Name = "<chained-coordinate-transform>";
+    SetCRS(stages[0]->SourceCRS, stages[stages->Length - 1]->TargetCRS);
+}
+
+ChainedCoordinateTransform::~ChainedCoordinateTransform()
+{
+    if (m_stages)
+    {
+        array<CoordinateTransform^>^ stages = m_stages;
+        m_stages = nullptr;
+        for (int i = 0; i < stages->Length; i++)
+        {
+            if (!m_owned[i])
+                continue; // Owned by the caller
+
+            try
+            {
+                delete stages[i];
+            }
+            catch (Exception^)
+            {
+            } // Already disposed, other errors, etc.
+        }
+    }
+}
+
+ProjObject^ ChainedCoordinateTransform::DoClone(ProjContext^ ctx)
+{
+    array<CoordinateTransform^>^ stages = gcnew array<CoordinateTransform^>(m_stages->Length);
+    array<bool>^ owned = gcnew array<bool>(m_stages->Length);
+
+    for (int i = 0; i < stages->Length; i++)
+    {
+        stages[i] = m_stages[i]->Clone(ctx);
+        owned[i] = true;
+    }
+
+    return gcnew ChainedCoordinateTransform(ctx, stages, owned);
+}
+
+CoordinateTransform^ ChainedCoordinateTransform::CreateInverse(ProjContext^ ctx)
+{
+    if (!ctx)
+        ctx = Context;
+
+    if (!HasInverse)
+        throw gcnew InvalidOperationException();
+
+    int n = m_stages->Length;
+    array<CoordinateTransform^>^ stages = gcnew array<CoordinateTransform^>(n);
+    array<bool>^ owned = gcnew array<bool>(n);
+
+    for (int i = 0; i < n; i++)
+    {
+        stages[i] = m_stages[n - 1 - i]->CreateInverse(ctx);
+        owned[i] = true;
+    }
+
+    return gcnew ChainedCoordinateTransform(ctx, stages, owned);
+}
+
+static IEnumerable<ProjOperation^>^ Select_Steps(CoordinateTransform^ transform)
+{
+    return transform->ProjOperations();
+}
+
+IReadOnlyList<ProjOperation^>^ ChainedCoordinateTransform::ProjOperations()
+{
+    auto ops = System::Linq::Enumerable::SelectMany<CoordinateTransform^, ProjOperation^>(this, gcnew System::Func<CoordinateTransform^, IEnumerable<ProjOperation^>^>(&Select_Steps));
+    return System::Linq::Enumerable::ToList(ops)->AsReadOnly();
+}
+
+ReadOnlyCollection<GridUsage^>^ ChainedCoordinateTransform::GridUsages::get()
+{
+    if (!m_gridUsages)
+    {
+        List<GridUsage^>^ usages = gcnew List<GridUsage^>();
+
+        for each (CoordinateTransform ^ c in m_stages)
+            usages->AddRange(c->GridUsages);
+
+        m_gridUsages = usages->AsReadOnly();
+    }
+    return m_gridUsages;
+}
+
+PPoint ChainedCoordinateTransform::DoTransform(bool forward, PPoint% coordinate)
+{
+    PPoint p = coordinate;
+    int n = m_stages->Length;
+
+    for (int i = 0; i < n; i++)
+    {
+        if (forward)
+            p = m_stages[i]->Apply(p);
+        else
+            p = m_stages[n - 1 - i]->ApplyReversed(p);
+    }
+
+    return p;
+}
+
+void ChainedCoordinateTransform::DoTransform(bool forward,
+    double* xVals, int xStep, int xCount,
+    double* yVals, int yStep, int yCount,
+    double* zVals, int zStep, int zCount,
+    double* tVals, int tStep, int tCount)
+{
+    int nmin;
+
+    /* ignore lengths of null arrays */
+    if (!xVals || xCount < 0 || xStep < 0) xCount = 0;
+    if (!yVals || yCount < 0 || yStep < 0) yCount = 0;
+    if (!zVals || zCount < 0 || zStep < 0) zCount = 0;
+    if (!tVals || tCount < 0 || tStep < 0) tCount = 0;
+
+    /* nothing to do? */
+    if (0 == xCount + yCount + zCount + tCount)
+        return;
+
+    /* arrays of length 1 are constants, which we broadcast along the longer arrays */
+    nmin = (xCount > 1) ? xCount : (yCount > 1) ? yCount : (zCount > 1) ? zCount : (tCount > 1) ? tCount : 1;
+    if ((xCount > 1) && (xCount < nmin))  nmin = xCount;
+    if ((yCount > 1) && (yCount < nmin))  nmin = yCount;
+    if ((zCount > 1) && (zCount < nmin))  nmin = zCount;
+    if ((tCount > 1) && (tCount < nmin))  nmin = tCount;
+
+    double* vals[4] = { xVals, yVals, zVals, tVals };
+    int steps[4] = { xStep, yStep, zStep, tStep };
+    int counts[4] = { xCount, yCount, zCount, tCount };
+    const double missing[4] = { 0, 0, 0, HUGE_VAL };
+
+    // Constant and missing ordinates are expanded per block, so every stage receives the values
+    // the previous stage produced for the point instead of the original constant
+    double buffer[4][BlockSize];
+    double* p[4];
+    int s[4];
+    int nStages = m_stages->Length;
+    int cnt = 0;
+
+    for (int start = 0; start < nmin; start += BlockSize)
+    {
+        cnt = Math::Min(BlockSize, nmin - start);
+
+        for (int d = 0; d < 4; d++)
+        {
+            if (counts[d] > 1)
+            {
+                p[d] = vals[d] + (ptrdiff_t)start * steps[d];
+                s[d] = steps[d];
+            }
+            else
+            {
+                double v = counts[d] ? *vals[d] : missing[d];
+
+                for (int i = 0; i < cnt; i++)
+                    buffer[d][i] = v;
+
+                p[d] = buffer[d];
+                s[d] = 1;
+            }
+        }
+
+        // Stream this block through all stages while it is still in the cache
+        for (int i = 0; i < nStages; i++)
+        {
+            if (forward)
+                m_stages[i]->Apply(p[0], s[0], cnt, p[1], s[1], cnt, p[2], s[2], cnt, p[3], s[3], cnt);
+            else
+                m_stages[nStages - 1 - i]->ApplyReversed(p[0], s[0], cnt, p[1], s[1], cnt, p[2], s[2], cnt, p[3], s[3], cnt);
+        }
+    }
+
+    /* Like proj_trans_generic() we update the length 1 cases with their last transformed alter egos */
+    for (int d = 0; d < 4; d++)
+    {
+        if (counts[d] == 1)
+            *vals[d] = buffer[d][cnt - 1];
+    }
+}
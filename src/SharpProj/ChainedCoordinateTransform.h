@@ -0,0 +1,148 @@
+#pragma once
+#include "CoordinateTransform.h"
+
+namespace SharpProj {
+    using System::Collections::Generic::IReadOnlyList;
+
+    /// <summary>
+    /// Represents a <see cref="CoordinateTransform"/> that applies a number of transforms after each other, as created by
+    /// <see cref="CoordinateTransform::Then" /> when the stages can't be fused into a single PROJ pipeline. Coordinate ranges
+    /// are streamed through all stages in small blocks, so the intermediate values stay in the processor cache.
+    /// </summary>
+    [DebuggerDisplay("[ChainedCoordinateTransform] Stage Count={Count}")]
+    public ref class ChainedCoordinateTransform : CoordinateTransform, IReadOnlyList<CoordinateTransform^>
+    {
+    private:
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        array<CoordinateTransform^>^ m_stages;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        array<bool>^ m_owned; // Stages created for this chain, instead of passed by the caller
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        ReadOnlyCollection<GridUsage^>^ m_gridUsages;
+
+        // Points per block. 4 ordinates of 512 points fill 16 KB; well within the L1 cache
+        literal int BlockSize = 512;
+
+    internal:
+        ChainedCoordinateTransform(ProjContext^ ctx, array<CoordinateTransform^>^ stages, array<bool>^ owned);
+
+    private:
+        ~ChainedCoordinateTransform();
+
+    protected:
+        virtual PPoint DoTransform(bool forward, PPoint% coordinate) override;
+        virtual void DoTransform(bool forward,
+            double* xVals, int xStep, int xCount,
+            double* yVals, int yStep, int yCount,
+            double* zVals, int zStep, int zCount,
+            double* tVals, int tStep, int tCount) override;
+
+    private protected:
+        virtual ProjObject^ DoClone(ProjContext^ ctx) override;
+
+    private:
+        virtual System::Collections::IEnumerator^ Obj_GetEnumerator() sealed = System::Collections::IEnumerable::GetEnumerator
+        {
+            return GetEnumerator();
+        }
+
+    public:
+        // Inherited via IReadOnlyCollection
+        virtual System::Collections::Generic::IEnumerator<SharpProj::CoordinateTransform^>^ GetEnumerator() sealed
+        {
+            return static_cast<System::Collections::Generic::IEnumerable<CoordinateTransform^>^>(m_stages)->GetEnumerator();
+        }
+
+        virtual property int Count
+        {
+            int get()
+            {
+                return m_stages->Length;
+            }
+        }
+
+        property CoordinateTransform^ default[int]
+        {
+            virtual CoordinateTransform ^ get(int index) sealed
+            {
+                return m_stages[index];
+            }
+        }
+
+        property bool HasInverse
+        {
+            virtual bool get() override sealed
+            {
+                for each (auto c in m_stages)
+                {
+                    if (!c->HasInverse)
+                        return false;
+                }
+
+                return true;
+            }
+        }
+
+        property virtual bool IsAvailable
+        {
+            virtual bool get() override sealed
+            {
+                for each (auto c in m_stages)
+                {
+                    if (!c->IsAvailable)
+                        return false;
+                }
+
+                return true;
+            }
+        }
+
+        property Nullable<double> Accuracy
+        {
+            virtual Nullable<double> get() override
+            {
+                double sum = 0;
+
+                for each (auto c in m_stages)
+                {
+                    Nullable<double> a = c->Accuracy;
+
+                    if (!a.HasValue)
+                        return Nullable<double>();
+
+                    sum += a.Value;
+                }
+                return sum;
+            }
+        }
+
+        property ReadOnlyCollection<GridUsage^>^ GridUsages
+        {
+            virtual ReadOnlyCollection<GridUsage^>^ get() override;
+        }
+
+        property ProjType Type
+        {
+            virtual ProjType get() override
+            {
+                return ProjType::ChainedTransform;
+            }
+        }
+
+    public:
+        virtual CoordinateTransform^ CreateInverse([Optional]ProjContext^ ctx) override;
+
+        virtual IReadOnlyList<CoordinateTransform^>^ Steps() override
+        {
+            return this;
+        }
+
+        virtual IReadOnlyList<ProjOperation^>^ ProjOperations() override;
+
+    public:
+        virtual String^ ToString() override
+        {
+            return String::Format("<Chain of {0} transforms>", Count);
+        }
+    };
+}
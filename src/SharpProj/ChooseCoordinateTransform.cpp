@@ -6,12 +6,166 @@ using namespace SharpProj;
 
 using System::Collections::Generic::IEnumerable;
 
+bool ChooseCoordinateTransform::HasInverse::get()
+{
+    for (int i = 0; i < m_operations->Length; i++)
+    {
+        CoordinateTransform^ c = m_operations[i];
+
+        if (c)
+        {
+            if (c->HasInverse)
+                return true;
+
+            continue;
+        }
+
+        PJ* pj = GetOperationPJ(i);
+
+        if (!pj)
+            continue;
+
+        bool hasInverse = 0 != proj_pj_info(pj).has_inverse;
+        proj_destroy(pj);
+
+        if (hasInverse)
+            return true;
+    }
+
+    return false;
+}
+
+bool ChooseCoordinateTransform::IsAvailable::get()
+{
+    for (int i = 0; i < m_operations->Length; i++)
+    {
+        CoordinateTransform^ c = m_operations[i];
+
+        if (c)
+        {
+            if (c->IsAvailable)
+                return true;
+
+            continue;
+        }
+
+        PJ* pj = GetOperationPJ(i);
+
+        if (!pj)
+            continue;
+
+        bool available = 0 != proj_coordoperation_is_instantiable(Context, pj);
+        proj_destroy(pj);
+
+        if (available)
+            return true;
+    }
+
+    return false;
+}
+
+bool ChooseCoordinateTransform::UsesGrids::get()
+{
+    for (int i = 0; i < m_operations->Length; i++)
+    {
+        CoordinateTransform^ c = m_operations[i];
+
+        if (c)
+        {
+            if (c->GridUsages->Count > 0)
+                return true;
+
+            continue;
+        }
+
+        PJ* pj = GetOperationPJ(i);
+
+        if (!pj)
+            continue;
+
+        bool usesGrids = proj_coordoperation_get_grid_used_count(Context, pj) > 0;
+        proj_destroy(pj);
+
+        if (usesGrids)
+            return true;
+    }
+
+    return false;
+}
+
 int ChooseCoordinateTransform::SuggestedOperation(PPoint coordinate)
 {
     PJ_COORD coord;
     SetCoordinate(coord, coordinate);
 
-    return proj_get_suggested_operation(Context, m_list, PJ_FWD, coord);
+    return GetSuggestedOperation(PJ_FWD, coord);
+}
+
+int ChooseCoordinateTransform::GetSuggestedOperation(PJ_DIRECTION dir, PJ_COORD coord)
+{
+    if (m_list)
+        return proj_get_suggested_operation(Context, m_list, dir, coord);
+
+    // Restored from the operation cache. Like proj_get_suggested_operation(): of the instantiable operations whose
+    // area contains the point, take the best ranked one
+    int iBest = -1;
+    int b = (dir == PJ_FWD) ? 0 : 4;
+
+    for (int i = 0; i < m_definitions->Length; i++, b += 8)
+    {
+        double minX = m_bounds[b], minY = m_bounds[b + 1], maxX = m_bounds[b + 2], maxY = m_bounds[b + 3];
+
+        if (!Double::IsNaN(minX))
+        {
+            bool inX = (minX <= maxX) ? (coord.xy.x >= minX && coord.xy.x <= maxX) : (coord.xy.x >= minX || coord.xy.x <= maxX);
+
+            if (!inX || coord.xy.y < minY || coord.xy.y > maxY)
+                continue;
+        }
+
+        if ((iBest < 0 || IsBetterOperation(i, iBest)) && IsInstantiableOperation(i))
+            iBest = i;
+    }
+
+    return iBest;
+}
+
+// PROJ's ordering: a known accuracy over an unknown one, then the best accuracy, then the smallest area with a known
+// name. An offshore area never replaces an earlier match. Ballpark operations only when there is nothing else
+bool ChooseCoordinateTransform::IsBetterOperation(int i, int best)
+{
+    double acc = m_accuracy[i];
+    double bestAcc = m_accuracy[best];
+
+    if (m_flags[i] & OffshoreFlag)
+        return false;
+    else if (acc >= 0)
+        return bestAcc < 0 || acc < bestAcc
+            || (acc == bestAcc && m_area[i] < m_area[best] && !((m_flags[i] & UnknownAreaFlag) && !(m_flags[best] & UnknownAreaFlag)));
+
+    return bestAcc < 0 && (m_flags[best] & BallparkFlag) && !(m_flags[i] & BallparkFlag);
+}
+
+// Operations with grids that are not available locally (or via the network when enabled) are skipped, like PROJ does
+bool ChooseCoordinateTransform::IsInstantiableOperation(int index)
+{
+    if (!m_instantiable[index])
+    {
+        PJ* pj = GetOperationPJ(index);
+
+        if (pj)
+        {
+            m_instantiable[index] = proj_coordoperation_is_instantiable(Context, pj) ? 1 : -1;
+            proj_destroy(pj);
+        }
+        else
+        {
+            Context->ClearError(this);
+            m_instantiable[index] = -1;
+        }
+    }
+
+    return m_instantiable[index] > 0;
 }
 
 PPoint ChooseCoordinateTransform::DoTransform(bool forward, PPoint% coordinate)
@@ -30,11 +184,11 @@ PPoint ChooseCoordinateTransform::DoTransform(bool forward, PPoint% coordinate)
 
     // Do a first pass and select the operations that match the area of use
     // and has the best accuracy.
-    int iBest = proj_get_suggested_operation(Context, m_list, dir, coord);
+    int iBest = GetSuggestedOperation(dir, coord);
 
     if (iBest >= 0)
     {
-        CoordinateTransform^ c = this[iBest];
+        CoordinateTransform^ c = UseOperation(iBest);
 
         if (!ReferenceEquals(c, m_last))
         {
@@ -66,7 +220,7 @@ PPoint ChooseCoordinateTransform::DoTransform(bool forward, PPoint% coordinate)
         if (i == iBest)
             continue; // Don't retry same op
 
-        CoordinateTransform^ c = this[i];
+        CoordinateTransform^ c = UseOperation(i);
 
         if (!ReferenceEquals(c, m_last))
         {
@@ -6,6 +6,11 @@ namespace SharpProj {
     ref class CoordinateReferenceSystem;
     ref class Proj::ProjArea;
 
+    static void proj_list_destroy_deferred(void* list)
+    {
+        proj_list_destroy(static_cast<PJ_OBJ_LIST*>(list));
+    }
+
     /// <summary>
     /// Represents a <see cref="CoordinateTransform"/> which is implemented in a number of ways. The best
     /// implementation is chosen at runtime, based on some predefined settings. (pyproj name: 'TransformerGroup')
@@ -19,32 +24,113 @@ namespace SharpProj {
         [DebuggerBrowsable(DebuggerBrowsableState::Never)]
         array<CoordinateTransform^>^ m_operations;
         [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        array<int>^ m_usage;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
         CoordinateTransform^ m_last;
+        // When restored from the operation cache: definitions and what PROJ ranks operations by, instead of m_list
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        array<String^>^ m_definitions;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        array<double>^ m_accuracy;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        array<double>^ m_bounds; // Per operation: source minx, miny, maxx, maxy, then the same for the target
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        array<double>^ m_area; // Size of the area of use in square degrees
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        array<int>^ m_flags;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        array<int>^ m_instantiable; // 0 when not checked yet, 1 when instantiable, -1 when not
 
     internal:
+        // Properties of a cached operation that PROJ uses for choosing between operations
+        literal int BallparkFlag = 1;
+        literal int OffshoreFlag = 2;
+        literal int UnknownAreaFlag = 4;
+
         ChooseCoordinateTransform(ProjContext^ ctx, PJ* pj, PJ_OBJ_LIST* list)
             : CoordinateTransform(ctx, pj)
         {
             m_list = list;
 
-            array<CoordinateTransform^>^ items = gcnew array<CoordinateTransform^>(proj_list_get_count(list));
+            // The operations are only instantiated when used
+            int n = proj_list_get_count(list);
+            m_operations = gcnew array<CoordinateTransform^>(n);
+            m_usage = gcnew array<int>(n);
 
-            for (int i = 0; i < items->Length; i++)
-            {
-                items[i] = ctx->Create<CoordinateTransform^>(proj_list_get(Context, m_list, i));
-            }
-            m_operations = items;
+            ForceUnknownInfo();
+            Name = "<choose-coordinate-transform>";
+        }
+
+        ChooseCoordinateTransform(ProjContext^ ctx, PJ* pj, array<String^>^ definitions, array<double>^ accuracy, array<double>^ bounds, array<double>^ area, array<int>^ flags)
+            : CoordinateTransform(ctx, pj)
+        {
+            m_definitions = definitions;
+            m_accuracy = accuracy;
+            m_bounds = bounds;
+            m_area = area;
+            m_flags = flags;
+            m_instantiable = gcnew array<int>(definitions->Length);
+
+            m_operations = gcnew array<CoordinateTransform^>(definitions->Length);
+            m_usage = gcnew array<int>(definitions->Length);
 
             ForceUnknownInfo();
             Name = "<choose-coordinate-transform>";
         }
 
+    private:
+        int GetSuggestedOperation(PJ_DIRECTION dir, PJ_COORD coord);
+        bool IsBetterOperation(int i, int best);
+        bool IsInstantiableOperation(int index);
+
+        CoordinateTransform^ GetOperation(int index)
+        {
+            CoordinateTransform^ c = m_operations[index];
+
+            if (!c)
+            {
+                PJ* pj = GetOperationPJ(index);
+
+                if (!pj)
+                    throw Context->ConstructException();
+
+                m_operations[index] = c = Context->Create<CoordinateTransform^>(pj);
+            }
+            return c;
+        }
+
+        // The native operation at index, without instantiating a managed transform for it. Caller destroys it
+        PJ* GetOperationPJ(int index)
+        {
+            return m_list ? proj_list_get(Context, m_list, index) : proj_create(Context, ::utf8_string(m_definitions[index]).c_str());
+        }
+
+    internal:
+        // Whether any of the operations uses grids
+        property bool UsesGrids
+        {
+            bool get();
+        }
+
+    private:
+        void EnsureOperations()
+        {
+            for (int i = 0; i < m_operations->Length; i++)
+                GetOperation(i);
+        }
+
+        CoordinateTransform^ UseOperation(int index)
+        {
+            m_usage[index]++;
+            return GetOperation(index);
+        }
+
     private:
         !ChooseCoordinateTransform()
         {
             if (m_list)
             {
-                proj_list_destroy(m_list);
+                DeferDestroy(m_list, proj_list_destroy_deferred);
                 m_list = nullptr;
             }
         }
@@ -62,6 +148,9 @@ namespace SharpProj {
                 m_operations = nullptr;
                 for each (CoordinateTransform ^ o in ops)
                 {
+                    if (!o)
+                        continue; // Never instantiated
+
                     try
                     {
                         delete o;
@@ -90,10 +179,27 @@ namespace SharpProj {
         int SuggestedOperation(PPoint coordinate);
         int SuggestedOperation(...array<double>^ ordinates) { return SuggestedOperation(PPoint(ordinates)); }
 
+        /// <summary>
+        /// Gets the number of times the operation at <paramref name="index"/> was used to transform a coordinate.
+        /// </summary>
+        int GetUsageCount(int index)
+        {
+            return m_usage[index];
+        }
+
+        /// <summary>
+        /// Gets whether the operation at <paramref name="index"/> is instantiated. Operations are instantiated on first use.
+        /// </summary>
+        bool IsInstantiated(int index)
+        {
+            return m_operations[index] != nullptr;
+        }
+
     public:
         // Inherited via IReadOnlyCollection
         virtual System::Collections::Generic::IEnumerator<SharpProj::CoordinateTransform^>^ GetEnumerator() sealed
         {
+            EnsureOperations();
             return static_cast<System::Collections::Generic::IEnumerable<CoordinateTransform^>^>(m_operations)->GetEnumerator();
         }
         virtual property int Count
@@ -108,36 +214,18 @@ namespace SharpProj {
         {
             virtual CoordinateTransform ^ get(int index) sealed
             {
-                return m_operations[index];
+                return GetOperation(index);
             }
         }
 
             property bool HasInverse
         {
-            virtual bool get() override sealed
-            {
-                for each (auto c in this)
-                {
-                    if (c->HasInverse)
-                        return true;
-                }
-
-                return false;
-            }
+            virtual bool get() override sealed;
         }
 
         property virtual bool IsAvailable
         {
-            virtual bool get() override sealed
-            {
-                for each (auto c in this)
-                {
-                    if (c->IsAvailable)
-                        return true;
-                }
-
-                return false;
-            }
+            virtual bool get() override sealed;
         }
 
         property ProjType Type
@@ -2,6 +2,8 @@
 #include "ProjArea.h"
 namespace SharpProj {
     using namespace SharpProj::Proj;
+    ref class CoordinateReferenceSystem;
+    ref class CoordinateTransform;
 
     public ref class CoordinateArea sealed : ProjArea
     {
@@ -96,4 +98,4 @@ namespace SharpProj {
         property bool BestOnly;
         property bool ForceOver;
     };
-}
\ No newline at end of file
+}
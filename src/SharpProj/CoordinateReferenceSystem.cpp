@@ -61,7 +61,7 @@ CoordinateReferenceSystem^ CoordinateReferenceSystem::Create(String^ from, ProjC
     try
     {
 
-        std::string fromStr = utf8_string(from);
+        utf8_string fromStr(from);
         PJ* pj = proj_create(ctx, fromStr.c_str());
 
         if (!pj)
@@ -133,7 +133,7 @@ CoordinateReferenceSystem^ CoordinateReferenceSystem::CreateFromWellKnownText(St
             }
         }
 
-        std::string fromStr = utf8_string(from);
+        utf8_string fromStr(from);
         PJ* pj = proj_create_from_wkt(ctx, fromStr.c_str(), c_options, &wrs, &errs);
 
         warnings = FromStringList(wrs);
@@ -191,7 +191,7 @@ CoordinateReferenceSystem^ CoordinateReferenceSystem::Create(array<String^>^ fro
     char** lst = new char* [from->Length + 1];
     for (int i = 0; i < from->Length; i++)
     {
-        std::string fromStr = utf8_string(from[i]);
+        utf8_string fromStr(from[i]);
         lst[i] = _strdup(fromStr.c_str());
     }
     lst[from->Length] = 0; // also used for 'type=crs'
@@ -264,8 +264,8 @@ CoordinateReferenceSystem^ CoordinateReferenceSystem::CreateFromDatabase(String^
 
     try
     {
-        std::string authStr = utf8_string(authority);
-        std::string codeStr = utf8_string(code);
+        utf8_string authStr(authority);
+        utf8_string codeStr(code);
         PJ* pj = proj_create_from_database(ctx, authStr.c_str(), codeStr.c_str(), PJ_CATEGORY_CRS, false, nullptr);
 
         if (!pj)
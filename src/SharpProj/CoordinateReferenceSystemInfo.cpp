@@ -2,44 +2,17 @@
 #include "ProjObject.h"
 #include "CoordinateReferenceSystem.h"
 #include "CoordinateReferenceSystemInfo.h"
+#include "CrsCatalog.h"
 
 using System::Collections::Generic::IEnumerable;
 
-private ref class CRSComparer : System::Collections::Generic::IComparer<CoordinateReferenceSystemInfo^>
-{
-public:
-    // Inherited via IComparer
-    virtual int Compare(SharpProj::Proj::CoordinateReferenceSystemInfo^ x, SharpProj::Proj::CoordinateReferenceSystemInfo^ y)
-    {
-        int n = StringComparer::OrdinalIgnoreCase->Compare(x->Authority, y->Authority);
-        if (n != 0)
-            return n;
-
-        int xi, yi;
-
-        if (int::TryParse(x->Code, xi) && int::TryParse(y->Code, yi))
-        {
-            n = xi - yi;
-
-            if (n != 0)
-                return n;
-        }
-
-        return StringComparer::OrdinalIgnoreCase->Compare(x->Name, y->Name);
-    }
-
-    static initonly CRSComparer^ Instance = gcnew CRSComparer();
-};
-
 ReadOnlyCollection<CoordinateReferenceSystemInfo^>^ ProjContext::GetCoordinateReferenceSystems(CoordinateReferenceSystemFilter^ filter)
 {
     if (!filter)
         throw gcnew ArgumentNullException("filter");
 
-    std::string auth_name;
-    std::string body_name;
-    if (filter->Authority)
-        auth_name = ::utf8_string(filter->Authority);
+    ::utf8_string auth_name(filter->Authority);
+    ::utf8_string body_name(filter->CelestialBodyName);
     PROJ_CRS_LIST_PARAMETERS* params = proj_get_crs_list_parameters_create();
 
     try
@@ -70,7 +43,6 @@ ReadOnlyCollection<CoordinateReferenceSystemInfo^>^ ProjContext::GetCoordinateRe
 
         if (filter->CelestialBodyName)
         {
-            body_name = ::utf8_string(filter->CelestialBodyName);
             params->celestial_body_name = body_name.c_str();
         }
 
@@ -90,8 +62,24 @@ ReadOnlyCollection<CoordinateReferenceSystemInfo^>^ ProjContext::GetCoordinateRe
             proj_crs_info_list_destroy(infoList);
         }
 
-        Array::Sort(result, CRSComparer::Instance);
-        return Array::AsReadOnly(result);
+        array<String^>^ authorities = gcnew array<String^>(count);
+        array<String^>^ codes = gcnew array<String^>(count);
+        array<String^>^ names = gcnew array<String^>(count);
+
+        for (int i = 0; i < count; i++)
+        {
+            authorities[i] = result[i]->Authority;
+            codes[i] = result[i]->Code;
+            names[i] = result[i]->Name;
+        }
+
+        array<int>^ order = CrsCatalog::SortOrder(authorities, codes, names);
+        array<CoordinateReferenceSystemInfo^>^ sorted = gcnew array<CoordinateReferenceSystemInfo^>(count);
+
+        for (int i = 0; i < count; i++)
+            sorted[i] = result[order[i]];
+
+        return Array::AsReadOnly(sorted);
     }
     finally
     {
@@ -116,12 +104,21 @@ ReadOnlyCollection<GeoidModelInfo^>^ CoordinateReferenceSystemInfo::GetGeoidMode
 {
     if (!_geoidModels)
     {
-        std::string auth = utf8_string(Authority);
-        std::string code = utf8_string(Code);
-        PROJ_STRING_LIST geoid_list = proj_get_geoid_models_from_database(_ctx, auth.c_str(), code.c_str(), nullptr);
+        utf8_string auth(Authority);
+        utf8_string code(Code);
+        ProjContext^ ctx = _ctx ? _ctx : gcnew ProjContext();
+        PROJ_STRING_LIST geoid_list = proj_get_geoid_models_from_database(ctx, auth.c_str(), code.c_str(), nullptr);
 
         if (!geoid_list)
-            throw _ctx->ConstructException("GetGeoidModels");
+        {
+            Exception^ ex = ctx->ConstructException("GetGeoidModels");
+
+            if (!_ctx)
+                delete ctx;
+            throw ex;
+        }
+        else if (!_ctx)
+            delete ctx;
 
         array<String^>^ geoids = ProjObject::FromStringList(geoid_list);
         proj_string_list_destroy(geoid_list);
@@ -234,7 +231,7 @@ System::Collections::ObjectModel::ReadOnlyCollection<Identifier^>^ ProjContext::
 
     for each (auto a in authorities)
     {
-        std::string a_c = ::utf8_string(a);
+        ::utf8_string a_c(a);
         auto infoList = proj_get_codes_from_database(this, a_c.c_str(), (PJ_TYPE)type, includeDeprecated);
         try
         {
@@ -292,13 +289,8 @@ System::Collections::ObjectModel::ReadOnlyCollection<UnitOfMeasurement^>^ ProjCo
     if (!filter)
         throw gcnew ArgumentNullException("filter");
 
-    std::string auth_name;
-    std::string category;
-
-    if (filter->Authority)
-        auth_name = ::utf8_string(filter->Authority);
-    if (filter->Category)
-        category = ::utf8_string(filter->Category);
+    ::utf8_string auth_name(filter->Authority);
+    ::utf8_string category(filter->Category);
 
     int count;
     auto r = proj_get_units_from_database(this,
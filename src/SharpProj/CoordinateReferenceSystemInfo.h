@@ -65,6 +65,20 @@ namespace SharpProj {
                     _bbox = gcnew ProjArea(info->west_lon_degree, info->south_lat_degree, info->east_lon_degree, info->north_lat_degree);
             }
 
+            // From a CrsCatalog, which is not bound to a context
+            CoordinateReferenceSystemInfo(String^ authName, String^ code, String^ name, ProjType type, bool deprecated, String^ areaName, String^ projectionName, String^ celestialBodyName, ProjArea^ bbox)
+            {
+                _authName = authName;
+                _code = code;
+                _name = name;
+                _type = type;
+                _deprecated = deprecated;
+                _areaName = areaName;
+                _projectionName = projectionName;
+                _celestialBodyName = celestialBodyName;
+                _bbox = bbox;
+            }
+
         public:
             property String^ Authority
             {
@@ -23,10 +23,6 @@ namespace SharpProj {
 
     private:
         ~CoordinateReferenceSystemList()
-        {
-            CoordinateReferenceSystemList::!CoordinateReferenceSystemList();
-        }
-        !CoordinateReferenceSystemList()
         {
             if (m_crs)
                 try
@@ -42,6 +38,11 @@ namespace SharpProj {
                 m_crs = nullptr;
             }
         }
+        !CoordinateReferenceSystemList()
+        {
+            // The items are finalized (and their native handles released) by themselves
+            m_crs = nullptr;
+        }
 
     private:
         // Inherited via IEnumerable
@@ -4,14 +4,21 @@
 #include "ProjContext.h"
 #include "CoordinateTransform.h"
 #include "ChooseCoordinateTransform.h"
+#include "ChainedCoordinateTransform.h"
+#include "PipelineStep.h"
+#include "FastTransform.h"
 #include "CoordinateReferenceSystem.h"
+#include "CoordinateMetadata.h"
 #include "CoordinateSystem.h"
 #include "CoordinateArea.h"
 #include "ProjException.h"
 #include "Ellipsoid.h"
 #include "GridUsage.h"
+#include "HilbertCurve.h"
+#include "NetworkStatistics.h"
 
 using namespace System::Linq;
+using namespace System::IO;
 
 CoordinateTransform::CoordinateTransform(ProjContext^ ctx, PJ* pj)
     : ProjObject(ctx, pj)
@@ -37,6 +44,10 @@ ProjObject^ SharpProj::CoordinateTransform::DoClone(ProjContext^ ctx)
 
     t->m_methodName = m_methodName;
     t->m_distanceFlags = m_distanceFlags;
+    t->m_fast = m_fast;
+    t->m_fastChecked = m_fastChecked;
+    t->m_hilbertOrder = m_hilbertOrder;
+    t->m_enableFastPaths = m_enableFastPaths;
 
     if (m_pgeod && !t->m_pgeod)
     {
@@ -46,6 +57,330 @@ ProjObject^ SharpProj::CoordinateTransform::DoClone(ProjContext^ ctx)
     return t;
 }
 
+#pragma region OperationCache
+// Opt-in on-disk cache of the operations found by proj_create_operations(), so later processes can skip operation
+// discovery. One file per source, target, options and installed grids, in a subdirectory per PROJ and database
+// version. Processes with different versions can share the directory; subdirectories of versions that are not used
+// for a while are removed when the directory is first used.
+private ref class OperationCache abstract sealed
+{
+private:
+    literal String^ Header = "SharpProj operation cache 2";
+    literal String^ Extension = ".ops";
+    literal int PruneAfterDays = 30;
+    static initonly System::Collections::Generic::HashSet<String^>^ _pruned = gcnew System::Collections::Generic::HashSet<String^>();
+
+internal:
+    static String^ _directory;
+
+    static String^ GetKey(ProjContext^ ctx, CoordinateReferenceSystem^ sourceCrs, CoordinateReferenceSystem^ targetCrs, CoordinateTransformOptions^ options)
+    {
+        System::Text::StringBuilder^ sb = gcnew System::Text::StringBuilder();
+        System::Globalization::CultureInfo^ ci = System::Globalization::CultureInfo::InvariantCulture;
+
+        sb->AppendLine(sourceCrs->AsProjJson());
+        sb->AppendLine(targetCrs->AsProjJson());
+        sb->AppendLine(String::Format(ci, "{0}|{1}|{2}|{3}|{4}|{5}|{6}|{7}|{8}",
+            options->Authority,
+            options->Accuracy.HasValue ? options->Accuracy.Value.ToString("R", ci) : nullptr,
+            options->NoBallparkConversions, options->NoDiscardIfMissing, options->UsePrimaryGridNames,
+            options->UseSuperseded, options->StrictContains, options->IntermediateCrsUsage,
+            ctx->EnableNetworkConnections));
+
+        if (options->Area)
+            sb->AppendLine(String::Format(ci, "{0:R}|{1:R}|{2:R}|{3:R}", options->Area->WestLongitude, options->Area->SouthLatitude, options->Area->EastLongitude, options->Area->NorthLatitude));
+
+        // Without network access operations are discarded or sorted by the grids that are installed locally
+        if (!ctx->EnableNetworkConnections)
+            sb->Append(ctx->GetGridSearchKey());
+
+        return Hash(sb->ToString());
+    }
+
+    static CoordinateTransform^ TryLoad(ProjContext^ ctx, String^ key)
+    {
+        String^ dir = _directory;
+
+        if (!dir)
+            return nullptr;
+
+        String^ version = String::Concat(PROJ_VERSION "|", ctx->GetDatabaseVersionKey());
+        String^ versionDir = Path::Combine(dir, Hash(version)->Substring(0, 16));
+        String^ path = Path::Combine(versionDir, key + Extension);
+
+        Prune(dir, versionDir);
+
+        array<String^>^ lines;
+        try
+        {
+            if (!File::Exists(path))
+                return nullptr;
+
+            lines = File::ReadAllLines(path);
+        }
+        catch (IOException^)
+        {
+            return nullptr;
+        }
+        catch (UnauthorizedAccessException^)
+        {
+            return nullptr;
+        }
+
+        if (lines->Length < 4 || lines[0] != Header || lines[1] != version)
+            return nullptr;
+
+        array<String^>^ counts = lines[2]->Split(' ');
+        int count;
+        if (counts->Length != 2 || !int::TryParse(counts[1], count) || count < 1 || lines->Length < 3 + count)
+            return nullptr;
+
+        bool single = (counts[0] == "1");
+        array<String^>^ definitions = gcnew array<String^>(count);
+        array<double>^ accuracy = gcnew array<double>(count);
+        array<double>^ bounds = gcnew array<double>(8 * count);
+        array<double>^ area = gcnew array<double>(count);
+        array<int>^ flags = gcnew array<int>(count);
+        System::Globalization::CultureInfo^ ci = System::Globalization::CultureInfo::InvariantCulture;
+
+        for (int i = 0; i < count; i++)
+        {
+            array<String^>^ parts = lines[3 + i]->Split(' ');
+
+            if (parts->Length != 12 || !double::TryParse(parts[0], System::Globalization::NumberStyles::Float, ci, accuracy[i]))
+                return nullptr;
+
+            for (int j = 0; j < 8; j++)
+            {
+                if (!double::TryParse(parts[1 + j], System::Globalization::NumberStyles::Float, ci, bounds[8 * i + j]))
+                    return nullptr;
+            }
+
+            if (!double::TryParse(parts[9], System::Globalization::NumberStyles::Float, ci, area[i])
+                || !int::TryParse(parts[10], System::Globalization::NumberStyles::Integer, ci, flags[i]))
+                return nullptr;
+
+            definitions[i] = System::Text::Encoding::UTF8->GetString(Convert::FromBase64String(parts[11]));
+        }
+
+        PJ* pj = proj_create(ctx, ::utf8_string(definitions[0]).c_str());
+
+        if (!pj)
+            return nullptr; // Let operation discovery handle it
+
+        if (single || count == 1)
+            return ctx->Create<CoordinateTransform^>(pj);
+
+        return gcnew ChooseCoordinateTransform(ctx, pj, definitions, accuracy, bounds, area, flags);
+    }
+
+    static void Store(ProjContext^ ctx, String^ key, CoordinateReferenceSystem^ sourceCrs, CoordinateReferenceSystem^ targetCrs, PJ_OBJ_LIST* list, bool single)
+    {
+        String^ dir = _directory;
+
+        if (!dir)
+            return;
+
+        int count = single ? 1 : proj_list_get_count(list);
+        String^ version = String::Concat(PROJ_VERSION "|", ctx->GetDatabaseVersionKey());
+        String^ versionDir = Path::Combine(dir, Hash(version)->Substring(0, 16));
+        System::Text::StringBuilder^ sb = gcnew System::Text::StringBuilder();
+        System::Globalization::CultureInfo^ ci = System::Globalization::CultureInfo::InvariantCulture;
+
+        sb->AppendLine(Header);
+        sb->AppendLine(version);
+        sb->AppendLine(String::Format(ci, "{0} {1}", single ? 1 : 0, count));
+
+        PJ* fromSource = lonlat_to(ctx, sourceCrs);
+        PJ* fromTarget = lonlat_to(ctx, targetCrs);
+        try
+        {
+            for (int i = 0; i < count; i++)
+            {
+                PJ* op = proj_list_get(ctx, list, i);
+
+                if (!op)
+                    return;
+
+                try
+                {
+                    const char* json = proj_as_projjson(ctx, op, nullptr);
+
+                    if (!json)
+                        return;
+
+                    double w, s, e, n;
+                    const char* areaName = nullptr;
+                    array<double>^ b = gcnew array<double>(8) { Double::NaN, Double::NaN, Double::NaN, Double::NaN, Double::NaN, Double::NaN, Double::NaN, Double::NaN };
+                    double area = Double::MaxValue;
+                    int flags = 0;
+
+                    if (proj_get_area_of_use(ctx, op, &w, &s, &e, &n, &areaName) && w > -1000)
+                    {
+                        trans_bounds(ctx, fromSource, w, s, e, n, b, 0);
+                        trans_bounds(ctx, fromTarget, w, s, e, n, b, 4);
+                        area = ((e >= w) ? e - w : e + 360 - w) * (n - s);
+                    }
+
+                    String^ name = areaName ? Utf8_PtrToString(areaName) : nullptr;
+
+                    if (proj_coordoperation_has_ballpark_transformation(ctx, op))
+                        flags |= ChooseCoordinateTransform::BallparkFlag;
+                    if (name && name->Contains("- offshore"))
+                        flags |= ChooseCoordinateTransform::OffshoreFlag;
+                    if (String::IsNullOrEmpty(name) || name == "unknown")
+                        flags |= ChooseCoordinateTransform::UnknownAreaFlag;
+
+                    sb->Append(proj_coordoperation_get_accuracy(ctx, op).ToString("R", ci));
+                    for each (double v in b)
+                        sb->Append(' ')->Append(v.ToString("R", ci));
+                    sb->Append(' ')->Append(area.ToString("R", ci));
+                    sb->Append(' ')->Append(flags.ToString(ci));
+
+                    sb->Append(' ')->AppendLine(Convert::ToBase64String(System::Text::Encoding::UTF8->GetBytes(Utf8_PtrToString(json))));
+                }
+                finally
+                {
+                    proj_destroy(op);
+                }
+            }
+        }
+        finally
+        {
+            if (fromSource)
+                proj_destroy(fromSource);
+            if (fromTarget)
+                proj_destroy(fromTarget);
+        }
+
+        // Write and rename, so readers never see partial files
+        String^ path = Path::Combine(versionDir, key + Extension);
+        String^ tmp = path + "." + Guid::NewGuid().ToString("N") + ".tmp";
+        try
+        {
+            Directory::CreateDirectory(versionDir);
+            File::WriteAllText(tmp, sb->ToString());
+
+            if (File::Exists(path))
+                File::Delete(path);
+            File::Move(tmp, path);
+        }
+        catch (IOException^)
+        {
+            try
+            {
+                File::Delete(tmp);
+            }
+            catch (IOException^)
+            {
+            }
+        }
+        catch (UnauthorizedAccessException^)
+        {
+        }
+    }
+
+private:
+    // Transform from lon/lat on the datum of crs to crs, to express areas of use in the units of crs
+    static PJ* lonlat_to(ProjContext^ ctx, CoordinateReferenceSystem^ crs)
+    {
+        PJ* geod = proj_crs_get_geodetic_crs(ctx, crs);
+
+        if (!geod)
+            return nullptr;
+
+        PJ* lonlat = proj_normalize_for_visualization(ctx, geod);
+        proj_destroy(geod);
+
+        if (!lonlat)
+            return nullptr;
+
+        PJ* op = proj_create_crs_to_crs_from_pj(ctx, lonlat, crs, nullptr, nullptr);
+        proj_destroy(lonlat);
+        return op;
+    }
+
+    static void trans_bounds(ProjContext^ ctx, PJ* op, double w, double s, double e, double n, array<double>^ b, int at)
+    {
+        double xmin, ymin, xmax, ymax;
+
+        if (op && proj_trans_bounds(ctx, op, PJ_FWD, w, s, e, n, &xmin, &ymin, &xmax, &ymax, 21))
+        {
+            b[at] = xmin;
+            b[at + 1] = ymin;
+            b[at + 2] = xmax;
+            b[at + 3] = ymax;
+        }
+    }
+
+    static String^ Hash(String^ text)
+    {
+        auto sha = System::Security::Cryptography::SHA256::Create();
+        try
+        {
+            return BitConverter::ToString(sha->ComputeHash(System::Text::Encoding::UTF8->GetBytes(text)))->Replace("-", "")->ToLowerInvariant();
+        }
+        finally
+        {
+            delete sha;
+        }
+    }
+
+    // Marks the directory of this version as used and removes the directories of versions that were not used
+    // for a while, once per process
+    static void Prune(String^ dir, String^ versionDir)
+    {
+        System::Threading::Monitor::Enter(_pruned);
+        try
+        {
+            if (!_pruned->Add(versionDir))
+                return;
+        }
+        finally
+        {
+            System::Threading::Monitor::Exit(_pruned);
+        }
+
+        try
+        {
+            if (!Directory::Exists(dir))
+                return;
+
+            DateTime now = DateTime::UtcNow;
+
+            if (Directory::Exists(versionDir))
+                Directory::SetLastWriteTimeUtc(versionDir, now);
+
+            for each (String^ d in Directory::GetDirectories(dir))
+            {
+                if (!String::Equals(d, versionDir, StringComparison::OrdinalIgnoreCase)
+                    && Directory::GetLastWriteTimeUtc(d) < now.AddDays(-PruneAfterDays)
+                    && Directory::GetFiles(d, "*" + Extension)->Length > 0)
+                {
+                    Directory::Delete(d, true);
+                }
+            }
+        }
+        catch (IOException^)
+        {
+        }
+        catch (UnauthorizedAccessException^)
+        {
+        }
+    }
+};
+
+String^ ProjContext::OperationCacheDirectory::get()
+{
+    return OperationCache::_directory;
+}
+
+void ProjContext::OperationCacheDirectory::set(String^ value)
+{
+    OperationCache::_directory = String::IsNullOrEmpty(value) ? nullptr : Path::GetFullPath(value);
+}
+#pragma endregion
+
 CoordinateTransform^ CoordinateTransform::Create(CoordinateReferenceSystem^ sourceCrs, CoordinateReferenceSystem^ targetCrs, CoordinateTransformOptions^ options, ProjContext^ ctx)
 {
     if (!sourceCrs)
@@ -66,11 +401,24 @@ CoordinateTransform^ CoordinateTransform::Create(CoordinateReferenceSystem^ sour
     if (!options)
         options = gcnew CoordinateTransformOptions();
 
-    std::string s_auth;
-    if (!String::IsNullOrEmpty(options->Authority))
-        s_auth = utf8_string(options->Authority);
+    String^ cacheKey = OperationCache::_directory ? OperationCache::GetKey(ctx, sourceCrs, targetCrs, options) : nullptr;
 
-    auto operation_ctx = proj_create_operation_factory_context(ctx, s_auth.size() ? s_auth.c_str() : nullptr);
+    if (cacheKey)
+    {
+        CoordinateTransform^ cached = OperationCache::TryLoad(ctx, cacheKey);
+
+        if (cached)
+        {
+            ctx->Counters->Increment(Proj::NetworkStatistics::Counter::OperationCacheHits);
+            return cached;
+        }
+
+        ctx->Counters->Increment(Proj::NetworkStatistics::Counter::OperationCacheMisses);
+    }
+
+    utf8_string s_auth(options->Authority);
+
+    auto operation_ctx = proj_create_operation_factory_context(ctx, s_auth.length() ? s_auth.c_str() : nullptr);
     if (!operation_ctx) {
         return nullptr;
     }
@@ -137,10 +485,23 @@ CoordinateTransform^ CoordinateTransform::Create(CoordinateReferenceSystem^ sour
     }
 
     PJ* P = proj_list_get(ctx, op_list, 0);
-
-    if (P == nullptr || op_count == 1 || (options->Area) ||
+    bool single = (op_count == 1 || (options->Area) ||
         sourceCrs->Type == ProjType::GeocentricCrs ||
-        targetCrs->Type == ProjType::GeocentricCrs)
+        targetCrs->Type == ProjType::GeocentricCrs);
+
+    if (P && cacheKey)
+    {
+        try
+        {
+            OperationCache::Store(ctx, cacheKey, sourceCrs, targetCrs, op_list, single);
+        }
+        catch (ProjException^)
+        {
+            // The cache is only an optimization
+        }
+    }
+
+    if (P == nullptr || single)
     {
         proj_list_destroy(op_list);
 
@@ -187,13 +548,13 @@ CoordinateTransform^ CoordinateTransform::CreateSingle(CoordinateReferenceSystem
         // We assume BestOnly
         opts[nOpts++] = "BEST_ONLY=YES"; // Or don't use CreateSingle()
 
-        std::string s_auth;
-        if (!String::IsNullOrEmpty(options->Authority))
-            opts[nOpts++] = (s_auth = utf8_string(String::Format("AUTHORITY={0}", options->Authority))).c_str();
+        utf8_string s_auth(!String::IsNullOrEmpty(options->Authority) ? String::Format("AUTHORITY={0}", options->Authority) : nullptr);
+        if (s_auth.length())
+            opts[nOpts++] = s_auth.c_str();
 
-        std::string s_accuracy;
-        if (options->Accuracy.HasValue)
-            opts[nOpts++] = (s_accuracy = utf8_string(String::Format("ACCURACY=" + options->Accuracy))).c_str();
+        utf8_string s_accuracy(options->Accuracy.HasValue ? String::Format("ACCURACY=" + options->Accuracy) : nullptr);
+        if (s_accuracy.length())
+            opts[nOpts++] = s_accuracy.c_str();
 
         if (options->NoBallparkConversions)
             opts[nOpts++] = "ALLOW_BALLPARK=NO";
@@ -244,8 +605,8 @@ CoordinateTransform^ CoordinateTransform::CreateFromDatabase(String^ authority,
     if (!ctx)
         ctx = gcnew ProjContext();
 
-    std::string authStr = utf8_string(authority);
-    std::string codeStr = utf8_string(code);
+    utf8_string authStr(authority);
+    utf8_string codeStr(code);
     PJ* pj = proj_create_from_database(ctx, authStr.c_str(), codeStr.c_str(), PJ_CATEGORY_COORDINATE_OPERATION, false, nullptr);
 
     if (pj)
@@ -288,7 +649,7 @@ CoordinateTransform^ CoordinateTransform::CreateFromWellKnownText(String^ from,
             }
         }
 
-        std::string fromStr = utf8_string(from);
+        utf8_string fromStr(from);
         PJ* pj = proj_create_from_wkt(ctx, fromStr.c_str(), c_options, &wrs, &errs);
 
         warnings = FromStringList(wrs);
@@ -378,12 +739,36 @@ PPoint CoordinateTransform::DoTransform(bool forward, PPoint% coordinate)
     return FromCoordinate(coord, forward);
 }
 
+FastTransform^ CoordinateTransform::GetFastTransform()
+{
+    if (!m_fastChecked)
+    {
+        m_fast = FastTransform::Create(AsProjString(), Context);
+        m_fastChecked = true;
+    }
+
+    return m_fast;
+}
+
 void CoordinateTransform::DoTransform(bool forward,
     double* xVals, int xStep, int xCount,
     double* yVals, int yStep, int yCount,
     double* zVals, int zStep, int zCount,
     double* tVals, int tStep, int tCount)
 {
+    // The fast paths only handle full ranges; leave broadcasting constants to PROJ
+    if (m_enableFastPaths && xVals && yVals && xCount > 1 && yCount == xCount && xStep > 0 && yStep > 0
+        && (!zVals || zCount <= 0 || (zCount == xCount && zStep > 0)))
+    {
+        FastTransform^ fast = GetFastTransform();
+
+        if (fast)
+        {
+            fast->Apply(forward, xVals, xStep, yVals, yStep, (zVals && zCount > 0) ? zVals : nullptr, zStep, xCount);
+            return;
+        }
+    }
+
     proj_trans_generic(this, forward ? PJ_FWD : PJ_INV,
         xVals, xStep * sizeof(double), xCount,
         yVals, yStep * sizeof(double), yCount,
@@ -397,6 +782,18 @@ void CoordinateTransform::Apply(
     double* zVals, int zStep, int zCount,
     double* tVals, int tStep, int tCount)
 {
+    Context->Flush();
+
+    if (m_hilbertOrder)
+    {
+        DoTransformInHilbertOrder(true,
+            xVals, xStep, xCount,
+            yVals, yStep, yCount,
+            zVals, zStep, zCount,
+            tVals, tStep, tCount);
+        return;
+    }
+
     DoTransform(true,
         xVals, xStep, xCount,
         yVals, yStep, yCount,
@@ -410,6 +807,18 @@ void CoordinateTransform::ApplyReversed(
     double* zVals, int zStep, int zCount,
     double* tVals, int tStep, int tCount)
 {
+    Context->Flush();
+
+    if (m_hilbertOrder)
+    {
+        DoTransformInHilbertOrder(false,
+            xVals, xStep, xCount,
+            yVals, yStep, yCount,
+            zVals, zStep, zCount,
+            tVals, tStep, tCount);
+        return;
+    }
+
     DoTransform(false,
         xVals, xStep, xCount,
         yVals, yStep, yCount,
@@ -442,6 +851,14 @@ CoordinateReferenceSystem^ CoordinateTransform::SourceCRS::get()
     return m_source;
 }
 
+void CoordinateTransform::SetCRS(CoordinateReferenceSystem^ source, CoordinateReferenceSystem^ target)
+{
+    DisposeIfNotNull(m_source);
+    DisposeIfNotNull(m_target);
+
+    m_source = source ? source->Clone(Context) : nullptr;
+    m_target = target ? target->Clone(Context) : nullptr;
+}
 
 CoordinateReferenceSystem^ CoordinateTransform::TargetCRS::get()
 {
@@ -688,6 +1105,722 @@ ReadOnlyCollection<GridUsage^>^ CoordinateTransform::GridUsages::get()
 }
 
 
+#pragma region PrefetchGrids
+// Transforms a lattice over the area, band by band on cloned contexts, so PROJ fetches the grid chunks covering
+// the area concurrently. Fetched chunks end up in the shared grid cache.
+private ref class GridPrefetcher sealed
+{
+private:
+    literal double MinStep = 0.01;
+    literal double MaxSamples = 1000000;
+
+    initonly array<CoordinateTransform^>^ m_transforms;
+    initonly ProjArea^ m_area;
+    initonly double m_step;
+    initonly int m_columns;
+    initonly int m_rows;
+    initonly int m_bands;
+
+public:
+    GridPrefetcher(array<CoordinateTransform^>^ transforms, ProjArea^ area)
+    {
+        m_transforms = transforms;
+        m_area = area;
+
+        double width = area->EastLongitude - area->WestLongitude;
+        double height = area->NorthLatitude - area->SouthLatitude;
+
+        if (width < 0)
+            width += 360; // Crossing the antimeridian
+
+        m_step = Math::Max(MinStep, Math::Sqrt(width * height / MaxSamples));
+        m_columns = (int)Math::Ceiling(width / m_step) + 1;
+        m_rows = (int)Math::Ceiling(height / m_step) + 1;
+        m_bands = Math::Max(1, Math::Min(m_rows, ProjContext::NetworkMaxConnectionsPerServer));
+    }
+
+    property int JobCount
+    {
+        int get()
+        {
+            return m_transforms->Length * m_bands;
+        }
+    }
+
+    void Run(int job)
+    {
+        CoordinateTransform^ source = m_transforms[job / m_bands];
+        int band = job % m_bands;
+        int firstRow = (int)((long long)m_rows * band / m_bands);
+        int lastRow = (int)((long long)m_rows * (band + 1) / m_bands);
+
+        if (lastRow <= firstRow)
+            return;
+
+        int n = (lastRow - firstRow) * m_columns;
+        array<double>^ xs = gcnew array<double>(n);
+        array<double>^ ys = gcnew array<double>(n);
+        array<double>^ zs = gcnew array<double>(n);
+
+        for (int r = firstRow, i = 0; r < lastRow; r++)
+        {
+            double lat = Math::Min(m_area->SouthLatitude + r * m_step, m_area->NorthLatitude);
+
+            for (int c = 0; c < m_columns; c++, i++)
+            {
+                double lon = m_area->WestLongitude + c * m_step;
+
+                if (lon > 180)
+                    lon -= 360;
+
+                xs[i] = lon;
+                ys[i] = lat;
+            }
+        }
+
+        ProjContext^ ctx;
+        CoordinateTransform^ t = nullptr;
+        CoordinateTransform^ toSource = nullptr;
+
+        // Cloning reads the source context
+        System::Threading::Monitor::Enter(this);
+        try
+        {
+            ctx = source->Context->Clone();
+        }
+        finally
+        {
+            System::Threading::Monitor::Exit(this);
+        }
+
+        try
+        {
+            System::Threading::Monitor::Enter(this);
+            try
+            {
+                t = source->Clone(ctx);
+            }
+            finally
+            {
+                System::Threading::Monitor::Exit(this);
+            }
+
+            CoordinateReferenceSystem^ src = t->SourceCRS;
+
+            if (!src || !src->GeodeticCRS)
+                return;
+
+            toSource = CoordinateTransform::Create(src->GeodeticCRS->WithNormalizedAxis(ctx), src, ctx);
+
+            toSource->Apply(xs, ys, zs);
+            t->Apply(xs, ys, zs);
+        }
+        catch (ProjException^ ex)
+        {
+            // Prefetching is best effort. Failures will show up when really transforming
+            ctx->OnLogMessage(ProjLogLevel::Debug, ex->Message);
+        }
+        finally
+        {
+            delete toSource;
+            delete t;
+            delete ctx;
+        }
+    }
+
+    static bool UsesGrids(CoordinateTransform^ t)
+    {
+        ChooseCoordinateTransform^ choose = dynamic_cast<ChooseCoordinateTransform^>(t);
+
+        if (choose)
+            return choose->UsesGrids; // Without instantiating the options
+
+        return t->GridUsages->Count > 0;
+    }
+};
+
+void CoordinateTransform::PrefetchGrids(ProjArea^ area)
+{
+    Context->PrefetchGrids(gcnew array<CoordinateTransform^> { this }, area);
+}
+
+void ProjContext::PrefetchGrids(System::Collections::Generic::IEnumerable<CoordinateTransform^>^ transforms, ProjArea^ area)
+{
+    if (!transforms)
+        throw gcnew ArgumentNullException("transforms");
+    else if (!area)
+        throw gcnew ArgumentNullException("area");
+    else if (!EnableNetworkConnections)
+        return;
+
+    auto todo = gcnew List<CoordinateTransform^>();
+
+    for each (CoordinateTransform ^ t in transforms)
+    {
+        if (t && GridPrefetcher::UsesGrids(t))
+            todo->Add(t);
+    }
+
+    if (!todo->Count)
+        return;
+
+    GridPrefetcher^ p = gcnew GridPrefetcher(todo->ToArray(), area);
+    auto options = gcnew System::Threading::Tasks::ParallelOptions();
+    options->MaxDegreeOfParallelism = ProjContext::NetworkMaxConnectionsPerServer;
+
+    System::Threading::Tasks::Parallel::For(0, p->JobCount, options, gcnew Action<int>(p, &GridPrefetcher::Run));
+}
+#pragma endregion
+
+
+#pragma region CreateTransforms
+private ref class TransformBuilder sealed
+{
+private:
+    ref class Worker sealed
+    {
+    public:
+        ProjContext^ Context;
+        System::Collections::Generic::Dictionary<CoordinateReferenceSystem^, CoordinateReferenceSystem^>^ Crs;
+    };
+
+    initonly ProjContext^ m_ctx;
+    initonly array<CoordinateTransformRequest^>^ m_requests;
+    initonly array<CoordinateTransformResult^>^ m_results;
+
+public:
+    TransformBuilder(ProjContext^ ctx, array<CoordinateTransformRequest^>^ requests)
+    {
+        m_ctx = ctx;
+        m_requests = requests;
+        m_results = gcnew array<CoordinateTransformResult^>(requests->Length);
+    }
+
+    property array<CoordinateTransformResult^>^ Results
+    {
+        array<CoordinateTransformResult^>^ get()
+        {
+            return m_results;
+        }
+    }
+
+    Object^ CreateWorker()
+    {
+        Worker^ w = gcnew Worker();
+
+        // Cloning reads the source context
+        System::Threading::Monitor::Enter(this);
+        try
+        {
+            w->Context = m_ctx->Clone();
+        }
+        finally
+        {
+            System::Threading::Monitor::Exit(this);
+        }
+        w->Crs = gcnew System::Collections::Generic::Dictionary<CoordinateReferenceSystem^, CoordinateReferenceSystem^>();
+        return w;
+    }
+
+    Object^ Run(int i, System::Threading::Tasks::ParallelLoopState^ state, Object^ worker)
+    {
+        Worker^ w = static_cast<Worker^>(worker);
+        CoordinateTransformRequest^ rq = m_requests[i];
+
+        try
+        {
+            if (!rq)
+                throw gcnew ArgumentNullException("requests");
+
+            CoordinateTransform^ t = CoordinateTransform::Create(GetCrs(w, rq->SourceCrs), GetCrs(w, rq->TargetCrs), rq->Options, w->Context);
+
+            try
+            {
+                // The result lives on the caller's context, like the crs objects of the request
+                System::Threading::Monitor::Enter(this);
+                try
+                {
+                    m_results[i] = gcnew CoordinateTransformResult(rq, t->Clone(m_ctx), nullptr);
+                }
+                finally
+                {
+                    System::Threading::Monitor::Exit(this);
+                }
+            }
+            finally
+            {
+                delete t;
+            }
+        }
+        catch (Exception^ ex)
+        {
+            m_results[i] = gcnew CoordinateTransformResult(rq, nullptr, ex);
+        }
+        return worker;
+    }
+
+    void ReleaseWorker(Object^ worker)
+    {
+        Worker^ w = static_cast<Worker^>(worker);
+
+        for each (CoordinateReferenceSystem^ crs in w->Crs->Values)
+            delete crs;
+
+        delete w->Context;
+    }
+
+private:
+    // The caller's crs objects belong to another context. Use a clone on the worker's context
+    static CoordinateReferenceSystem^ GetCrs(Worker^ w, CoordinateReferenceSystem^ crs)
+    {
+        CoordinateReferenceSystem^ c;
+
+        if (!w->Crs->TryGetValue(crs, c))
+            w->Crs[crs] = c = crs->Clone(w->Context);
+
+        return c;
+    }
+};
+
+System::Collections::ObjectModel::ReadOnlyCollection<CoordinateTransformResult^>^ ProjContext::CreateTransforms(System::Collections::Generic::IEnumerable<CoordinateTransformRequest^>^ requests)
+{
+    if (!requests)
+        throw gcnew ArgumentNullException("requests");
+
+    TransformBuilder^ b = gcnew TransformBuilder(this, Enumerable::ToArray(requests));
+
+    // A bounded set of worker contexts, each with its own connection to proj.db
+    auto options = gcnew System::Threading::Tasks::ParallelOptions();
+    options->MaxDegreeOfParallelism = Environment::ProcessorCount;
+
+    System::Threading::Tasks::Parallel::For<Object^>(0, b->Results->Length, options,
+        gcnew Func<Object^>(b, &TransformBuilder::CreateWorker),
+        gcnew Func<int, System::Threading::Tasks::ParallelLoopState^, Object^, Object^>(b, &TransformBuilder::Run),
+        gcnew Action<Object^>(b, &TransformBuilder::ReleaseWorker));
+
+    return Array::AsReadOnly(b->Results);
+}
+#pragma endregion
+
+#pragma region Then
+static CoordinateTransform^ FuseTransforms(CoordinateTransform^ first, CoordinateTransform^ second, ProjContext^ ctx)
+{
+    // No PROJ definition for ChooseCoordinateTransform, chains and operations PROJ can't export
+    String^ a = first->AsProjString();
+    String^ b = a ? second->AsProjString() : nullptr;
+    String^ definition = b ? PipelineStep::Fuse(a, b) : nullptr;
+
+    if (!definition)
+        return nullptr;
+
+    PJ* pj = proj_create(ctx, ::utf8_string(definition).c_str());
+
+    if (!pj)
+        return nullptr; // Run the stages separately
+
+    CoordinateTransform^ t = ctx->Create<CoordinateTransform^>(pj);
+    t->SetCRS(first->SourceCRS, second->TargetCRS);
+    return t;
+}
+
+static void AddStage(System::Collections::Generic::List<CoordinateTransform^>^ stages, System::Collections::Generic::List<bool>^ owned, CoordinateTransform^ t, ProjContext^ ctx)
+{
+    int n = stages->Count;
+
+    if (n)
+    {
+        CoordinateTransform^ fused = FuseTransforms(stages[n - 1], t, ctx);
+
+        if (fused)
+        {
+            if (owned[n - 1])
+            {
+                CoordinateTransform^ last = stages[n - 1];
+                delete last;
+            }
+
+            stages[n - 1] = fused;
+            owned[n - 1] = true;
+            return;
+        }
+    }
+
+    stages->Add(t);
+    owned->Add(false);
+}
+
+CoordinateTransform^ CoordinateTransform::Then(CoordinateTransform^ next, ProjContext^ ctx)
+{
+    if (!next)
+        throw gcnew ArgumentNullException("next");
+
+    if (!ctx)
+        ctx = Context;
+
+    // The output of this transform is the input of next
+    CoordinateReferenceSystem^ target = TargetCRS;
+    CoordinateReferenceSystem^ source = next->SourceCRS;
+
+    if (target && source && !target->IsEquivalentToRelaxed(source, ctx))
+        throw gcnew ArgumentException(String::Format("The transform starts at {0}, not at the target crs {1}", source->Name, target->Name), "next");
+
+    auto stages = gcnew System::Collections::Generic::List<CoordinateTransform^>();
+    auto owned = gcnew System::Collections::Generic::List<bool>();
+
+    for each (CoordinateTransform ^ t in gcnew array<CoordinateTransform^> { this, next })
+    {
+        ChainedCoordinateTransform^ chain = dynamic_cast<ChainedCoordinateTransform^>(t);
+
+        if (chain)
+        {
+            for each (CoordinateTransform ^ c in chain)
+                AddStage(stages, owned, c, ctx);
+        }
+        else
+            AddStage(stages, owned, t, ctx);
+    }
+
+    if (stages->Count == 1 && owned[0])
+        return stages[0];
+
+    return gcnew ChainedCoordinateTransform(ctx, stages->ToArray(), owned->ToArray());
+}
+#pragma endregion
+
+#pragma region Epochs
+static bool SameEpoch(double a, double b)
+{
+    return a == b || (Double::IsNaN(a) && Double::IsNaN(b));
+}
+
+void CoordinateTransform::DoTransformByEpoch(bool forward,
+    double* xVals, int xStep, int xCount,
+    double* yVals, int yStep, int yCount,
+    double* zVals, int zStep, int zCount,
+    double* tVals, int tStep, int tCount)
+{
+    int n = tCount;
+
+    // Grouping needs a full range of coordinates with an epoch per point
+    if (!tVals || n < 2 || !xVals || !yVals || xCount != n || yCount != n)
+    {
+        DoTransform(forward, xVals, xStep, xCount, yVals, yStep, yCount, zVals, zStep, zCount, tVals, tStep, tCount);
+        return;
+    }
+
+    array<double>^ epochs = gcnew array<double>(n);
+    array<int>^ order = gcnew array<int>(n);
+    int runs = 1;
+
+    for (int i = 0; i < n; i++)
+    {
+        epochs[i] = tVals[(ptrdiff_t)i * tStep];
+        order[i] = i;
+
+        if (i && !SameEpoch(epochs[i], epochs[i - 1]))
+            runs++;
+    }
+
+    Array::Sort(epochs, order);
+
+    int groups = 1;
+    for (int i = 1; i < n; i++)
+    {
+        if (!SameEpoch(epochs[i], epochs[i - 1]))
+            groups++;
+    }
+
+    // When the points are already grouped, PROJ reuses the epoch dependent parameters of the previous point by itself.
+    // And when few points share an epoch, gathering them costs more than it saves
+    if (runs == groups || groups * 4 > n)
+    {
+        DoTransform(forward, xVals, xStep, xCount, yVals, yStep, yCount, zVals, zStep, zCount, tVals, tStep, tCount);
+        return;
+    }
+
+    // Gather the coordinates in epoch order. A constant z is expanded, as each group updates it
+    int dims = (zVals && zCount > 0) ? 3 : 2;
+    double* vals[3] = { xVals, yVals, zVals };
+    int steps[3] = { xStep, yStep, zStep };
+    int counts[3] = { xCount, yCount, zCount };
+
+    array<double>^ buffer = gcnew array<double>(dims * n);
+    pin_ptr<double> pBuffer = &buffer[0];
+
+    for (int d = 0; d < dims; d++)
+    {
+        double* to = pBuffer + (ptrdiff_t)d * n;
+
+        for (int k = 0; k < n; k++)
+            to[k] = (counts[d] == n) ? vals[d][(ptrdiff_t)order[k] * steps[d]] : *vals[d];
+    }
+
+    // Transform each group with its epoch as constant, so the epoch dependent parameters are set up once per group
+    for (int start = 0; start < n;)
+    {
+        int end = start + 1;
+        while (end < n && SameEpoch(epochs[end], epochs[start]))
+            end++;
+
+        int cnt = end - start;
+        double t = epochs[start];
+
+        DoTransform(forward,
+            pBuffer + start, 1, cnt,
+            pBuffer + n + start, 1, cnt,
+            (dims > 2) ? pBuffer + 2 * n + start : nullptr, 1, (dims > 2) ? cnt : 0,
+            &t, 0, 1);
+
+        for (int k = start; k < end; k++)
+            epochs[k] = t;
+
+        start = end;
+    }
+
+    // And scatter the results back to their original positions
+    for (int k = 0; k < n; k++)
+    {
+        ptrdiff_t i = order[k];
+
+        for (int d = 0; d < dims; d++)
+        {
+            double v = pBuffer[(ptrdiff_t)d * n + k];
+
+            if (counts[d] == n)
+                vals[d][i * steps[d]] = v;
+            else if (i == n - 1)
+                *vals[d] = v; // Like proj_trans_generic(): the constant receives the value of the last point
+        }
+
+        tVals[i * tStep] = epochs[k];
+    }
+}
+
+void CoordinateTransform::TransformByEpoch(bool forward, array<array<double>^>^ ordinateArrays)
+{
+    if (ordinateArrays == nullptr || ordinateArrays->Length == 0)
+        return;
+    else if (ordinateArrays->Length < 2 || ordinateArrays->Length > 4)
+        throw gcnew ArgumentException("Invalid number of ordinate values");
+
+    array<String^>^ names = gcnew array<String^> { "X", "Y", "Z", "T" };
+    int l = ordinateArrays[0] != nullptr ? ordinateArrays[0]->Length : 0;
+
+    for (int i = 0; i < ordinateArrays->Length; i++)
+    {
+        if (ordinateArrays[i] != nullptr && ordinateArrays[i]->Length != l && ordinateArrays[i]->Length != 0)
+            throw gcnew ArgumentException(String::Format("Invalid length of {0} array", names[i]));
+    }
+
+    if (!l)
+        return;
+
+    array<double>^ empty = gcnew array<double>(1);
+    array<double>^ x = ordinateArrays[0];
+    array<double>^ y = (ordinateArrays[1] && ordinateArrays[1]->Length) ? ordinateArrays[1] : empty;
+    array<double>^ z = (ordinateArrays->Length > 2 && ordinateArrays[2] && ordinateArrays[2]->Length) ? ordinateArrays[2] : empty;
+    array<double>^ t = (ordinateArrays->Length > 3 && ordinateArrays[3] && ordinateArrays[3]->Length) ? ordinateArrays[3] : empty;
+
+    pin_ptr<double> pX = &x[0];
+    pin_ptr<double> pY = &y[0];
+    pin_ptr<double> pZ = &z[0];
+    pin_ptr<double> pT = &t[0];
+
+    Context->Flush();
+    DoTransformByEpoch(forward,
+        pX, 1, l,
+        (y != empty) ? (double*)pY : nullptr, 1, (y != empty) ? l : 0,
+        (z != empty) ? (double*)pZ : nullptr, 1, (z != empty) ? l : 0,
+        (t != empty) ? (double*)pT : nullptr, 1, (t != empty) ? l : 0);
+}
+
+void CoordinateTransform::ApplyByEpoch(...array<array<double>^>^ ordinateArrays)
+{
+    TransformByEpoch(true, ordinateArrays);
+}
+
+void CoordinateTransform::ApplyReversedByEpoch(...array<array<double>^>^ ordinateArrays)
+{
+    TransformByEpoch(false, ordinateArrays);
+}
+
+void CoordinateTransform::TransformAtEpoch(bool forward, CoordinateMetadata^ metadata, array<array<double>^>^ ordinateArrays)
+{
+    if (!metadata)
+        throw gcnew ArgumentNullException("metadata");
+
+    Nullable<double> epoch = metadata->Epoch;
+
+    if (!epoch.HasValue)
+        throw gcnew ArgumentException("The coordinate metadata has no epoch", "metadata");
+
+    // The epoch only applies to coordinates in the crs the metadata describes
+    CoordinateReferenceSystem^ crs = forward ? SourceCRS : TargetCRS;
+    CoordinateReferenceSystem^ metadataCrs = metadata->CRS;
+
+    if (crs && metadataCrs && !metadataCrs->IsEquivalentToRelaxed(crs, Context))
+        throw gcnew ArgumentException(String::Format("The coordinate metadata is for {0}, not for the {1} crs {2}", metadataCrs->Name, forward ? "source" : "target", crs->Name), "metadata");
+
+    if (ordinateArrays == nullptr || ordinateArrays->Length == 0)
+        return;
+    else if (ordinateArrays->Length < 2 || ordinateArrays->Length > 3)
+        throw gcnew ArgumentException("Expected X, Y and optionally Z arrays; the epoch is that of the metadata", "ordinateArrays");
+
+    int l = ordinateArrays[0] != nullptr ? ordinateArrays[0]->Length : 0;
+
+    for (int i = 0; i < ordinateArrays->Length; i++)
+    {
+        if (ordinateArrays[i] == nullptr || ordinateArrays[i]->Length != l)
+        {
+            if (i == 2 && (ordinateArrays[i] == nullptr || ordinateArrays[i]->Length == 0))
+                continue;
+
+            throw gcnew ArgumentException(i ? "Invalid length of Y or Z array" : "Invalid X array", "ordinateArrays");
+        }
+    }
+
+    if (!l)
+        return;
+
+    bool hasZ = ordinateArrays->Length > 2 && ordinateArrays[2] && ordinateArrays[2]->Length;
+    pin_ptr<double> pX = &ordinateArrays[0][0];
+    pin_ptr<double> pY = &ordinateArrays[1][0];
+    pin_ptr<double> pZ;
+    if (hasZ)
+        pZ = &ordinateArrays[2][0];
+
+    // A single epoch for all points: passed as constant, so PROJ sets up the epoch dependent parameters once
+    double t = epoch.Value;
+
+    Context->Flush();
+    DoTransform(forward,
+        pX, 1, l,
+        pY, 1, l,
+        pZ, 1, hasZ ? l : 0,
+        &t, 0, 1);
+}
+
+void CoordinateTransform::Apply(CoordinateMetadata^ metadata, ...array<array<double>^>^ ordinateArrays)
+{
+    TransformAtEpoch(true, metadata, ordinateArrays);
+}
+
+void CoordinateTransform::ApplyReversed(CoordinateMetadata^ metadata, ...array<array<double>^>^ ordinateArrays)
+{
+    TransformAtEpoch(false, metadata, ordinateArrays);
+}
+#pragma endregion
+
+#pragma region HilbertOrder
+void CoordinateTransform::DoTransformInHilbertOrder(bool forward,
+    double* xVals, int xStep, int xCount,
+    double* yVals, int yStep, int yCount,
+    double* zVals, int zStep, int zCount,
+    double* tVals, int tStep, int tCount)
+{
+    // Below this the points share the few grid blocks they touch anyway
+    const int MinPoints = 256;
+    int n = xCount;
+
+    if (!xVals || !yVals || n < MinPoints || yCount != n || xStep <= 0 || yStep <= 0)
+    {
+        DoTransform(forward, xVals, xStep, xCount, yVals, yStep, yCount, zVals, zStep, zCount, tVals, tStep, tCount);
+        return;
+    }
+
+    double minX = double::PositiveInfinity, minY = double::PositiveInfinity;
+    double maxX = double::NegativeInfinity, maxY = double::NegativeInfinity;
+
+    for (int i = 0; i < n; i++)
+    {
+        double x = xVals[(ptrdiff_t)i * xStep];
+        double y = yVals[(ptrdiff_t)i * yStep];
+
+        if (Double::IsInfinity(x) || Double::IsNaN(x) || Double::IsInfinity(y) || Double::IsNaN(y))
+            continue;
+
+        minX = Math::Min(minX, x);
+        maxX = Math::Max(maxX, x);
+        minY = Math::Min(minY, y);
+        maxY = Math::Max(maxY, y);
+    }
+
+    if (minX > maxX)
+    {
+        // No usable coordinates
+        DoTransform(forward, xVals, xStep, xCount, yVals, yStep, yCount, zVals, zStep, zCount, tVals, tStep, tCount);
+        return;
+    }
+
+    array<unsigned int>^ keys = gcnew array<unsigned int>(n);
+    array<int>^ order = gcnew array<int>(n);
+
+    for (int i = 0; i < n; i++)
+    {
+        double x = xVals[(ptrdiff_t)i * xStep];
+        double y = yVals[(ptrdiff_t)i * yStep];
+
+        // Failed and invalid coordinates at the end
+        if (Double::IsInfinity(x) || Double::IsNaN(x) || Double::IsInfinity(y) || Double::IsNaN(y))
+            keys[i] = UInt32::MaxValue;
+        else
+            keys[i] = hilbert_index(x, y, minX, minY, maxX, maxY);
+        order[i] = i;
+    }
+
+    Array::Sort(keys, order);
+
+    // Gather the coordinates in curve order. Constants are expanded, like proj_trans_generic() broadcasts them
+    double* vals[4] = { xVals, yVals, zVals, tVals };
+    int steps[4] = { xStep, yStep, zStep, tStep };
+    int counts[4] = { xCount, yCount, (zVals && zStep >= 0) ? zCount : 0, (tVals && tStep >= 0) ? tCount : 0 };
+    double* p[4] = { nullptr, nullptr, nullptr, nullptr };
+    int dims = 0;
+
+    for (int d = 0; d < 4; d++)
+    {
+        if (counts[d] == n || counts[d] == 1)
+            dims++;
+        else
+            counts[d] = 0; // Like proj_trans_generic(): ignored
+    }
+
+    array<double>^ buffer = gcnew array<double>(dims * n);
+    pin_ptr<double> pBuffer = &buffer[0];
+
+    for (int d = 0, slot = 0; d < 4; d++)
+    {
+        if (!counts[d])
+            continue;
+
+        p[d] = pBuffer + (ptrdiff_t)(slot++) * n;
+
+        for (int k = 0; k < n; k++)
+            p[d][k] = (counts[d] == n) ? vals[d][(ptrdiff_t)order[k] * steps[d]] : *vals[d];
+    }
+
+    DoTransform(forward,
+        p[0], 1, n,
+        p[1], 1, n,
+        p[2], 1, p[2] ? n : 0,
+        p[3], 1, p[3] ? n : 0);
+
+    // And scatter the results back to their original positions
+    for (int k = 0; k < n; k++)
+    {
+        ptrdiff_t i = order[k];
+
+        for (int d = 0; d < 4; d++)
+        {
+            if (counts[d] == n)
+                vals[d][i * steps[d]] = p[d][k];
+            else if (counts[d] && i == n - 1)
+                *vals[d] = p[d][k]; // Like proj_trans_generic(): the constant receives the value of the last point
+        }
+    }
+}
+#pragma endregion
+
 #pragma region ApplyInPlace
 void CoordinateTransform::Apply(...array<array<double>^>^ ordinateArrays)
 {
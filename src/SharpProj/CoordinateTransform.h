@@ -14,6 +14,7 @@ namespace SharpProj {
     ref class CoordinateTransformOptions;
     ref class CoordinateOperation;
     ref class CoordinateTransformList;
+    ref class FastTransform;
 
 
     using System::Collections::ObjectModel::ReadOnlyCollection;
@@ -25,6 +26,8 @@ namespace SharpProj {
         ref class ProjOperation;
         ref class ProjOperationList;
         ref class GridUsage;
+        ref class ProjArea;
+        ref class CoordinateMetadata;
 
         public ref class CoordinateTransformFactors
         {
@@ -281,6 +284,14 @@ namespace SharpProj {
         struct geod_geodesic* m_pgeod;
         [DebuggerBrowsable(DebuggerBrowsableState::Never)]
         ReadOnlyCollection<GridUsage^>^ m_gridUsages;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        FastTransform^ m_fast;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        bool m_fastChecked;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        bool m_hilbertOrder;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        bool m_enableFastPaths;
 
 
     protected:
@@ -366,6 +377,49 @@ namespace SharpProj {
         /// <param name="ordinateArray"></param>
         void ApplyReversed(array<double, 2>^ ordinateArray);
 
+        /// <summary>
+        /// Transforms a series of coordinates in-place like <see cref="Apply(array{array{double}})" />, with an epoch per coordinate
+        /// in the T array. The coordinates are transformed grouped by epoch, so time dependent operations (like plate motion models
+        /// and time dependent Helmert transforms) set up their epoch dependent parameters once per group instead of per coordinate.
+        /// The results are stored at the original positions.
+        /// </summary>
+        /// <param name="ordinateArrays">The X, Y, Z and T arrays</param>
+        void ApplyByEpoch(...array<array<double>^>^ ordinateArrays);
+
+        /// <summary>
+        /// Transforms a series of coordinates backwards like <see cref="ApplyByEpoch" />
+        /// </summary>
+        /// <param name="ordinateArrays">The X, Y, Z and T arrays</param>
+        void ApplyReversedByEpoch(...array<array<double>^>^ ordinateArrays);
+
+        /// <summary>
+        /// Transforms a series of coordinates in-place, all at the epoch of <paramref name="metadata"/>, which must describe the <see cref="SourceCRS" />
+        /// </summary>
+        /// <param name="metadata">Coordinate metadata with the epoch of the dataset</param>
+        /// <param name="ordinateArrays">The X, Y and optionally Z arrays</param>
+        void Apply(Proj::CoordinateMetadata^ metadata, ...array<array<double>^>^ ordinateArrays);
+
+        /// <summary>
+        /// Transforms a series of coordinates backwards in-place, all at the epoch of <paramref name="metadata"/>, which must describe the <see cref="TargetCRS" />
+        /// </summary>
+        /// <param name="metadata">Coordinate metadata with the epoch of the dataset</param>
+        /// <param name="ordinateArrays">The X, Y and optionally Z arrays</param>
+        void ApplyReversed(Proj::CoordinateMetadata^ metadata, ...array<array<double>^>^ ordinateArrays);
+
+    private:
+        void TransformByEpoch(bool forward, array<array<double>^>^ ordinateArrays);
+        void TransformAtEpoch(bool forward, Proj::CoordinateMetadata^ metadata, array<array<double>^>^ ordinateArrays);
+        void DoTransformByEpoch(bool forward,
+            double* xVals, int xStep, int xCount,
+            double* yVals, int yStep, int yCount,
+            double* zVals, int zStep, int zCount,
+            double* tVals, int tStep, int tCount);
+        void DoTransformInHilbertOrder(bool forward,
+            double* xVals, int xStep, int xCount,
+            double* yVals, int yStep, int yCount,
+            double* zVals, int zStep, int zCount,
+            double* tVals, int tStep, int tCount);
+
     protected:
         /// <summary>
         /// Implements <see cref="Apply(PPoint)" /> and <see cref="ApplyReversed(PPoint)" />
@@ -386,6 +440,21 @@ namespace SharpProj {
     internal:
         PPoint FromCoordinate(const PJ_COORD& coord, bool forward);
 
+        // Sets the source and target crs of transforms that don't have them in their PJ, like fused pipelines
+        void SetCRS(CoordinateReferenceSystem^ source, CoordinateReferenceSystem^ target);
+
+    public:
+        /// <summary>
+        /// Creates a transform that applies this transform followed by <paramref name="next"/>. When both are plain PROJ
+        /// operations they are fused into a single PROJ pipeline, dropping inverse/forward step pairs that cancel each other
+        /// (like the axis swaps and unit conversions around the shared crs). Otherwise the stages are kept and run block by block.
+        /// </summary>
+        /// <param name="next">Transform from the target of this transform; throws <see cref="ArgumentException"/> when its source crs is a different one</param>
+        /// <param name="ctx"></param>
+        /// <returns></returns>
+        /// <remarks>The result may use this transform and <paramref name="next"/>, so keep them alive while using it</remarks>
+        CoordinateTransform^ Then(CoordinateTransform^ next, [Optional] ProjContext^ ctx);
+
     public:
         CoordinateTransform^ Clone([Optional]ProjContext^ ctx) new
         {
@@ -407,6 +476,13 @@ namespace SharpProj {
             virtual ReadOnlyCollection<GridUsage^>^ get();
         }
 
+        /// <summary>
+        /// Fetches the parts of the grids used by this transform that cover <paramref name="area"/> into the grid cache,
+        /// so transforming coordinates in that area needs no further network round trips.
+        /// </summary>
+        /// <param name="area"></param>
+        void PrefetchGrids(Proj::ProjArea^ area);
+
         property Nullable<double> Accuracy
         {
             Nullable<double> virtual get()
@@ -562,6 +638,56 @@ namespace SharpProj {
     private protected:
         virtual ProjObject^ DoClone(ProjContext^ ctx) override;
 
+    private:
+        FastTransform^ GetFastTransform();
+
+    internal:
+        // Whether ranges of coordinates are transformed by a FastTransform when EnableFastPaths is set
+        property bool UsesFastPath
+        {
+            bool get()
+            {
+                return GetFastTransform() != nullptr;
+            }
+        }
+
+    public:
+        /// <summary>
+        /// Gets or sets whether ranges of coordinates are transformed by vectorized implementations of recognized pipelines
+        /// (like operations consisting of only affine, Helmert, axis swap and unit conversion steps, optionally around one Web Mercator
+        /// or Transverse Mercator/UTM projection) instead of PROJ. Results may differ from PROJ's in the sub-millimeter range, and
+        /// coordinates that can't be transformed are set to infinity without setting the PROJ error state or logging. Defaults to false.
+        /// </summary>
+        property bool EnableFastPaths
+        {
+            bool get()
+            {
+                return m_enableFastPaths;
+            }
+            void set(bool value)
+            {
+                m_enableFastPaths = value;
+            }
+        }
+
+        /// <summary>
+        /// Gets or sets whether ranges of coordinates are transformed in the order of a Hilbert curve over their source X and Y, with
+        /// the results stored at their original positions. This keeps nearby points together, so grid based operations (like NTv2 and
+        /// geoid grids) read each part of their grids once, instead of thrashing the grid block cache and network reads when the points
+        /// arrive in random order. Defaults to false.
+        /// </summary>
+        property bool HilbertOrder
+        {
+            bool get()
+            {
+                return m_hilbertOrder;
+            }
+            void set(bool value)
+            {
+                m_hilbertOrder = value;
+            }
+        }
+
     public:
         static CoordinateTransform^ Create(CoordinateReferenceSystem^ sourceCrs, CoordinateReferenceSystem^ targetCrs, CoordinateTransformOptions^ options, [Optional] ProjContext^ ctx);
         static CoordinateTransform^ Create(CoordinateReferenceSystem^ sourceCrs, CoordinateReferenceSystem^ targetCrs, CoordinateArea^ area, [Optional] ProjContext^ ctx)
@@ -708,4 +834,85 @@ namespace SharpProj {
         }
     };
 
+    /// <summary>
+    /// A source and target pair for <see cref="ProjContext" />.CreateTransforms()
+    /// </summary>
+    [DebuggerDisplay("{SourceCrs} -> {TargetCrs}")]
+    public ref class CoordinateTransformRequest sealed
+    {
+    public:
+        CoordinateTransformRequest(CoordinateReferenceSystem^ sourceCrs, CoordinateReferenceSystem^ targetCrs, [Optional] CoordinateTransformOptions^ options)
+        {
+            if (!sourceCrs)
+                throw gcnew ArgumentNullException("sourceCrs");
+            else if (!targetCrs)
+                throw gcnew ArgumentNullException("targetCrs");
+
+            SourceCrs = sourceCrs;
+            TargetCrs = targetCrs;
+            Options = options;
+        }
+
+        property CoordinateReferenceSystem^ SourceCrs;
+        property CoordinateReferenceSystem^ TargetCrs;
+        property CoordinateTransformOptions^ Options;
+    };
+
+    /// <summary>
+    /// Outcome of one <see cref="CoordinateTransformRequest" />: the transform, or the exception that creating it threw
+    /// </summary>
+    public ref class CoordinateTransformResult sealed
+    {
+    private:
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        initonly CoordinateTransformRequest^ m_request;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        initonly CoordinateTransform^ m_transform;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        initonly Exception^ m_error;
+
+    internal:
+        CoordinateTransformResult(CoordinateTransformRequest^ request, CoordinateTransform^ transform, Exception^ error)
+        {
+            m_request = request;
+            m_transform = transform;
+            m_error = error;
+        }
+
+    public:
+        property CoordinateTransformRequest^ Request
+        {
+            CoordinateTransformRequest^ get()
+            {
+                return m_request;
+            }
+        }
+
+        /// <summary>
+        /// Gets the transform, or null when creating it failed
+        /// </summary>
+        property CoordinateTransform^ Transform
+        {
+            CoordinateTransform^ get()
+            {
+                return m_transform;
+            }
+        }
+
+        property Exception^ Error
+        {
+            Exception^ get()
+            {
+                return m_error;
+            }
+        }
+
+        property bool Succeeded
+        {
+            bool get()
+            {
+                return m_transform != nullptr;
+            }
+        }
+    };
 }
\ No newline at end of file
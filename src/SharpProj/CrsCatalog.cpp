@@ -0,0 +1,564 @@
+#include "pch.h"
+#include "ProjContext.h"
+#include "ProjArea.h"
+#include "CoordinateReferenceSystemInfo.h"
+#include "CrsCatalog.h"
+#include "HilbertCurve.h"
+
+using System::Collections::Generic::Dictionary;
+using System::Collections::Generic::HashSet;
+using System::Collections::Generic::KeyValuePair;
+
+private ref class CrsOrderComparer sealed : System::Collections::Generic::IComparer<int>
+{
+    initonly array<String^>^ m_authorities;
+    initonly array<String^>^ m_names;
+    initonly array<long long>^ m_codes;
+
+public:
+    CrsOrderComparer(array<String^>^ authorities, array<String^>^ codes, array<String^>^ names)
+    {
+        m_authorities = authorities;
+        m_names = names;
+        m_codes = gcnew array<long long>(codes->Length);
+
+        // Parse once, instead of on every comparison
+        for (int i = 0; i < codes->Length; i++)
+        {
+            int v;
+            m_codes[i] = int::TryParse(codes[i], v) ? v : Int64::MinValue;
+        }
+    }
+
+    virtual int Compare(int x, int y)
+    {
+        int n = StringComparer::OrdinalIgnoreCase->Compare(m_authorities[x], m_authorities[y]);
+        if (n != 0)
+            return n;
+
+        if (m_codes[x] != Int64::MinValue && m_codes[y] != Int64::MinValue && m_codes[x] != m_codes[y])
+            return (m_codes[x] < m_codes[y]) ? -1 : 1;
+
+        n = StringComparer::OrdinalIgnoreCase->Compare(m_names[x], m_names[y]);
+        if (n != 0)
+            return n;
+
+        return x - y; // Array::Sort is not stable
+    }
+};
+
+array<int>^ CrsCatalog::SortOrder(array<String^>^ authorities, array<String^>^ codes, array<String^>^ names)
+{
+    array<int>^ order = gcnew array<int>(codes->Length);
+
+    for (int i = 0; i < order->Length; i++)
+        order[i] = i;
+
+    Array::Sort(order, gcnew CrsOrderComparer(authorities, codes, names));
+    return order;
+}
+
+static long long trigram(String^ s, int i)
+{
+    return ((long long)s[i] << 32) | ((long long)s[i + 1] << 16) | (long long)s[i + 2];
+}
+
+CrsCatalog::CrsCatalog(ProjContext^ ctx)
+{
+    int count;
+    PROJ_CRS_LIST_PARAMETERS* params = proj_get_crs_list_parameters_create();
+    PROJ_CRS_INFO** infoList = nullptr;
+
+    try
+    {
+        params->allow_deprecated = true;
+        infoList = proj_get_crs_info_list_from_database(ctx, nullptr, params, &count);
+
+        if (!infoList)
+            throw ctx->ConstructException("GetCrsCatalog");
+
+        array<String^>^ authorities = gcnew array<String^>(count);
+        array<String^>^ codes = gcnew array<String^>(count);
+        array<String^>^ names = gcnew array<String^>(count);
+
+        for (int i = 0; i < count; i++)
+        {
+            authorities[i] = Utf8_PtrToString(infoList[i]->auth_name);
+            codes[i] = Utf8_PtrToString(infoList[i]->code);
+            names[i] = Utf8_PtrToString(infoList[i]->name);
+        }
+
+        array<int>^ order = SortOrder(authorities, codes, names);
+
+        m_codes = gcnew array<String^>(count);
+        m_names = gcnew array<String^>(count);
+        m_authority = gcnew array<unsigned short>(count);
+        m_areaName = gcnew array<unsigned short>(count);
+        m_projectionName = gcnew array<unsigned short>(count);
+        m_celestialBodyName = gcnew array<unsigned short>(count);
+        m_types = gcnew array<ProjType>(count);
+        m_deprecated = gcnew array<bool>(count);
+        m_bbox = gcnew array<double>(4 * count);
+        m_infos = gcnew array<CoordinateReferenceSystemInfo^>(count);
+
+        // Authorities, areas, projection methods and bodies repeat a lot. Store them once
+        Dictionary<String^, int>^ stringIndex = gcnew Dictionary<String^, int>();
+        System::Collections::Generic::List<String^>^ strings = gcnew System::Collections::Generic::List<String^>();
+        stringIndex[String::Empty] = 0;
+        strings->Add(nullptr);
+
+        for (int i = 0; i < count; i++)
+        {
+            const PROJ_CRS_INFO* info = infoList[order[i]];
+            array<String^>^ values = gcnew array<String^> { authorities[order[i]], Utf8_PtrToString(info->area_name),
+                Utf8_PtrToString(info->projection_method_name), Utf8_PtrToString(info->celestial_body_name) };
+            array<unsigned short>^ idx = gcnew array<unsigned short>(values->Length);
+
+            for (int j = 0; j < values->Length; j++)
+            {
+                int si;
+                String^ v = values[j] ? values[j] : String::Empty;
+
+                if (!stringIndex->TryGetValue(v, si))
+                {
+                    si = strings->Count;
+                    if (si > UInt16::MaxValue)
+                        throw gcnew InvalidOperationException("Too many distinct strings in database");
+
+                    strings->Add(v);
+                    stringIndex[v] = si;
+                }
+                idx[j] = (unsigned short)si;
+            }
+
+            m_codes[i] = codes[order[i]];
+            m_names[i] = names[order[i]];
+            m_authority[i] = idx[0];
+            m_areaName[i] = idx[1];
+            m_projectionName[i] = idx[2];
+            m_celestialBodyName[i] = idx[3];
+            m_types[i] = (ProjType)info->type;
+            m_deprecated[i] = (0 != info->deprecated);
+
+            if (info->bbox_valid)
+            {
+                m_bbox[4 * i + 0] = info->west_lon_degree;
+                m_bbox[4 * i + 1] = info->south_lat_degree;
+                m_bbox[4 * i + 2] = info->east_lon_degree;
+                m_bbox[4 * i + 3] = info->north_lat_degree;
+            }
+            else
+            {
+                for (int j = 0; j < 4; j++)
+                    m_bbox[4 * i + j] = Double::NaN;
+            }
+        }
+        m_strings = strings->ToArray();
+    }
+    finally
+    {
+        if (infoList)
+            proj_crs_info_list_destroy(infoList);
+        proj_get_crs_list_parameters_destroy(params);
+    }
+
+    m_byCode = gcnew Dictionary<String^, int>(count, StringComparer::OrdinalIgnoreCase);
+    m_upperNames = gcnew array<String^>(count);
+    m_trigrams = gcnew Dictionary<long long, array<int>^>();
+    Dictionary<long long, System::Collections::Generic::List<int>^>^ postings = gcnew Dictionary<long long, System::Collections::Generic::List<int>^>();
+
+    for (int i = 0; i < count; i++)
+    {
+        m_byCode[String::Concat(m_strings[m_authority[i]], ":", m_codes[i])] = i;
+
+        String^ upper = m_upperNames[i] = m_names[i] ? m_names[i]->ToUpperInvariant() : String::Empty;
+
+        for (int j = 0; j + 3 <= upper->Length; j++)
+        {
+            System::Collections::Generic::List<int>^ lst;
+            long long t = trigram(upper, j);
+
+            if (!postings->TryGetValue(t, lst))
+                postings[t] = lst = gcnew System::Collections::Generic::List<int>();
+
+            if (!lst->Count || lst[lst->Count - 1] != i)
+                lst->Add(i);
+        }
+    }
+
+    for each (KeyValuePair<long long, System::Collections::Generic::List<int>^> kv in postings)
+        m_trigrams[kv.Key] = kv.Value->ToArray();
+
+    m_byName = gcnew array<int>(count);
+    for (int i = 0; i < count; i++)
+        m_byName[i] = i;
+
+    array<String^>^ sortNames = (array<String^>^)m_upperNames->Clone();
+    Array::Sort(sortNames, m_byName, StringComparer::Ordinal);
+
+    BuildTree();
+}
+
+void CrsCatalog::BuildTree()
+{
+    System::Collections::Generic::List<double>^ boxes = gcnew System::Collections::Generic::List<double>();
+    System::Collections::Generic::List<int>^ items = gcnew System::Collections::Generic::List<int>();
+
+    for (int i = 0; i < Count; i++)
+    {
+        double w = m_bbox[4 * i + 0], s = m_bbox[4 * i + 1], e = m_bbox[4 * i + 2], n = m_bbox[4 * i + 3];
+
+        if (Double::IsNaN(w))
+            continue;
+
+        if (w > e)
+        {
+            // Crosses the antimeridian. Index both halves
+            boxes->AddRange(gcnew array<double> { w, s, 180.0, n });
+            items->Add(i);
+            w = -180.0;
+        }
+
+        boxes->AddRange(gcnew array<double> { w, s, e, n });
+        items->Add(i);
+    }
+
+    int entries = items->Count;
+    array<unsigned int>^ keys = gcnew array<unsigned int>(entries);
+    array<int>^ order = gcnew array<int>(entries);
+
+    for (int i = 0; i < entries; i++)
+    {
+        keys[i] = hilbert_index((boxes[4 * i] + boxes[4 * i + 2]) / 2, (boxes[4 * i + 1] + boxes[4 * i + 3]) / 2, -180, -90, 180, 90);
+        order[i] = i;
+    }
+    Array::Sort(keys, order);
+
+    // Level sizes
+    System::Collections::Generic::List<int>^ levels = gcnew System::Collections::Generic::List<int>();
+    int slots = 0;
+    levels->Add(0);
+    for (int n = entries; ; n = (n + NodeSize - 1) / NodeSize)
+    {
+        slots += n;
+        levels->Add(slots);
+
+        if (n <= NodeSize)
+            break;
+    }
+
+    m_levels = levels->ToArray();
+    m_tree = gcnew array<double>(4 * slots);
+    m_entryItem = gcnew array<int>(entries);
+
+    for (int i = 0; i < entries; i++)
+    {
+        int from = order[i];
+
+        for (int j = 0; j < 4; j++)
+            m_tree[4 * i + j] = boxes[4 * from + j];
+
+        m_entryItem[i] = items[from];
+    }
+
+    for (int l = 1; l + 1 < m_levels->Length; l++)
+    {
+        int childStart = m_levels[l - 1];
+        int childEnd = m_levels[l];
+
+        for (int node = m_levels[l]; node < m_levels[l + 1]; node++)
+        {
+            int first = childStart + (node - m_levels[l]) * NodeSize;
+            int last = Math::Min(first + NodeSize, childEnd);
+            double w = Double::MaxValue, s = Double::MaxValue, e = -Double::MaxValue, n = -Double::MaxValue;
+
+            for (int c = first; c < last; c++)
+            {
+                w = Math::Min(w, m_tree[4 * c + 0]);
+                s = Math::Min(s, m_tree[4 * c + 1]);
+                e = Math::Max(e, m_tree[4 * c + 2]);
+                n = Math::Max(n, m_tree[4 * c + 3]);
+            }
+
+            m_tree[4 * node + 0] = w;
+            m_tree[4 * node + 1] = s;
+            m_tree[4 * node + 2] = e;
+            m_tree[4 * node + 3] = n;
+        }
+    }
+}
+
+void CrsCatalog::Search(double west, double south, double east, double north, System::Collections::Generic::List<int>^ into)
+{
+    if (!m_entryItem->Length)
+        return;
+
+    // Explicit stack of (level, slot)
+    System::Collections::Generic::Stack<KeyValuePair<int, int>>^ todo = gcnew System::Collections::Generic::Stack<KeyValuePair<int, int>>();
+    int top = m_levels->Length - 2;
+
+    for (int slot = m_levels[top]; slot < m_levels[top + 1]; slot++)
+        todo->Push(KeyValuePair<int, int>(top, slot));
+
+    while (todo->Count)
+    {
+        KeyValuePair<int, int> item = todo->Pop();
+        int slot = item.Value;
+
+        if (m_tree[4 * slot + 0] > east || m_tree[4 * slot + 2] < west || m_tree[4 * slot + 1] > north || m_tree[4 * slot + 3] < south)
+            continue;
+
+        if (item.Key == 0)
+        {
+            into->Add(m_entryItem[slot]);
+            continue;
+        }
+
+        int first = m_levels[item.Key - 1] + (slot - m_levels[item.Key]) * NodeSize;
+        int last = Math::Min(first + NodeSize, m_levels[item.Key]);
+
+        for (int c = first; c < last; c++)
+            todo->Push(KeyValuePair<int, int>(item.Key - 1, c));
+    }
+}
+
+bool CrsCatalog::Contains(double west, double south, double east, double north, IProjArea^ area)
+{
+    if (area->SouthLatitude < south || area->NorthLatitude > north)
+        return false;
+
+    // Compare on a continuous longitude axis starting at west
+    double e = (east < west) ? east + 360.0 : east;
+    double aw = area->WestLongitude;
+    double ae = area->EastLongitude;
+
+    if (ae < aw)
+        ae += 360.0;
+    if (aw < west)
+    {
+        aw += 360.0;
+        ae += 360.0;
+    }
+
+    return aw >= west && ae <= e;
+}
+
+ReadOnlyCollection<CoordinateReferenceSystemInfo^>^ CrsCatalog::Collect(System::Collections::Generic::List<int>^ items, int maxResults, bool includeDeprecated, IProjArea^ contains)
+{
+    // Back in catalog order, without the duplicates of boxes crossing the antimeridian
+    items->Sort();
+
+    System::Collections::Generic::List<CoordinateReferenceSystemInfo^>^ result = gcnew System::Collections::Generic::List<CoordinateReferenceSystemInfo^>();
+    int prev = -1;
+
+    for each (int i in items)
+    {
+        if (i == prev)
+            continue;
+        prev = i;
+
+        if (!includeDeprecated && m_deprecated[i])
+            continue;
+        else if (contains && !Contains(m_bbox[4 * i], m_bbox[4 * i + 1], m_bbox[4 * i + 2], m_bbox[4 * i + 3], contains))
+            continue;
+
+        result->Add(this->default[i]);
+
+        if (maxResults > 0 && result->Count >= maxResults)
+            break;
+    }
+
+    return result->AsReadOnly();
+}
+
+CoordinateReferenceSystemInfo^ CrsCatalog::default::get(int index)
+{
+    if (index < 0 || index >= Count)
+        throw gcnew ArgumentOutOfRangeException("index");
+
+    CoordinateReferenceSystemInfo^ info = m_infos[index];
+
+    if (!info)
+    {
+        ProjArea^ bbox = Double::IsNaN(m_bbox[4 * index]) ? nullptr
+            : gcnew ProjArea(m_bbox[4 * index], m_bbox[4 * index + 1], m_bbox[4 * index + 2], m_bbox[4 * index + 3]);
+
+        // Racing threads create equal instances
+        m_infos[index] = info = gcnew CoordinateReferenceSystemInfo(
+            m_strings[m_authority[index]], m_codes[index], m_names[index], m_types[index], m_deprecated[index],
+            m_strings[m_areaName[index]], m_strings[m_projectionName[index]], m_strings[m_celestialBodyName[index]], bbox);
+    }
+
+    return info;
+}
+
+CoordinateReferenceSystemInfo^ CrsCatalog::Find(String^ authority, String^ code)
+{
+    if (String::IsNullOrEmpty(authority))
+        throw gcnew ArgumentNullException("authority");
+    else if (String::IsNullOrEmpty(code))
+        throw gcnew ArgumentNullException("code");
+
+    int i;
+
+    if (m_byCode->TryGetValue(String::Concat(authority, ":", code), i))
+        return this->default[i];
+
+    return nullptr;
+}
+
+ReadOnlyCollection<CoordinateReferenceSystemInfo^>^ CrsCatalog::FindAt(double longitude, double latitude, [Optional] bool includeDeprecated)
+{
+    if (Double::IsNaN(longitude) || Double::IsNaN(latitude))
+        throw gcnew ArgumentOutOfRangeException();
+
+    longitude = Math::IEEERemainder(longitude, 360.0); // -180..180
+
+    System::Collections::Generic::List<int>^ items = gcnew System::Collections::Generic::List<int>();
+    Search(longitude, latitude, longitude, latitude, items);
+
+    return Collect(items, 0, includeDeprecated, nullptr);
+}
+
+ReadOnlyCollection<CoordinateReferenceSystemInfo^>^ CrsCatalog::FindIntersecting(IProjArea^ area, [Optional] bool includeDeprecated)
+{
+    if (!area)
+        throw gcnew ArgumentNullException("area");
+
+    System::Collections::Generic::List<int>^ items = gcnew System::Collections::Generic::List<int>();
+
+    if (area->WestLongitude > area->EastLongitude)
+    {
+        Search(area->WestLongitude, area->SouthLatitude, 180.0, area->NorthLatitude, items);
+        Search(-180.0, area->SouthLatitude, area->EastLongitude, area->NorthLatitude, items);
+    }
+    else
+        Search(area->WestLongitude, area->SouthLatitude, area->EastLongitude, area->NorthLatitude, items);
+
+    return Collect(items, 0, includeDeprecated, nullptr);
+}
+
+ReadOnlyCollection<CoordinateReferenceSystemInfo^>^ CrsCatalog::FindContaining(IProjArea^ area, [Optional] bool includeDeprecated)
+{
+    if (!area)
+        throw gcnew ArgumentNullException("area");
+
+    // Anything containing the area contains its west-south corner
+    System::Collections::Generic::List<int>^ items = gcnew System::Collections::Generic::List<int>();
+    double west = Math::IEEERemainder(area->WestLongitude, 360.0);
+    Search(west, area->SouthLatitude, west, area->SouthLatitude, items);
+
+    return Collect(items, 0, includeDeprecated, area);
+}
+
+ReadOnlyCollection<CoordinateReferenceSystemInfo^>^ CrsCatalog::FindByName(String^ text, [Optional] int maxResults)
+{
+    if (String::IsNullOrEmpty(text))
+        throw gcnew ArgumentNullException("text");
+
+    String^ upper = text->ToUpperInvariant();
+    System::Collections::Generic::List<CoordinateReferenceSystemInfo^>^ result = gcnew System::Collections::Generic::List<CoordinateReferenceSystemInfo^>();
+    HashSet<int>^ found = gcnew HashSet<int>();
+
+    // Prefix matches, via binary search in the sorted names
+    int lo = 0, hi = m_byName->Length;
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+
+        if (String::CompareOrdinal(m_upperNames[m_byName[mid]], upper) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (int p = lo; p < m_byName->Length && m_upperNames[m_byName[p]]->StartsWith(upper, StringComparison::Ordinal); p++)
+    {
+        if (maxResults > 0 && result->Count >= maxResults)
+            return result->AsReadOnly();
+
+        found->Add(m_byName[p]);
+        result->Add(this->default[m_byName[p]]);
+    }
+
+    // Other matches. Candidates are in all posting lists of the trigrams of the text; short texts are scanned
+    array<int>^ candidates = nullptr;
+
+    for (int j = 0; j + 3 <= upper->Length; j++)
+    {
+        array<int>^ posting;
+
+        if (!m_trigrams->TryGetValue(trigram(upper, j), posting))
+            return result->AsReadOnly();
+
+        if (!candidates || posting->Length < candidates->Length)
+            candidates = posting;
+    }
+
+    if (candidates)
+    {
+        for each (int i in candidates)
+        {
+            if (maxResults > 0 && result->Count >= maxResults)
+                break;
+
+            if (!found->Contains(i) && m_upperNames[i]->IndexOf(upper, StringComparison::Ordinal) >= 0)
+                result->Add(this->default[i]);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < m_upperNames->Length; i++)
+        {
+            if (maxResults > 0 && result->Count >= maxResults)
+                break;
+
+            if (!found->Contains(i) && m_upperNames[i]->IndexOf(upper, StringComparison::Ordinal) >= 0)
+                result->Add(this->default[i]);
+        }
+    }
+
+    return result->AsReadOnly();
+}
+
+CrsCatalog^ CrsCatalog::Get(ProjContext^ ctx)
+{
+    // One catalog per database file and version
+    String^ k = ctx->GetDatabaseVersionKey();
+    CrsCatalog^ catalog;
+
+    System::Threading::Monitor::Enter(_catalogs);
+    try
+    {
+        if (_catalogs->TryGetValue(k, catalog))
+            return catalog;
+    }
+    finally
+    {
+        System::Threading::Monitor::Exit(_catalogs);
+    }
+
+    // Build outside the lock. Concurrent builders produce equal catalogs
+    catalog = gcnew CrsCatalog(ctx);
+
+    System::Threading::Monitor::Enter(_catalogs);
+    try
+    {
+        CrsCatalog^ other;
+
+        if (_catalogs->TryGetValue(k, other))
+            return other;
+
+        _catalogs[k] = catalog;
+        return catalog;
+    }
+    finally
+    {
+        System::Threading::Monitor::Exit(_catalogs);
+    }
+}
+
+CrsCatalog^ ProjContext::GetCrsCatalog()
+{
+    return CrsCatalog::Get(this);
+}
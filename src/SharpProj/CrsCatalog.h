@@ -0,0 +1,123 @@
+#pragma once
+
+namespace SharpProj {
+    namespace Proj {
+        ref class CoordinateReferenceSystemInfo;
+        interface class IProjArea;
+
+        /// <summary>
+        /// Indexed in-memory list of all coordinate reference systems in a proj.db, for fast lookups by location, code and name.
+        /// Built once per database version and shared by all contexts using that database. Obtain it via <see cref="ProjContext" />.GetCrsCatalog().
+        /// </summary>
+        [DebuggerDisplay("Count={Count}")]
+        public ref class CrsCatalog sealed
+        {
+        private:
+            // Per crs, in the same order as GetCoordinateReferenceSystems()
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly array<String^>^ m_codes;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly array<String^>^ m_names;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly array<unsigned short>^ m_authority; // Index in m_strings, as are the other short arrays
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly array<unsigned short>^ m_areaName;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly array<unsigned short>^ m_projectionName;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly array<unsigned short>^ m_celestialBodyName;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly array<ProjType>^ m_types;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly array<bool>^ m_deprecated;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly array<double>^ m_bbox; // West, south, east, north. NaN when unknown
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly array<String^>^ m_strings;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly array<CoordinateReferenceSystemInfo^>^ m_infos;
+
+            // R-tree over the bounding boxes, packed in Hilbert order. Level 0 holds the entries, each next level the
+            // bounding boxes of NodeSize items of the level below
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            array<double>^ m_tree;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            array<int>^ m_levels; // First slot of each level, plus the end
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            array<int>^ m_entryItem;
+
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly System::Collections::Generic::Dictionary<String^, int>^ m_byCode;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly array<int>^ m_byName;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly array<String^>^ m_upperNames;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly System::Collections::Generic::Dictionary<long long, array<int>^>^ m_trigrams;
+
+            literal int NodeSize = 16;
+
+            static initonly System::Collections::Generic::Dictionary<String^, CrsCatalog^>^ _catalogs = gcnew System::Collections::Generic::Dictionary<String^, CrsCatalog^>();
+
+            CrsCatalog(ProjContext^ ctx);
+            void BuildTree();
+            void Search(double west, double south, double east, double north, System::Collections::Generic::List<int>^ into);
+            ReadOnlyCollection<CoordinateReferenceSystemInfo^>^ Collect(System::Collections::Generic::List<int>^ items, int maxResults, bool includeDeprecated, IProjArea^ contains);
+            static bool Contains(double west, double south, double east, double north, IProjArea^ area);
+
+        internal:
+            static CrsCatalog^ Get(ProjContext^ ctx);
+
+            // Order of GetCoordinateReferenceSystems(): by authority, numeric code and name
+            static array<int>^ SortOrder(array<String^>^ authorities, array<String^>^ codes, array<String^>^ names);
+
+        public:
+            property int Count
+            {
+                int get()
+                {
+                    return m_codes->Length;
+                }
+            }
+
+            property CoordinateReferenceSystemInfo^ default[int]
+            {
+                CoordinateReferenceSystemInfo^ get(int index);
+            }
+
+            /// <summary>
+            /// Finds a coordinate reference system by authority and code
+            /// </summary>
+            /// <returns>The crs, or null when not found</returns>
+            CoordinateReferenceSystemInfo^ Find(String^ authority, String^ code);
+
+            /// <summary>
+            /// Gets the coordinate reference systems whose area of use contains the location
+            /// </summary>
+            /// <param name="longitude"></param>
+            /// <param name="latitude"></param>
+            /// <param name="includeDeprecated"></param>
+            /// <returns></returns>
+            ReadOnlyCollection<CoordinateReferenceSystemInfo^>^ FindAt(double longitude, double latitude, [Optional] bool includeDeprecated);
+
+            /// <summary>
+            /// Gets the coordinate reference systems whose area of use intersects <paramref name="area"/>
+            /// </summary>
+            ReadOnlyCollection<CoordinateReferenceSystemInfo^>^ FindIntersecting(IProjArea^ area, [Optional] bool includeDeprecated);
+
+            /// <summary>
+            /// Gets the coordinate reference systems whose area of use completely contains <paramref name="area"/>
+            /// </summary>
+            ReadOnlyCollection<CoordinateReferenceSystemInfo^>^ FindContaining(IProjArea^ area, [Optional] bool includeDeprecated);
+
+            /// <summary>
+            /// Gets the coordinate reference systems with <paramref name="text"/> in their name, case insensitive. Names
+            /// starting with the text are returned first, in name order; then the other matches in catalog order.
+            /// </summary>
+            /// <param name="text"></param>
+            /// <param name="maxResults">Maximum number of results, or 0 for all</param>
+            /// <returns></returns>
+            ReadOnlyCollection<CoordinateReferenceSystemInfo^>^ FindByName(String^ text, [Optional] int maxResults);
+        };
+    }
+}
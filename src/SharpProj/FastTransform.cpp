@@ -0,0 +1,1294 @@
+#include "pch.h"
+#include "ProjContext.h"
+#include "FastTransform.h"
+#include "PipelineStep.h"
+#include <math.h>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define FAST_TRANSFORM_X86
+#if _MSC_VER >= 1920
+// Visual C++ 2019 and later provide the vector math (SVML) intrinsics used by the projection kernels
+#define FAST_TRANSFORM_SVML
+#endif
+#endif
+
+using System::Collections::Generic::Dictionary;
+using System::Collections::Generic::List;
+using System::Globalization::CultureInfo;
+using System::Globalization::NumberStyles;
+
+#pragma region Kernels
+#pragma managed(push, off)
+namespace {
+    // The affine kernels apply x' = m[0] x + m[1] y + m[2] z + m[3], y' = m[4] x + ... + m[7], z' = m[8] x + ... + m[11].
+    // Like PROJ, a coordinate with a HUGE_VAL ordinate results in HUGE_VAL.
+
+    void affine_scalar(const double* m, double* x, int xs, double* y, int ys, double* z, int zs, int from, int n)
+    {
+        for (int i = from; i < n; i++)
+        {
+            double* px = x + (ptrdiff_t)i * xs;
+            double* py = y + (ptrdiff_t)i * ys;
+            double* pz = z ? z + (ptrdiff_t)i * zs : nullptr;
+            double X = *px, Y = *py, Z = pz ? *pz : 0;
+
+            if (X == HUGE_VAL || Y == HUGE_VAL || Z == HUGE_VAL)
+            {
+                *px = *py = HUGE_VAL;
+                if (pz)
+                    *pz = HUGE_VAL;
+                continue;
+            }
+
+            *px = m[0] * X + m[1] * Y + m[2] * Z + m[3];
+            *py = m[4] * X + m[5] * Y + m[6] * Z + m[7];
+            if (pz)
+                *pz = m[8] * X + m[9] * Y + m[10] * Z + m[11];
+        }
+    }
+
+#ifdef FAST_TRANSFORM_X86
+    // Contiguous ranges, 2 coordinates per instruction. Returns the number of coordinates handled
+    int affine_sse2(const double* m, double* x, double* y, double* z, int n)
+    {
+        const __m128d huge = _mm_set1_pd(HUGE_VAL);
+        __m128d c[12];
+        for (int k = 0; k < 12; k++)
+            c[k] = _mm_set1_pd(m[k]);
+
+        int i = 0;
+        for (; i + 2 <= n; i += 2)
+        {
+            __m128d X = _mm_loadu_pd(x + i);
+            __m128d Y = _mm_loadu_pd(y + i);
+            __m128d Z = z ? _mm_loadu_pd(z + i) : _mm_setzero_pd();
+            __m128d bad = _mm_or_pd(_mm_or_pd(_mm_cmpeq_pd(X, huge), _mm_cmpeq_pd(Y, huge)), _mm_cmpeq_pd(Z, huge));
+
+            __m128d rx = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(c[0], X), _mm_mul_pd(c[1], Y)), _mm_mul_pd(c[2], Z)), c[3]);
+            __m128d ry = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(c[4], X), _mm_mul_pd(c[5], Y)), _mm_mul_pd(c[6], Z)), c[7]);
+
+            _mm_storeu_pd(x + i, _mm_or_pd(_mm_and_pd(bad, huge), _mm_andnot_pd(bad, rx)));
+            _mm_storeu_pd(y + i, _mm_or_pd(_mm_and_pd(bad, huge), _mm_andnot_pd(bad, ry)));
+
+            if (z)
+            {
+                __m128d rz = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(c[8], X), _mm_mul_pd(c[9], Y)), _mm_mul_pd(c[10], Z)), c[11]);
+                _mm_storeu_pd(z + i, _mm_or_pd(_mm_and_pd(bad, huge), _mm_andnot_pd(bad, rz)));
+            }
+        }
+        return i;
+    }
+
+    // As affine_sse2, with 4 coordinates per instruction
+    int affine_avx(const double* m, double* x, double* y, double* z, int n)
+    {
+        const __m256d huge = _mm256_set1_pd(HUGE_VAL);
+        __m256d c[12];
+        for (int k = 0; k < 12; k++)
+            c[k] = _mm256_set1_pd(m[k]);
+
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256d X = _mm256_loadu_pd(x + i);
+            __m256d Y = _mm256_loadu_pd(y + i);
+            __m256d Z = z ? _mm256_loadu_pd(z + i) : _mm256_setzero_pd();
+            __m256d bad = _mm256_or_pd(_mm256_or_pd(_mm256_cmp_pd(X, huge, _CMP_EQ_OQ), _mm256_cmp_pd(Y, huge, _CMP_EQ_OQ)), _mm256_cmp_pd(Z, huge, _CMP_EQ_OQ));
+
+            __m256d rx = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(c[0], X), _mm256_mul_pd(c[1], Y)), _mm256_mul_pd(c[2], Z)), c[3]);
+            __m256d ry = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(c[4], X), _mm256_mul_pd(c[5], Y)), _mm256_mul_pd(c[6], Z)), c[7]);
+
+            _mm256_storeu_pd(x + i, _mm256_blendv_pd(rx, huge, bad));
+            _mm256_storeu_pd(y + i, _mm256_blendv_pd(ry, huge, bad));
+
+            if (z)
+            {
+                __m256d rz = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(c[8], X), _mm256_mul_pd(c[9], Y)), _mm256_mul_pd(c[10], Z)), c[11]);
+                _mm256_storeu_pd(z + i, _mm256_blendv_pd(rz, huge, bad));
+            }
+        }
+        _mm256_zeroupper();
+        return i;
+    }
+
+    int avx_state = -1;
+
+    bool has_avx()
+    {
+        if (avx_state < 0)
+        {
+            int info[4];
+            __cpuid(info, 1);
+
+            // AVX supported by the cpu, and its registers saved by the OS
+            bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);
+            avx_state = avx ? 1 : 0;
+        }
+        return avx_state != 0;
+    }
+#endif
+
+    void affine_apply(const double* m, double* x, int xs, double* y, int ys, double* z, int zs, int n)
+    {
+        int done = 0;
+#ifdef FAST_TRANSFORM_X86
+        if (xs == 1 && ys == 1 && (!z || zs == 1))
+            done = has_avx() ? affine_avx(m, x, y, z, n) : affine_sse2(m, x, y, z, n);
+#endif
+        affine_scalar(m, x, xs, y, ys, z, zs, done, n);
+    }
+}
+#pragma managed(pop)
+#pragma endregion
+
+#pragma region Projection kernels
+#pragma managed(push, off)
+namespace {
+    const double PI = 3.14159265358979323846;
+    const double HALFPI = PI / 2;
+    const double TWOPI = 2 * PI;
+    const int ETMERC_ORDER = 6;
+
+    enum projection_kind
+    {
+        projection_webmerc,
+        projection_tmerc
+    };
+
+    // The parameters of a projection step, stored by ProjectionFastTransform as an array of doubles
+    struct projection_params
+    {
+        double a, ra; // Semi major axis and its inverse
+        double k0, x0, y0, lam0;
+        // Transverse Mercator (Poder/Engsager) constants, calculated like PROJ's tmerc setup_exact()
+        double Qn, Zb;
+        double cbg[ETMERC_ORDER], cgb[ETMERC_ORDER], gtu[ETMERC_ORDER], utg[ETMERC_ORDER];
+    };
+    static_assert(sizeof(projection_params) % sizeof(double) == 0, "projection_params must only hold doubles");
+
+    double adjlon(double lon)
+    {
+        // Let the longitude slightly overshoot, like PROJ, to avoid sign switching at the date line
+        if (fabs(lon) < PI + 1e-12)
+            return lon;
+
+        lon += PI;
+        lon -= TWOPI * floor(lon / TWOPI);
+        return lon - PI;
+    }
+
+    // Clenshaw summations of the Poder/Engsager series, as in PROJ's tmerc.cpp
+    double gatg(const double* p1, int len, double B, double cos_2B, double sin_2B)
+    {
+        double h = 0, h1, h2 = 0;
+        const double two_cos_2B = 2 * cos_2B;
+        const double* p = p1 + len;
+
+        h1 = *--p;
+        while (p - p1)
+        {
+            h = -h2 + two_cos_2B * h1 + *--p;
+            h2 = h1;
+            h1 = h;
+        }
+        return B + h * sin_2B;
+    }
+
+    double clens(const double* a, int size, double arg_r)
+    {
+        const double* p = a + size;
+        double r = 2 * cos(arg_r);
+        double hr, hr1 = 0, hr2;
+
+        hr = *--p;
+        while (a - p)
+        {
+            hr2 = hr1;
+            hr1 = hr;
+            hr = -hr2 + r * hr1 + *--p;
+        }
+        return sin(arg_r) * hr;
+    }
+
+    void clenS(const double* a, int size, double sin_arg_r, double cos_arg_r, double sinh_arg_i, double cosh_arg_i, double* R, double* I)
+    {
+        const double* p = a + size;
+        double r = 2 * cos_arg_r * cosh_arg_i;
+        double i = -2 * sin_arg_r * sinh_arg_i;
+        double hr, hr1 = 0, hr2, hi = 0, hi1 = 0, hi2;
+
+        hr = *--p;
+        while (a - p)
+        {
+            hr2 = hr1;
+            hi2 = hi1;
+            hr1 = hr;
+            hi1 = hi;
+            hr = -hr2 + r * hr1 - i * hi1 + *--p;
+            hi = -hi2 + i * hr1 + r * hi1;
+        }
+
+        r = sin_arg_r * cosh_arg_i;
+        i = cos_arg_r * sinh_arg_i;
+        *R = r * hr - i * hi;
+        *I = r * hi + i * hr;
+    }
+
+    void tmerc_setup(projection_params* P, double es, double phi0)
+    {
+        const double f = es / (1 + sqrt(1 - es));
+        const double n = f / (2 - f); // Third flattening
+        double np = n;
+
+        // Gaussian <-> geodetic latitude, KW p186 - 191
+        P->cgb[0] = n * (2 + n * (-2 / 3.0 + n * (-2 + n * (116 / 45.0 + n * (26 / 45.0 + n * (-2854 / 675.0))))));
+        P->cbg[0] = n * (-2 + n * (2 / 3.0 + n * (4 / 3.0 + n * (-82 / 45.0 + n * (32 / 45.0 + n * (4642 / 4725.0))))));
+        np *= n;
+        P->cgb[1] = np * (7 / 3.0 + n * (-8 / 5.0 + n * (-227 / 45.0 + n * (2704 / 315.0 + n * (2323 / 945.0)))));
+        P->cbg[1] = np * (5 / 3.0 + n * (-16 / 15.0 + n * (-13 / 9.0 + n * (904 / 315.0 + n * (-1522 / 945.0)))));
+        np *= n;
+        P->cgb[2] = np * (56 / 15.0 + n * (-136 / 35.0 + n * (-1262 / 105.0 + n * (73814 / 2835.0))));
+        P->cbg[2] = np * (-26 / 15.0 + n * (34 / 21.0 + n * (8 / 5.0 + n * (-12686 / 2835.0))));
+        np *= n;
+        P->cgb[3] = np * (4279 / 630.0 + n * (-332 / 35.0 + n * (-399572 / 14175.0)));
+        P->cbg[3] = np * (1237 / 630.0 + n * (-12 / 5.0 + n * (-24832 / 14175.0)));
+        np *= n;
+        P->cgb[4] = np * (4174 / 315.0 + n * (-144838 / 6237.0));
+        P->cbg[4] = np * (-734 / 315.0 + n * (109598 / 31185.0));
+        np *= n;
+        P->cgb[5] = np * (601676 / 22275.0);
+        P->cbg[5] = np * (444337 / 155925.0);
+
+        // Normalized meridian quadrant, KW p.50 (96), p.19 (38b), p.5 (2)
+        np = n * n;
+        P->Qn = P->k0 / (1 + n) * (1 + np * (1 / 4.0 + np * (1 / 64.0 + np / 256.0)));
+
+        // Ellipsoidal <-> spherical northing and easting, KW p194 - 196
+        P->utg[0] = n * (-0.5 + n * (2 / 3.0 + n * (-37 / 96.0 + n * (1 / 360.0 + n * (81 / 512.0 + n * (-96199 / 604800.0))))));
+        P->gtu[0] = n * (0.5 + n * (-2 / 3.0 + n * (5 / 16.0 + n * (41 / 180.0 + n * (-127 / 288.0 + n * (7891 / 37800.0))))));
+        P->utg[1] = np * (-1 / 48.0 + n * (-1 / 15.0 + n * (437 / 1440.0 + n * (-46 / 105.0 + n * (1118711 / 3870720.0)))));
+        P->gtu[1] = np * (13 / 48.0 + n * (-3 / 5.0 + n * (557 / 1440.0 + n * (281 / 630.0 + n * (-1983433 / 1935360.0)))));
+        np *= n;
+        P->utg[2] = np * (-17 / 480.0 + n * (37 / 840.0 + n * (209 / 4480.0 + n * (-5569 / 90720.0))));
+        P->gtu[2] = np * (61 / 240.0 + n * (-103 / 140.0 + n * (15061 / 26880.0 + n * (167603 / 181440.0))));
+        np *= n;
+        P->utg[3] = np * (-4397 / 161280.0 + n * (11 / 504.0 + n * (830251 / 7257600.0)));
+        P->gtu[3] = np * (49561 / 161280.0 + n * (-179 / 168.0 + n * (6601661 / 7257600.0)));
+        np *= n;
+        P->utg[4] = np * (-4583 / 161280.0 + n * (108847 / 3991680.0));
+        P->gtu[4] = np * (34729 / 80640.0 + n * (-3418889 / 1995840.0));
+        np *= n;
+        P->utg[5] = np * (-20648693 / 638668800.0);
+        P->gtu[5] = np * (212378941 / 319334400.0);
+
+        // Origin northing minus true northing at the origin latitude
+        const double Z = gatg(P->cbg, ETMERC_ORDER, phi0, cos(2 * phi0), sin(2 * phi0));
+        P->Zb = -P->Qn * (Z + clens(P->gtu, ETMERC_ORDER, 2 * Z));
+    }
+
+    // The scalar kernels follow PROJ's pj_fwd() and pj_inv() for geographic coordinates in radians and
+    // projected coordinates in meters. They return false for coordinates PROJ fails on
+
+    bool projection_fwd(int kind, const projection_params* P, double& x, double& y)
+    {
+        double lam = x, phi = y;
+
+        if (fabs(phi) - HALFPI > 1e-12 || lam > 10 || lam < -10)
+            return false;
+
+        if (phi > HALFPI)
+            phi = HALFPI;
+        else if (phi < -HALFPI)
+            phi = -HALFPI;
+
+        lam = adjlon(adjlon(lam) - P->lam0);
+
+        if (kind == projection_webmerc)
+        {
+            x = P->k0 * lam;
+            y = P->k0 * asinh(tan(phi));
+        }
+        else
+        {
+            // Ellipsoidal latitude -> Gaussian latitude -> complex spherical latitude
+            double Cn = gatg(P->cbg, ETMERC_ORDER, phi, cos(2 * phi), sin(2 * phi));
+            const double sin_Cn = sin(Cn);
+            const double cos_Cn = cos(Cn);
+            const double sin_Ce = sin(lam);
+            const double cos_Ce = cos(lam);
+
+            const double cos_Cn_cos_Ce = cos_Cn * cos_Ce;
+            Cn = atan2(sin_Cn, cos_Cn_cos_Ce);
+
+            const double inv_denom_tan_Ce = 1. / hypot(sin_Cn, cos_Cn_cos_Ce);
+            const double tan_Ce = sin_Ce * cos_Cn * inv_denom_tan_Ce;
+            double Ce = asinh(tan_Ce);
+
+            const double two_inv_denom_tan_Ce = 2 * inv_denom_tan_Ce;
+            const double two_inv_denom_tan_Ce_square = two_inv_denom_tan_Ce * inv_denom_tan_Ce;
+            const double tmp_r = cos_Cn_cos_Ce * two_inv_denom_tan_Ce_square;
+            const double sin_arg_r = sin_Cn * tmp_r;
+            const double cos_arg_r = cos_Cn_cos_Ce * tmp_r - 1;
+            const double sinh_arg_i = tan_Ce * two_inv_denom_tan_Ce;
+            const double cosh_arg_i = two_inv_denom_tan_Ce_square - 1;
+
+            // Complex spherical northing, easting -> ellipsoidal normalized northing, easting
+            double dCn, dCe;
+            clenS(P->gtu, ETMERC_ORDER, sin_arg_r, cos_arg_r, sinh_arg_i, cosh_arg_i, &dCn, &dCe);
+            Cn += dCn;
+            Ce += dCe;
+
+            if (fabs(Ce) > 2.623395162778)
+                return false; // Outside the projection domain
+
+            y = P->Qn * Cn + P->Zb;
+            x = P->Qn * Ce;
+        }
+
+        x = P->a * x + P->x0;
+        y = P->a * y + P->y0;
+        return true;
+    }
+
+    bool projection_inv(int kind, const projection_params* P, double& x, double& y)
+    {
+        double X = (x - P->x0) * P->ra;
+        double Y = (y - P->y0) * P->ra;
+        double lam, phi;
+
+        if (kind == projection_webmerc)
+        {
+            phi = atan(sinh(Y / P->k0));
+            lam = X / P->k0;
+        }
+        else
+        {
+            double Cn = (Y - P->Zb) / P->Qn;
+            double Ce = X / P->Qn;
+
+            if (fabs(Ce) > 2.623395162778)
+                return false; // Outside the projection domain
+
+            // Normalized northing, easting -> complex spherical latitude, longitude
+            const double sin_arg_r = sin(2 * Cn);
+            const double cos_arg_r = cos(2 * Cn);
+            const double exp_2_Ce = exp(2 * Ce);
+            const double half_inv_exp_2_Ce = 0.5 / exp_2_Ce;
+            const double sinh_arg_i = 0.5 * exp_2_Ce - half_inv_exp_2_Ce;
+            const double cosh_arg_i = 0.5 * exp_2_Ce + half_inv_exp_2_Ce;
+
+            double dCn, dCe;
+            clenS(P->utg, ETMERC_ORDER, sin_arg_r, cos_arg_r, sinh_arg_i, cosh_arg_i, &dCn, &dCe);
+            Cn += dCn;
+            Ce += dCe;
+
+            // Complex spherical latitude -> Gaussian latitude, longitude -> ellipsoidal latitude
+            const double sin_Cn = sin(Cn);
+            const double cos_Cn = cos(Cn);
+            const double sinhCe = sinh(Ce);
+            Ce = atan2(sinhCe, cos_Cn);
+            const double modulus_Ce = hypot(sinhCe, cos_Cn);
+            Cn = atan2(sin_Cn, modulus_Ce);
+
+            const double tmp = 2 * modulus_Ce / (sinhCe * sinhCe + 1);
+            const double sin_2_Cn = sin_Cn * tmp;
+            const double cos_2_Cn = tmp * modulus_Ce - 1.;
+
+            phi = gatg(P->cgb, ETMERC_ORDER, Cn, cos_2_Cn, sin_2_Cn);
+            lam = Ce;
+        }
+
+        x = adjlon(lam + P->lam0);
+        y = phi;
+        return true;
+    }
+
+    void projection_scalar(int kind, bool forward, const projection_params* P, double* x, int xs, double* y, int ys, double* z, int zs, int from, int n)
+    {
+        for (int i = from; i < n; i++)
+        {
+            double* px = x + (ptrdiff_t)i * xs;
+            double* py = y + (ptrdiff_t)i * ys;
+            double* pz = z ? z + (ptrdiff_t)i * zs : nullptr;
+            double X = *px, Y = *py;
+
+            bool ok = (X != HUGE_VAL && Y != HUGE_VAL && (!pz || *pz != HUGE_VAL))
+                && (forward ? projection_fwd(kind, P, X, Y) : projection_inv(kind, P, X, Y));
+
+            if (ok)
+            {
+                *px = X;
+                *py = Y;
+            }
+            else
+            {
+                *px = *py = HUGE_VAL;
+                if (pz)
+                    *pz = HUGE_VAL;
+            }
+        }
+    }
+
+#ifdef FAST_TRANSFORM_SVML
+    // The AVX kernels evaluate the formulas of the scalar kernels for 4 coordinates at once. Each returns a mask
+    // of the coordinates it fails on
+
+    inline __m256d abs_avx(__m256d v)
+    {
+        return _mm256_andnot_pd(_mm256_set1_pd(-0.0), v);
+    }
+
+    inline __m256d adjlon_avx(__m256d lon)
+    {
+        __m256d wrap = _mm256_cmp_pd(abs_avx(lon), _mm256_set1_pd(PI + 1e-12), _CMP_GE_OQ);
+
+        if (!_mm256_movemask_pd(wrap))
+            return lon;
+
+        const __m256d pi = _mm256_set1_pd(PI);
+        const __m256d twopi = _mm256_set1_pd(TWOPI);
+        __m256d l = _mm256_add_pd(lon, pi);
+        l = _mm256_sub_pd(l, _mm256_mul_pd(twopi, _mm256_floor_pd(_mm256_div_pd(l, twopi))));
+        return _mm256_blendv_pd(lon, _mm256_sub_pd(l, pi), wrap);
+    }
+
+    inline __m256d gatg_avx(const double* p1, __m256d B, __m256d cos_2B, __m256d sin_2B)
+    {
+        __m256d h = _mm256_setzero_pd(), h2 = _mm256_setzero_pd();
+        const __m256d two_cos_2B = _mm256_add_pd(cos_2B, cos_2B);
+        const double* p = p1 + ETMERC_ORDER;
+        __m256d h1 = _mm256_set1_pd(*--p);
+
+        while (p - p1)
+        {
+            h = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(two_cos_2B, h1), h2), _mm256_set1_pd(*--p));
+            h2 = h1;
+            h1 = h;
+        }
+        return _mm256_add_pd(B, _mm256_mul_pd(h, sin_2B));
+    }
+
+    inline void clenS_avx(const double* a, __m256d sin_arg_r, __m256d cos_arg_r, __m256d sinh_arg_i, __m256d cosh_arg_i, __m256d& R, __m256d& I)
+    {
+        const double* p = a + ETMERC_ORDER;
+        const __m256d two = _mm256_set1_pd(2);
+        __m256d r = _mm256_mul_pd(two, _mm256_mul_pd(cos_arg_r, cosh_arg_i));
+        __m256d i = _mm256_mul_pd(_mm256_set1_pd(-2), _mm256_mul_pd(sin_arg_r, sinh_arg_i));
+        __m256d hr = _mm256_set1_pd(*--p), hr1 = _mm256_setzero_pd(), hr2;
+        __m256d hi = _mm256_setzero_pd(), hi1 = _mm256_setzero_pd(), hi2;
+
+        while (a - p)
+        {
+            hr2 = hr1;
+            hi2 = hi1;
+            hr1 = hr;
+            hi1 = hi;
+            hr = _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(_mm256_mul_pd(r, hr1), _mm256_mul_pd(i, hi1)), hr2), _mm256_set1_pd(*--p));
+            hi = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(i, hr1), _mm256_mul_pd(r, hi1)), hi2);
+        }
+
+        r = _mm256_mul_pd(sin_arg_r, cosh_arg_i);
+        i = _mm256_mul_pd(cos_arg_r, sinh_arg_i);
+        R = _mm256_sub_pd(_mm256_mul_pd(r, hr), _mm256_mul_pd(i, hi));
+        I = _mm256_add_pd(_mm256_mul_pd(r, hi), _mm256_mul_pd(i, hr));
+    }
+
+    inline __m256d projection_fwd_avx(int kind, const projection_params* P, __m256d& X, __m256d& Y)
+    {
+        const __m256d halfpi = _mm256_set1_pd(HALFPI);
+        __m256d lam = X, phi = Y;
+        __m256d bad = _mm256_or_pd(
+            _mm256_cmp_pd(_mm256_sub_pd(abs_avx(phi), halfpi), _mm256_set1_pd(1e-12), _CMP_GT_OQ),
+            _mm256_cmp_pd(abs_avx(lam), _mm256_set1_pd(10), _CMP_GT_OQ));
+
+        phi = _mm256_max_pd(_mm256_min_pd(phi, halfpi), _mm256_set1_pd(-HALFPI));
+        lam = adjlon_avx(_mm256_sub_pd(adjlon_avx(lam), _mm256_set1_pd(P->lam0)));
+
+        if (kind == projection_webmerc)
+        {
+            const __m256d k0 = _mm256_set1_pd(P->k0);
+            X = _mm256_mul_pd(k0, lam);
+            Y = _mm256_mul_pd(k0, _mm256_asinh_pd(_mm256_tan_pd(phi)));
+        }
+        else
+        {
+            const __m256d one = _mm256_set1_pd(1);
+            __m256d cos_2phi;
+            __m256d sin_2phi = _mm256_sincos_pd(&cos_2phi, _mm256_add_pd(phi, phi));
+            __m256d Cn = gatg_avx(P->cbg, phi, cos_2phi, sin_2phi);
+
+            __m256d cos_Cn, cos_Ce;
+            __m256d sin_Cn = _mm256_sincos_pd(&cos_Cn, Cn);
+            __m256d sin_Ce = _mm256_sincos_pd(&cos_Ce, lam);
+
+            __m256d cos_Cn_cos_Ce = _mm256_mul_pd(cos_Cn, cos_Ce);
+            Cn = _mm256_atan2_pd(sin_Cn, cos_Cn_cos_Ce);
+
+            __m256d inv_denom_tan_Ce = _mm256_div_pd(one, _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(sin_Cn, sin_Cn), _mm256_mul_pd(cos_Cn_cos_Ce, cos_Cn_cos_Ce))));
+            __m256d tan_Ce = _mm256_mul_pd(_mm256_mul_pd(sin_Ce, cos_Cn), inv_denom_tan_Ce);
+            __m256d Ce = _mm256_asinh_pd(tan_Ce);
+
+            __m256d two_inv_denom_tan_Ce = _mm256_add_pd(inv_denom_tan_Ce, inv_denom_tan_Ce);
+            __m256d two_inv_denom_tan_Ce_square = _mm256_mul_pd(two_inv_denom_tan_Ce, inv_denom_tan_Ce);
+            __m256d tmp_r = _mm256_mul_pd(cos_Cn_cos_Ce, two_inv_denom_tan_Ce_square);
+            __m256d sin_arg_r = _mm256_mul_pd(sin_Cn, tmp_r);
+            __m256d cos_arg_r = _mm256_sub_pd(_mm256_mul_pd(cos_Cn_cos_Ce, tmp_r), one);
+            __m256d sinh_arg_i = _mm256_mul_pd(tan_Ce, two_inv_denom_tan_Ce);
+            __m256d cosh_arg_i = _mm256_sub_pd(two_inv_denom_tan_Ce_square, one);
+
+            __m256d dCn, dCe;
+            clenS_avx(P->gtu, sin_arg_r, cos_arg_r, sinh_arg_i, cosh_arg_i, dCn, dCe);
+            Cn = _mm256_add_pd(Cn, dCn);
+            Ce = _mm256_add_pd(Ce, dCe);
+
+            bad = _mm256_or_pd(bad, _mm256_cmp_pd(abs_avx(Ce), _mm256_set1_pd(2.623395162778), _CMP_GT_OQ));
+
+            const __m256d Qn = _mm256_set1_pd(P->Qn);
+            Y = _mm256_add_pd(_mm256_mul_pd(Qn, Cn), _mm256_set1_pd(P->Zb));
+            X = _mm256_mul_pd(Qn, Ce);
+        }
+
+        const __m256d a = _mm256_set1_pd(P->a);
+        X = _mm256_add_pd(_mm256_mul_pd(a, X), _mm256_set1_pd(P->x0));
+        Y = _mm256_add_pd(_mm256_mul_pd(a, Y), _mm256_set1_pd(P->y0));
+        return bad;
+    }
+
+    inline __m256d projection_inv_avx(int kind, const projection_params* P, __m256d& X, __m256d& Y)
+    {
+        const __m256d ra = _mm256_set1_pd(P->ra);
+        __m256d x = _mm256_mul_pd(_mm256_sub_pd(X, _mm256_set1_pd(P->x0)), ra);
+        __m256d y = _mm256_mul_pd(_mm256_sub_pd(Y, _mm256_set1_pd(P->y0)), ra);
+        __m256d bad = _mm256_setzero_pd();
+        __m256d lam, phi;
+
+        if (kind == projection_webmerc)
+        {
+            const __m256d k0 = _mm256_set1_pd(P->k0);
+            phi = _mm256_atan_pd(_mm256_sinh_pd(_mm256_div_pd(y, k0)));
+            lam = _mm256_div_pd(x, k0);
+        }
+        else
+        {
+            const __m256d one = _mm256_set1_pd(1);
+            const __m256d half = _mm256_set1_pd(0.5);
+            const __m256d Qn = _mm256_set1_pd(P->Qn);
+            __m256d Cn = _mm256_div_pd(_mm256_sub_pd(y, _mm256_set1_pd(P->Zb)), Qn);
+            __m256d Ce = _mm256_div_pd(x, Qn);
+
+            bad = _mm256_cmp_pd(abs_avx(Ce), _mm256_set1_pd(2.623395162778), _CMP_GT_OQ);
+
+            __m256d cos_arg_r;
+            __m256d sin_arg_r = _mm256_sincos_pd(&cos_arg_r, _mm256_add_pd(Cn, Cn));
+            __m256d exp_2_Ce = _mm256_exp_pd(_mm256_add_pd(Ce, Ce));
+            __m256d half_inv_exp_2_Ce = _mm256_div_pd(half, exp_2_Ce);
+            __m256d sinh_arg_i = _mm256_sub_pd(_mm256_mul_pd(half, exp_2_Ce), half_inv_exp_2_Ce);
+            __m256d cosh_arg_i = _mm256_add_pd(_mm256_mul_pd(half, exp_2_Ce), half_inv_exp_2_Ce);
+
+            __m256d dCn, dCe;
+            clenS_avx(P->utg, sin_arg_r, cos_arg_r, sinh_arg_i, cosh_arg_i, dCn, dCe);
+            Cn = _mm256_add_pd(Cn, dCn);
+            Ce = _mm256_add_pd(Ce, dCe);
+
+            __m256d cos_Cn;
+            __m256d sin_Cn = _mm256_sincos_pd(&cos_Cn, Cn);
+            __m256d sinhCe = _mm256_sinh_pd(Ce);
+            Ce = _mm256_atan2_pd(sinhCe, cos_Cn);
+            __m256d sinhCe_square = _mm256_mul_pd(sinhCe, sinhCe);
+            __m256d modulus_Ce = _mm256_sqrt_pd(_mm256_add_pd(sinhCe_square, _mm256_mul_pd(cos_Cn, cos_Cn)));
+            Cn = _mm256_atan2_pd(sin_Cn, modulus_Ce);
+
+            __m256d tmp = _mm256_div_pd(_mm256_add_pd(modulus_Ce, modulus_Ce), _mm256_add_pd(sinhCe_square, one));
+            __m256d sin_2_Cn = _mm256_mul_pd(sin_Cn, tmp);
+            __m256d cos_2_Cn = _mm256_sub_pd(_mm256_mul_pd(tmp, modulus_Ce), one);
+
+            phi = gatg_avx(P->cgb, Cn, cos_2_Cn, sin_2_Cn);
+            lam = Ce;
+        }
+
+        X = adjlon_avx(_mm256_add_pd(lam, _mm256_set1_pd(P->lam0)));
+        Y = phi;
+        return bad;
+    }
+
+    // Contiguous ranges. Returns the number of coordinates handled
+    int projection_avx(int kind, bool forward, const projection_params* P, double* x, double* y, double* z, int n)
+    {
+        const __m256d huge = _mm256_set1_pd(HUGE_VAL);
+
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256d X = _mm256_loadu_pd(x + i);
+            __m256d Y = _mm256_loadu_pd(y + i);
+            __m256d bad = _mm256_or_pd(_mm256_cmp_pd(X, huge, _CMP_EQ_OQ), _mm256_cmp_pd(Y, huge, _CMP_EQ_OQ));
+
+            if (z)
+                bad = _mm256_or_pd(bad, _mm256_cmp_pd(_mm256_loadu_pd(z + i), huge, _CMP_EQ_OQ));
+
+            bad = _mm256_or_pd(bad, forward ? projection_fwd_avx(kind, P, X, Y) : projection_inv_avx(kind, P, X, Y));
+
+            _mm256_storeu_pd(x + i, _mm256_blendv_pd(X, huge, bad));
+            _mm256_storeu_pd(y + i, _mm256_blendv_pd(Y, huge, bad));
+
+            if (z && _mm256_movemask_pd(bad))
+                _mm256_storeu_pd(z + i, _mm256_blendv_pd(_mm256_loadu_pd(z + i), huge, bad));
+        }
+        _mm256_zeroupper();
+        return i;
+    }
+#endif
+
+    void projection_apply(int kind, bool forward, const projection_params* P, double* x, int xs, double* y, int ys, double* z, int zs, int n)
+    {
+        int done = 0;
+#ifdef FAST_TRANSFORM_SVML
+        if (xs == 1 && ys == 1 && (!z || zs == 1) && has_avx())
+            done = projection_avx(kind, forward, P, x, y, z, n);
+#endif
+        projection_scalar(kind, forward, P, x, xs, y, ys, z, zs, done, n);
+    }
+}
+#pragma managed(pop)
+#pragma endregion
+
+#pragma region Affine
+// Pipelines of only affine, helmert, axisswap and unitconvert steps are a single affine transform
+private ref class AffineFastTransform sealed : FastTransform
+{
+private:
+    array<double>^ m_forward;
+    array<double>^ m_inverse;
+
+    static initonly array<String^>^ _affineKeys = gcnew array<String^> { "xoff", "yoff", "zoff", "s11", "s12", "s13", "s21", "s22", "s23", "s31", "s32", "s33", "toff", "tscale" };
+    static initonly array<double>^ _affineDefaults = gcnew array<double> { 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 1 };
+    // The linear units of PROJ's unitconvert, with their factor to meters
+    static initonly array<String^>^ _linearUnits = gcnew array<String^> { "m", "km", "dm", "cm", "mm", "kmi", "in", "ft", "yd", "mi", "fath", "ch", "link", "us-in", "us-ft", "us-yd", "us-ch", "us-mi" };
+    static initonly array<double>^ _linearFactors = gcnew array<double> { 1, 1000, 0.1, 0.01, 0.001, 1852, 0.0254, 0.3048, 0.9144, 1609.344, 1.8288, 20.1168, 0.201168,
+                                                                          100.0 / 3937.0, 1200.0 / 3937.0, 3600.0 / 3937.0, 79200.0 / 3937.0, 6336000.0 / 3937.0 };
+
+public:
+    AffineFastTransform(array<double>^ forward, array<double>^ inverse)
+    {
+        m_forward = forward;
+        m_inverse = inverse;
+    }
+
+    virtual void Apply(bool forward, double* x, int xStep, double* y, int yStep, double* z, int zStep, int count) override
+    {
+        pin_ptr<double> m = &(forward ? m_forward : m_inverse)[0];
+
+        affine_apply(m, x, xStep, y, yStep, z, zStep, count);
+    }
+
+public:
+    static array<double>^ Identity()
+    {
+        return gcnew array<double> { 1, 0, 0, 0,   0, 1, 0, 0,   0, 0, 1, 0 };
+    }
+
+    // Returns the transform applying first and then next
+    static array<double>^ Compose(array<double>^ first, array<double>^ next)
+    {
+        array<double>^ r = gcnew array<double>(12);
+
+        for (int row = 0; row < 3; row++)
+        {
+            for (int col = 0; col < 4; col++)
+            {
+                double v = (col == 3) ? next[row * 4 + 3] : 0;
+
+                for (int k = 0; k < 3; k++)
+                    v += next[row * 4 + k] * first[k * 4 + col];
+
+                r[row * 4 + col] = v;
+            }
+        }
+        return r;
+    }
+
+    // Gets the forward and inverse affine transform of a step as PROJ calculates them, or false if the step is not affine
+    static bool StepTransform(PipelineStep^ step, array<double>^% forward, array<double>^% inverse)
+    {
+        Dictionary<String^, String^>^ p = Parameters(step);
+
+        if (!p)
+            return false;
+        else if (step->Method == "noop")
+        {
+            forward = inverse = Identity();
+            return !p->Count;
+        }
+        else if (step->Method == "affine")
+            return AffineStep(p, forward, inverse);
+        else if (step->Method == "helmert")
+            return HelmertStep(p, forward, inverse);
+        else if (step->Method == "axisswap")
+            return AxisSwapStep(p, forward, inverse);
+        else if (step->Method == "unitconvert")
+            return UnitConvertStep(p, forward, inverse);
+
+        return false;
+    }
+
+    static Dictionary<String^, String^>^ Parameters(PipelineStep^ step)
+    {
+        auto p = gcnew Dictionary<String^, String^>();
+
+        for each (String ^ a in step->Args)
+        {
+            if (!a->StartsWith("+"))
+                return nullptr;
+
+            int eq = a->IndexOf('=');
+            String^ key = (eq > 0) ? a->Substring(1, eq - 1) : a->Substring(1);
+
+            if (key != "proj")
+                p[key] = (eq > 0) ? a->Substring(eq + 1) : "";
+        }
+        return p;
+    }
+
+    static bool OnlyKnown(Dictionary<String^, String^>^ p, array<String^>^ known)
+    {
+        for each (String ^ k in p->Keys)
+        {
+            if (Array::IndexOf(known, k) < 0)
+                return false;
+        }
+        return true;
+    }
+
+    static bool Number(Dictionary<String^, String^>^ p, String^ key, double defaultValue, double% value)
+    {
+        String^ v;
+        if (!p->TryGetValue(key, v))
+        {
+            value = defaultValue;
+            return true;
+        }
+        return Double::TryParse(v, NumberStyles::Float, CultureInfo::InvariantCulture, value);
+    }
+
+private:
+    static bool AffineStep(Dictionary<String^, String^>^ p, array<double>^% forward, array<double>^% inverse)
+    {
+        array<String^>^ keys = _affineKeys;
+        array<double>^ defaults = _affineDefaults;
+
+        if (!OnlyKnown(p, keys))
+            return false;
+
+        array<double>^ v = gcnew array<double>(keys->Length);
+        for (int i = 0; i < keys->Length; i++)
+        {
+            if (!Number(p, keys[i], defaults[i], v[i]))
+                return false;
+        }
+
+        if (v[12] != 0 || v[13] != 1)
+            return false; // Changes the time
+
+        forward = gcnew array<double> { v[3], v[4], v[5], v[0],   v[6], v[7], v[8], v[1],   v[9], v[10], v[11], v[2] };
+
+        // Like PROJ: the inverse of the matrix, applied after removing the offsets
+        double a = v[3], b = v[4], c = v[5], d = v[6], e = v[7], f = v[8], g = v[9], h = v[10], i = v[11];
+        double det = a * (e * i - f * h) - b * (d * i - f * g) + c * (d * h - e * g);
+
+        if (det == 0)
+            return false;
+
+        array<double>^ r = gcnew array<double> {
+            (e * i - f * h) / det, (c * h - b * i) / det, (b * f - c * e) / det, 0,
+            (f * g - d * i) / det, (a * i - c * g) / det, (c * d - a * f) / det, 0,
+            (d * h - e * g) / det, (b * g - a * h) / det, (a * e - b * d) / det, 0 };
+
+        array<double>^ offset = gcnew array<double> { 1, 0, 0, -v[0],   0, 1, 0, -v[1],   0, 0, 1, -v[2] };
+        inverse = Compose(offset, r);
+        return true;
+    }
+
+    static bool HelmertStep(Dictionary<String^, String^>^ p, array<double>^% forward, array<double>^% inverse)
+    {
+        // Time dependent (dx, ..., t_epoch), 2D (theta) and transposed variants are left to PROJ
+        if (!OnlyKnown(p, gcnew array<String^> { "x", "y", "z", "rx", "ry", "rz", "s", "convention", "exact" }))
+            return false;
+
+        double tx, ty, tz, rx, ry, rz, s;
+        if (!Number(p, "x", 0, tx) || !Number(p, "y", 0, ty) || !Number(p, "z", 0, tz)
+            || !Number(p, "rx", 0, rx) || !Number(p, "ry", 0, ry) || !Number(p, "rz", 0, rz)
+            || !Number(p, "s", 0, s))
+        {
+            return false;
+        }
+
+        String^ convention;
+        p->TryGetValue("convention", convention);
+
+        if ((rx != 0 || ry != 0 || rz != 0) && convention != "position_vector" && convention != "coordinate_frame")
+            return false;
+
+        // Rotations in arc seconds, scale in ppm
+        const double arcsec = Math::PI / 180.0 / 3600.0;
+        double f = rx * arcsec, t = ry * arcsec, q = rz * arcsec;
+        double scale = 1 + s * 1e-6;
+        array<double>^ R;
+
+        if (p->ContainsKey("exact"))
+        {
+            double cf = Math::Cos(f), sf = Math::Sin(f), ct = Math::Cos(t), st = Math::Sin(t), cp = Math::Cos(q), sp = Math::Sin(q);
+
+            R = gcnew array<double> {
+                ct * cp, cf * sp + sf * st * cp, sf * sp - cf * st * cp,
+                -ct * sp, cf * cp - sf * st * sp, sf * cp + cf * st * sp,
+                st, -sf * ct, cf * ct };
+        }
+        else
+        {
+            R = gcnew array<double> {
+                1, q, -t,
+                -q, 1, f,
+                t, -f, 1 };
+        }
+
+        if (convention == "position_vector")
+        {
+            // Transpose
+            double r;
+            r = R[1]; R[1] = R[3]; R[3] = r;
+            r = R[2]; R[2] = R[6]; R[6] = r;
+            r = R[5]; R[5] = R[7]; R[7] = r;
+        }
+
+        forward = gcnew array<double> {
+            scale * R[0], scale * R[1], scale * R[2], tx,
+            scale * R[3], scale * R[4], scale * R[5], ty,
+            scale * R[6], scale * R[7], scale * R[8], tz };
+
+        // Like PROJ: remove the translation and scale, then rotate by the transposed matrix
+        array<double>^ unshift = gcnew array<double> {
+            1 / scale, 0, 0, -tx / scale,
+            0, 1 / scale, 0, -ty / scale,
+            0, 0, 1 / scale, -tz / scale };
+        array<double>^ rotate = gcnew array<double> {
+            R[0], R[3], R[6], 0,
+            R[1], R[4], R[7], 0,
+            R[2], R[5], R[8], 0 };
+
+        inverse = Compose(unshift, rotate);
+        return true;
+    }
+
+    static bool AxisSwapStep(Dictionary<String^, String^>^ p, array<double>^% forward, array<double>^% inverse)
+    {
+        String^ order;
+        if (p->Count != 1 || !p->TryGetValue("order", order))
+            return false;
+
+        array<String^>^ parts = order->Split(',');
+        if (parts->Length < 2 || parts->Length > 4)
+            return false;
+
+        forward = Identity();
+        for (int i = 0; i < parts->Length; i++)
+        {
+            int o;
+            if (!Int32::TryParse(parts[i], NumberStyles::AllowLeadingSign, CultureInfo::InvariantCulture, o) || o == 0)
+                return false;
+
+            int axis = Math::Abs(o) - 1;
+
+            if (i == 3 || axis == 3)
+            {
+                if (i != axis || o < 0)
+                    return false; // Mixes time and space
+                continue;
+            }
+            else if (axis > 3)
+                return false;
+
+            forward[i * 4 + i] = 0;
+            forward[i * 4 + axis] = (o < 0) ? -1 : 1;
+        }
+
+        // Signed permutation: the inverse is the transpose
+        inverse = Identity();
+        for (int row = 0; row < 3; row++)
+        {
+            for (int col = 0; col < 3; col++)
+                inverse[row * 4 + col] = forward[col * 4 + row];
+        }
+        return true;
+    }
+
+    // Factor to meters or radians. Numbers are linear factors, like in PROJ
+    static bool UnitFactor(String^ unit, double% factor, bool% angular)
+    {
+        int n = Array::IndexOf(_linearUnits, unit);
+        angular = false;
+
+        if (n >= 0)
+        {
+            factor = _linearFactors[n];
+            return true;
+        }
+        else if (unit == "rad" || unit == "deg" || unit == "grad")
+        {
+            angular = true;
+            factor = (unit == "rad") ? 1 : (unit == "deg") ? Math::PI / 180.0 : Math::PI / 200.0;
+            return true;
+        }
+
+        return Double::TryParse(unit, NumberStyles::Float, CultureInfo::InvariantCulture, factor) && factor > 0;
+    }
+
+    static bool UnitRatio(Dictionary<String^, String^>^ p, String^ prefix, double% ratio)
+    {
+        String^ in;
+        String^ out;
+        bool hasIn = p->TryGetValue(prefix + "_in", in);
+        bool hasOut = p->TryGetValue(prefix + "_out", out);
+
+        ratio = 1;
+        if (!hasIn && !hasOut)
+            return true;
+        else if (!hasIn || !hasOut)
+            return false;
+
+        double fIn, fOut;
+        bool aIn, aOut;
+        if (!UnitFactor(in, fIn, aIn) || !UnitFactor(out, fOut, aOut) || aIn != aOut)
+            return false;
+
+        ratio = fIn / fOut;
+        return true;
+    }
+
+    static bool UnitConvertStep(Dictionary<String^, String^>^ p, array<double>^% forward, array<double>^% inverse)
+    {
+        if (!OnlyKnown(p, gcnew array<String^> { "xy_in", "xy_out", "z_in", "z_out", "t_in", "t_out" }))
+            return false;
+
+        String^ tIn;
+        String^ tOut;
+        p->TryGetValue("t_in", tIn);
+        p->TryGetValue("t_out", tOut);
+        if (!String::Equals(tIn, tOut))
+            return false; // Time conversions are not linear
+
+        double xy, z;
+        if (!UnitRatio(p, "xy", xy) || !UnitRatio(p, "z", z))
+            return false;
+
+        forward = gcnew array<double> { xy, 0, 0, 0,   0, xy, 0, 0,   0, 0, z, 0 };
+        inverse = gcnew array<double> { 1 / xy, 0, 0, 0,   0, 1 / xy, 0, 0,   0, 0, 1 / z, 0 };
+        return true;
+    }
+};
+#pragma endregion
+
+#pragma region Projection
+// Pipelines with one Web Mercator or Transverse Mercator (UTM) step between affine steps, like the conversions
+// between geographic coordinates and these projections
+private ref class ProjectionFastTransform sealed : FastTransform
+{
+private:
+    int m_kind;
+    bool m_inverted; // The projection step is applied inverse (+inv)
+    array<double>^ m_params;
+    // The affine steps around the projection, or nullptr when they don't change anything
+    array<double>^ m_preForward;
+    array<double>^ m_preInverse;
+    array<double>^ m_postForward;
+    array<double>^ m_postInverse;
+
+    // Points per block, to apply all steps while the coordinates are in the cache
+    literal int BlockSize = 512;
+
+    static initonly array<String^>^ _ellipsoids = gcnew array<String^> { "GRS80", "WGS84", "WGS72", "intl", "krass", "bessel" };
+    static initonly array<double>^ _ellipsoidA = gcnew array<double> { 6378137.0, 6378137.0, 6378135.0, 6378388.0, 6378245.0, 6377397.155 };
+    static initonly array<double>^ _ellipsoidRf = gcnew array<double> { 298.257222101, 298.257223563, 298.26, 297.0, 298.3, 299.1528128 };
+    static initonly array<String^>^ _ellipsoidKeys = gcnew array<String^> { "ellps", "a", "b", "rf", "f", "R", "units", "no_defs" };
+
+    ProjectionFastTransform(int kind, bool inverted, array<double>^ params, array<double>^ preForward, array<double>^ preInverse, array<double>^ postForward, array<double>^ postInverse)
+    {
+        m_kind = kind;
+        m_inverted = inverted;
+        m_params = params;
+        m_preForward = IsIdentity(preForward) ? nullptr : preForward;
+        m_preInverse = IsIdentity(preInverse) ? nullptr : preInverse;
+        m_postForward = IsIdentity(postForward) ? nullptr : postForward;
+        m_postInverse = IsIdentity(postInverse) ? nullptr : postInverse;
+    }
+
+public:
+    virtual void Apply(bool forward, double* x, int xStep, double* y, int yStep, double* z, int zStep, int count) override
+    {
+        array<double>^ first = forward ? m_preForward : m_postInverse;
+        array<double>^ last = forward ? m_postForward : m_preInverse;
+        bool project = (forward != m_inverted);
+
+        pin_ptr<double> pFirst = nullptr;
+        pin_ptr<double> pLast = nullptr;
+        pin_ptr<double> pParams = &m_params[0];
+        const projection_params* P = reinterpret_cast<const projection_params*>(static_cast<double*>(pParams));
+
+        if (first)
+            pFirst = &first[0];
+        if (last)
+            pLast = &last[0];
+
+        for (int start = 0; start < count; start += BlockSize)
+        {
+            int n = Math::Min(BlockSize, count - start);
+            double* bx = x + (ptrdiff_t)start * xStep;
+            double* by = y + (ptrdiff_t)start * yStep;
+            double* bz = z ? z + (ptrdiff_t)start * zStep : nullptr;
+
+            if (first)
+                affine_apply(pFirst, bx, xStep, by, yStep, bz, zStep, n);
+
+            projection_apply(m_kind, project, P, bx, xStep, by, yStep, bz, zStep, n);
+
+            if (last)
+                affine_apply(pLast, bx, xStep, by, yStep, bz, zStep, n);
+        }
+    }
+
+public:
+    // Returns the fast transform of the projection step with the affine transforms before and after it, or nullptr
+    // if the step is not supported. defaultTmercAlgo is the algorithm tmerc and utm use without +algo
+    static FastTransform^ Create(PipelineStep^ step, String^ defaultTmercAlgo, array<double>^ preForward, array<double>^ preInverse, array<double>^ postForward, array<double>^ postInverse)
+    {
+        Dictionary<String^, String^>^ p = AffineFastTransform::Parameters(step);
+        if (!p)
+            return nullptr;
+
+        double a, es;
+        double lon0, lat0, k0, x0, y0;
+        int kind;
+        String^ v;
+
+        if (!Ellipsoid(p, a, es))
+            return nullptr;
+        else if (p->TryGetValue("units", v) && v != "m")
+            return nullptr;
+
+        if (step->Method == "webmerc")
+        {
+            // Spherical Mercator on the semi major axis; PROJ ignores the scale factor
+            if (!Known(p, gcnew array<String^> { "lat_0", "lon_0", "x_0", "y_0", "k", "k_0" })
+                || !AffineFastTransform::Number(p, "lon_0", 0, lon0)
+                || !AffineFastTransform::Number(p, "x_0", 0, x0)
+                || !AffineFastTransform::Number(p, "y_0", 0, y0))
+            {
+                return nullptr;
+            }
+
+            kind = projection_webmerc;
+            k0 = 1;
+            lat0 = 0;
+        }
+        else if (step->Method == "tmerc" || step->Method == "etmerc" || step->Method == "utm")
+        {
+            // Only the Poder/Engsager algorithm, which PROJ uses on ellipsoids unless +approx, another +algo or another
+            // tmerc_default_algo in proj.ini is used. etmerc always uses it
+            if (es <= 0)
+                return nullptr;
+            else if (!p->TryGetValue("algo", v))
+                v = (step->Method == "etmerc") ? "poder_engsager" : defaultTmercAlgo;
+
+            if (v != "poder_engsager")
+                return nullptr;
+
+            kind = projection_tmerc;
+
+            if (step->Method == "utm")
+            {
+                int zone;
+                if (!Known(p, gcnew array<String^> { "zone", "south", "algo" })
+                    || !p->TryGetValue("zone", v)
+                    || !Int32::TryParse(v, NumberStyles::None, CultureInfo::InvariantCulture, zone)
+                    || zone < 1 || zone > 60)
+                {
+                    return nullptr;
+                }
+
+                lon0 = ((zone - 1) + 0.5) * 6.0 - 180.0;
+                lat0 = 0;
+                k0 = 0.9996;
+                x0 = 500000;
+                y0 = p->ContainsKey("south") ? 10000000 : 0;
+            }
+            else
+            {
+                if (!Known(p, gcnew array<String^> { "lat_0", "lon_0", "k", "k_0", "x_0", "y_0", "algo" })
+                    || !AffineFastTransform::Number(p, "lon_0", 0, lon0)
+                    || !AffineFastTransform::Number(p, "lat_0", 0, lat0)
+                    || !AffineFastTransform::Number(p, "x_0", 0, x0)
+                    || !AffineFastTransform::Number(p, "y_0", 0, y0)
+                    || !AffineFastTransform::Number(p, "k", 1, k0)
+                    || !AffineFastTransform::Number(p, "k_0", k0, k0))
+                {
+                    return nullptr;
+                }
+            }
+        }
+        else
+            return nullptr;
+
+        array<double>^ params = gcnew array<double>(sizeof(projection_params) / sizeof(double));
+        {
+            pin_ptr<double> pParams = &params[0];
+            projection_params* P = reinterpret_cast<projection_params*>(static_cast<double*>(pParams));
+            const double deg = Math::PI / 180.0;
+
+            P->a = a;
+            P->ra = 1 / a;
+            P->k0 = k0;
+            P->x0 = x0;
+            P->y0 = y0;
+            P->lam0 = lon0 * deg;
+
+            if (kind == projection_tmerc)
+                tmerc_setup(P, es, lat0 * deg);
+        }
+
+        return gcnew ProjectionFastTransform(kind, step->Inverse, params, preForward, preInverse, postForward, postInverse);
+    }
+
+private:
+    static bool IsIdentity(array<double>^ m)
+    {
+        array<double>^ identity = AffineFastTransform::Identity();
+
+        for (int i = 0; i < identity->Length; i++)
+        {
+            if (m[i] != identity[i])
+                return false;
+        }
+        return true;
+    }
+
+    // Only the projection keys and those of the ellipsoid
+    static bool Known(Dictionary<String^, String^>^ p, array<String^>^ keys)
+    {
+        for each (String ^ k in p->Keys)
+        {
+            if (Array::IndexOf(keys, k) < 0 && Array::IndexOf(_ellipsoidKeys, k) < 0)
+                return false;
+        }
+        return true;
+    }
+
+    // Gets the semi major axis and squared eccentricity of the ellipsoid PROJ uses for the step
+    static bool Ellipsoid(Dictionary<String^, String^>^ p, double% a, double% es)
+    {
+        String^ v;
+        double f;
+
+        if (p->ContainsKey("R"))
+        {
+            es = 0;
+            return !p->ContainsKey("ellps") && !p->ContainsKey("a") && AffineFastTransform::Number(p, "R", 0, a) && a > 0;
+        }
+        else if (p->ContainsKey("a"))
+        {
+            // Explicit definitions: a with one of rf, f or b, or a sphere
+            if (p->ContainsKey("ellps") || !AffineFastTransform::Number(p, "a", 0, a) || a <= 0)
+                return false;
+
+            double d;
+            if (p->ContainsKey("rf"))
+            {
+                if (!AffineFastTransform::Number(p, "rf", 0, d) || d <= 1)
+                    return false;
+                f = 1 / d;
+            }
+            else if (p->ContainsKey("f"))
+            {
+                if (!AffineFastTransform::Number(p, "f", 0, f) || f < 0 || f >= 1)
+                    return false;
+            }
+            else if (p->ContainsKey("b"))
+            {
+                if (!AffineFastTransform::Number(p, "b", 0, d) || d <= 0 || d > a)
+                    return false;
+                f = (a - d) / a;
+            }
+            else
+                f = 0;
+        }
+        else if (p->ContainsKey("rf") || p->ContainsKey("f") || p->ContainsKey("b"))
+            return false; // Changes a named ellipsoid; left to PROJ
+        else
+        {
+            // GRS80 is PROJ's default ellipsoid
+            int n = p->TryGetValue("ellps", v) ? Array::IndexOf(_ellipsoids, v) : 0;
+
+            if (n < 0)
+                return false;
+
+            a = _ellipsoidA[n];
+            f = 1 / _ellipsoidRf[n];
+        }
+
+        es = f * (2 - f);
+        return true;
+    }
+};
+#pragma endregion
+
+FastTransform^ FastTransform::Create(String^ definition, ProjContext^ ctx)
+{
+    if (!definition)
+        return nullptr;
+
+    auto steps = gcnew List<PipelineStep^>();
+    if (!PipelineStep::Parse(definition, steps) || !steps->Count)
+        return nullptr;
+
+    array<double>^ forward = AffineFastTransform::Identity();
+    array<double>^ inverse = AffineFastTransform::Identity();
+    // At most one step may be a projection, with the affine steps before and after it combined
+    PipelineStep^ projection = nullptr;
+    array<double>^ preForward;
+    array<double>^ preInverse;
+
+    for each (PipelineStep ^ s in steps)
+    {
+        array<double>^ f;
+        array<double>^ i;
+
+        if (s->HasOmit())
+            return nullptr;
+        else if (!AffineFastTransform::StepTransform(s, f, i))
+        {
+            if (projection)
+                return nullptr;
+
+            projection = s;
+            preForward = forward;
+            preInverse = inverse;
+            forward = AffineFastTransform::Identity();
+            inverse = AffineFastTransform::Identity();
+            continue;
+        }
+
+        if (s->Inverse)
+        {
+            array<double>^ t = f;
+            f = i;
+            i = t;
+        }
+
+        forward = AffineFastTransform::Compose(forward, f);
+        inverse = AffineFastTransform::Compose(i, inverse);
+    }
+
+    if (projection)
+        return ProjectionFastTransform::Create(projection, ctx->TmercDefaultAlgorithm, preForward, preInverse, forward, inverse);
+
+    return gcnew AffineFastTransform(forward, inverse);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+namespace SharpProj {
+    ref class PipelineStep;
+
+    // Vectorized implementation of a PROJ pipeline with a well known shape, used by CoordinateTransform instead of
+    // proj_trans_generic() for ranges of coordinates
+    private ref class FastTransform abstract
+    {
+    protected:
+        FastTransform()
+        {
+        }
+
+    public:
+        // Returns the fast implementation of the PROJ definition as it is instantiated on ctx, or nullptr if there is none
+        static FastTransform^ Create(String^ definition, ProjContext^ ctx);
+
+        // Transforms count coordinates in place. The x and y ranges are required, z is optional.
+        // Strides are in doubles, like CoordinateTransform::Apply()
+        virtual void Apply(bool forward, double* x, int xStep, double* y, int yStep, double* z, int zStep, int count) abstract;
+    };
+}
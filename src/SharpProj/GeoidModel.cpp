@@ -0,0 +1,281 @@
+#include "pch.h"
+#include "GeoidModel.h"
+#include "GridUsage.h"
+#include "ProjException.h"
+
+using namespace SharpProj;
+
+#pragma region Sampling
+namespace SharpProj {
+    // A transform from the geoid model on its own context, with buffers for one chunk of points
+    private ref class GeoidSampler sealed
+    {
+    public:
+        ProjContext^ Context;
+        CoordinateTransform^ Transform;
+        array<double>^ X;
+        array<double>^ Y;
+        array<double>^ Z;
+
+        GeoidSampler(ProjContext^ ctx, CoordinateTransform^ transform)
+        {
+            Context = ctx;
+            Transform = transform;
+            X = gcnew array<double>(GeoidModel::ChunkSize);
+            Y = gcnew array<double>(GeoidModel::ChunkSize);
+            Z = gcnew array<double>(GeoidModel::ChunkSize);
+        }
+
+        void Sample(array<double>^ longitudes, array<double>^ latitudes, array<double>^ undulations, int start, int count)
+        {
+            Array::Copy(longitudes, start, X, 0, count);
+            Array::Copy(latitudes, start, Y, 0, count);
+            Array::Clear(Z, 0, count);
+
+            {
+                pin_ptr<double> pX = &X[0];
+                pin_ptr<double> pY = &Y[0];
+                pin_ptr<double> pZ = &Z[0];
+
+                // vgridshift adds the interpolated grid value to the height of 0
+                Transform->Apply(
+                    pX, 1, count,
+                    pY, 1, count,
+                    pZ, 1, count,
+                    nullptr, 0, 0);
+            }
+
+            for (int i = 0; i < count; i++)
+            {
+                double z = Z[i];
+                undulations[start + i] = (z == HUGE_VAL) ? double::NaN : z;
+            }
+        }
+
+        void Close()
+        {
+            delete Transform;
+            delete Context;
+        }
+    };
+}
+
+// Runs the chunks of one Sample call over the threads of a Parallel.For
+private ref class GeoidSampleJob sealed
+{
+private:
+    initonly GeoidModel^ m_model;
+    initonly array<double>^ m_longitudes;
+    initonly array<double>^ m_latitudes;
+    initonly array<double>^ m_undulations;
+
+public:
+    GeoidSampleJob(GeoidModel^ model, array<double>^ longitudes, array<double>^ latitudes, array<double>^ undulations)
+    {
+        m_model = model;
+        m_longitudes = longitudes;
+        m_latitudes = latitudes;
+        m_undulations = undulations;
+    }
+
+    GeoidSampler^ CreateWorker()
+    {
+        return m_model->TakeSampler();
+    }
+
+    GeoidSampler^ Run(int chunk, System::Threading::Tasks::ParallelLoopState^ state, GeoidSampler^ sampler)
+    {
+        int start = chunk * GeoidModel::ChunkSize;
+        int count = Math::Min(GeoidModel::ChunkSize, m_longitudes->Length - start);
+
+        sampler->Sample(m_longitudes, m_latitudes, m_undulations, start, count);
+        return sampler;
+    }
+
+    void ReleaseWorker(GeoidSampler^ sampler)
+    {
+        m_model->ReturnSampler(sampler);
+    }
+};
+#pragma endregion
+
+GeoidModel::GeoidModel(ProjContext^ ctx, CoordinateTransform^ transform, String^ gridName, bool ownsContext)
+{
+    m_ctx = ctx;
+    m_transform = transform;
+    m_gridName = gridName;
+    m_ownsContext = ownsContext;
+    m_samplers = gcnew System::Collections::Concurrent::ConcurrentBag<GeoidSampler^>();
+}
+
+GeoidModel::~GeoidModel()
+{
+    if (m_samplers)
+    {
+        GeoidSampler^ s;
+        while (m_samplers->TryTake(s))
+            s->Close();
+        m_samplers = nullptr;
+    }
+
+    m_sampler = nullptr; // Shares m_transform and m_ctx
+
+    if (m_transform)
+    {
+        CoordinateTransform^ t = m_transform;
+        m_transform = nullptr;
+        delete t;
+    }
+
+    if (m_ownsContext)
+    {
+        ProjContext^ ctx = m_ctx;
+        m_ownsContext = false;
+        delete ctx;
+    }
+}
+
+GeoidModel^ GeoidModel::Open(String^ gridName, ProjContext^ ctx)
+{
+    if (String::IsNullOrWhiteSpace(gridName))
+        throw gcnew ArgumentNullException("gridName");
+
+    for each (Char c in gridName)
+    {
+        if (Char::IsWhiteSpace(c))
+            throw gcnew ArgumentException("Grid names can't contain whitespace", "gridName");
+    }
+
+    bool createdCtx = false;
+    if (!ctx)
+    {
+        ctx = gcnew ProjContext();
+        createdCtx = true;
+    }
+
+    try
+    {
+        // Longitude, latitude in degrees to the grid value as height. PROJ opens the grid while creating the step
+        String^ definition = "+proj=pipeline +step +proj=unitconvert +xy_in=deg +xy_out=rad +step +proj=vgridshift +grids=" + gridName + " +multiplier=1";
+        PJ* pj = proj_create(ctx, ::utf8_string(definition).c_str());
+
+        if (!pj)
+            throw ctx->ConstructException();
+
+        return gcnew GeoidModel(ctx, ctx->Create<CoordinateTransform^>(pj), gridName, createdCtx);
+    }
+    catch (Exception^)
+    {
+        if (createdCtx)
+            delete ctx;
+
+        throw;
+    }
+}
+
+GeoidModel^ GeoidModel::Open(GridUsage^ grid, ProjContext^ ctx)
+{
+    if (!grid)
+        throw gcnew ArgumentNullException("grid");
+
+    return Open(grid->Name, ctx);
+}
+
+GeoidSampler^ GeoidModel::TakeSampler()
+{
+    GeoidSampler^ s;
+
+    if (m_samplers->TryTake(s))
+        return s;
+
+    // Cloning reads the context and transform of the model
+    System::Threading::Monitor::Enter(this);
+    try
+    {
+        ProjContext^ ctx = m_ctx->Clone();
+        try
+        {
+            return gcnew GeoidSampler(ctx, m_transform->Clone(ctx));
+        }
+        catch (Exception^)
+        {
+            delete ctx;
+            throw;
+        }
+    }
+    finally
+    {
+        System::Threading::Monitor::Exit(this);
+    }
+}
+
+void GeoidModel::ReturnSampler(GeoidSampler^ sampler)
+{
+    if (m_samplers)
+        m_samplers->Add(sampler);
+    else
+        sampler->Close(); // Disposed while sampling
+}
+
+double GeoidModel::Sample(double longitude, double latitude)
+{
+    array<double>^ r = Sample(gcnew array<double> { longitude }, gcnew array<double> { latitude });
+
+    return r[0];
+}
+
+array<double>^ GeoidModel::Sample(array<double>^ longitudes, array<double>^ latitudes)
+{
+    if (!longitudes)
+        throw gcnew ArgumentNullException("longitudes");
+
+    array<double>^ r = gcnew array<double>(longitudes->Length);
+    Sample(longitudes, latitudes, r);
+    return r;
+}
+
+void GeoidModel::Sample(array<double>^ longitudes, array<double>^ latitudes, array<double>^ undulations)
+{
+    if (!longitudes)
+        throw gcnew ArgumentNullException("longitudes");
+    else if (!latitudes)
+        throw gcnew ArgumentNullException("latitudes");
+    else if (!undulations)
+        throw gcnew ArgumentNullException("undulations");
+    else if (latitudes->Length != longitudes->Length)
+        throw gcnew ArgumentException("Expected as many latitudes as longitudes", "latitudes");
+    else if (undulations->Length != longitudes->Length)
+        throw gcnew ArgumentException("Expected an undulation per longitude", "undulations");
+    else if (!m_transform)
+        throw gcnew ObjectDisposedException("GeoidModel");
+
+    int n = longitudes->Length;
+    if (!n)
+        return;
+
+    GeoidSampleJob^ job = gcnew GeoidSampleJob(this, longitudes, latitudes, undulations);
+    int chunks = (n + ChunkSize - 1) / ChunkSize;
+
+    if (chunks == 1)
+    {
+        // No need for a context of its own
+        System::Threading::Monitor::Enter(this);
+        try
+        {
+            if (!m_sampler)
+                m_sampler = gcnew GeoidSampler(m_ctx, m_transform);
+
+            m_sampler->Sample(longitudes, latitudes, undulations, 0, n);
+        }
+        finally
+        {
+            System::Threading::Monitor::Exit(this);
+        }
+        return;
+    }
+
+    System::Threading::Tasks::Parallel::For<GeoidSampler^>(0, chunks,
+        gcnew Func<GeoidSampler^>(job, &GeoidSampleJob::CreateWorker),
+        gcnew Func<int, System::Threading::Tasks::ParallelLoopState^, GeoidSampler^, GeoidSampler^>(job, &GeoidSampleJob::Run),
+        gcnew Action<GeoidSampler^>(job, &GeoidSampleJob::ReleaseWorker));
+}
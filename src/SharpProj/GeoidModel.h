@@ -0,0 +1,88 @@
+#pragma once
+#include "CoordinateTransform.h"
+
+namespace SharpProj {
+    ref class GeoidSampler;
+
+    namespace Proj {
+        ref class GridUsage;
+
+        /// <summary>
+        /// A geoid model grid, like those of <see cref="CoordinateReferenceSystemInfo::GetGeoidModels" />, from which the geoid
+        /// undulations (the height of the geoid above the ellipsoid) are sampled directly. The grid is opened once, by PROJ's grid
+        /// loading (including the network and file cache) also used by the transforms in <see cref="CoordinateTransform::GridUsages" />,
+        /// and bilinearly interpolated for arrays of points in parallel.
+        /// </summary>
+        [DebuggerDisplay("[GeoidModel] {GridName,nq}")]
+        public ref class GeoidModel sealed
+        {
+        private:
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            ProjContext^ m_ctx;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            CoordinateTransform^ m_transform;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            String^ m_gridName;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            bool m_ownsContext;
+            // Transforms on their own context, for sampling on multiple threads. Reused by later calls
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            System::Collections::Concurrent::ConcurrentBag<GeoidSampler^>^ m_samplers;
+            // Samples a single chunk with m_transform on m_ctx, under the lock of the model
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            GeoidSampler^ m_sampler;
+
+            GeoidModel(ProjContext^ ctx, CoordinateTransform^ transform, String^ gridName, bool ownsContext);
+            ~GeoidModel();
+
+        internal:
+            // Points sampled per thread at once
+            literal int ChunkSize = 16384;
+
+            GeoidSampler^ TakeSampler();
+            void ReturnSampler(GeoidSampler^ sampler);
+
+        public:
+            /// <summary>
+            /// Opens the geoid grid <paramref name="gridName"/> (like "us_noaa_g2018u0.tif"), which is found like PROJ finds all grids
+            /// </summary>
+            static GeoidModel^ Open(String^ gridName, [Optional] ProjContext^ ctx);
+            /// <summary>
+            /// Opens the vertical grid used by a transform, like the geoid grid of a transform to a compound CRS
+            /// </summary>
+            static GeoidModel^ Open(GridUsage^ grid, [Optional] ProjContext^ ctx);
+
+        public:
+            property String^ GridName
+            {
+                String^ get()
+                {
+                    return m_gridName;
+                }
+            }
+
+        public:
+            /// <summary>
+            /// Gets the undulation at the point, in meters, or NaN when the grid doesn't cover it
+            /// </summary>
+            /// <param name="longitude">Longitude in degrees</param>
+            /// <param name="latitude">Latitude in degrees</param>
+            double Sample(double longitude, double latitude);
+
+            /// <summary>
+            /// Gets the undulations at the points, in meters, or NaN where the grid doesn't cover them
+            /// </summary>
+            /// <param name="longitudes">Longitudes in degrees</param>
+            /// <param name="latitudes">Latitudes in degrees</param>
+            array<double>^ Sample(array<double>^ longitudes, array<double>^ latitudes);
+
+            /// <summary>
+            /// Stores the undulations at the points in <paramref name="undulations"/>, in meters, or NaN where the grid doesn't cover them
+            /// </summary>
+            /// <param name="longitudes">Longitudes in degrees</param>
+            /// <param name="latitudes">Latitudes in degrees</param>
+            /// <param name="undulations">Array with the length of <paramref name="longitudes"/> receiving the results</param>
+            void Sample(array<double>^ longitudes, array<double>^ latitudes, array<double>^ undulations);
+        };
+    }
+}
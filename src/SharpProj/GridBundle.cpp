@@ -0,0 +1,207 @@
+#include "pch.h"
+#include "ProjContext.h"
+#include "CoordinateTransform.h"
+#include "ChooseCoordinateTransform.h"
+#include "CoordinateReferenceSystem.h"
+#include "CoordinateArea.h"
+#include "GridUsage.h"
+#include "GridBundle.h"
+
+using namespace System::IO;
+using System::Collections::Generic::Dictionary;
+
+GridBundle::GridBundle(String^ directory, array<String^>^ files, array<String^>^ hashes)
+{
+    m_directory = directory;
+    m_files = Array::AsReadOnly(files);
+    m_hashes = hashes;
+}
+
+String^ GridBundle::HashFile(String^ path)
+{
+    auto sha = System::Security::Cryptography::SHA256::Create();
+    Stream^ s = File::OpenRead(path);
+    try
+    {
+        return BitConverter::ToString(sha->ComputeHash(s))->Replace("-", "")->ToLowerInvariant();
+    }
+    finally
+    {
+        delete s;
+        delete sha;
+    }
+}
+
+GridBundle^ GridBundle::Open(String^ directory)
+{
+    if (String::IsNullOrEmpty(directory))
+        throw gcnew ArgumentNullException("directory");
+
+    directory = Path::GetFullPath(directory);
+    auto files = gcnew List<String^>();
+    auto hashes = gcnew List<String^>();
+
+    for each (String ^ line in File::ReadAllLines(Path::Combine(directory, ManifestName)))
+    {
+        // sha256sum format: "<hash>  <name>", or "<hash> *<name>" in binary mode
+        if (line->Length < 67 || line->StartsWith("#"))
+            continue;
+
+        String^ name = line->Substring(66);
+
+        if (name->StartsWith("*"))
+            name = name->Substring(1);
+
+        hashes->Add(line->Substring(0, 64));
+        files->Add(name);
+    }
+
+    return gcnew GridBundle(directory, files->ToArray(), hashes->ToArray());
+}
+
+bool GridBundle::Verify()
+{
+    for (int i = 0; i < m_files->Count; i++)
+    {
+        String^ path = Path::Combine(m_directory, m_files[i]);
+
+        if (!File::Exists(path) || !String::Equals(HashFile(path), m_hashes[i], StringComparison::OrdinalIgnoreCase))
+            return false;
+    }
+    return true;
+}
+
+void GridBundle::Mount(ProjContext^ ctx)
+{
+    if (!ctx)
+        throw gcnew ArgumentNullException("ctx");
+
+    ctx->AddSearchPath(m_directory);
+}
+
+GridBundleBuilder::GridBundleBuilder(ProjArea^ area, ProjContext^ ctx)
+{
+    if (!area)
+        throw gcnew ArgumentNullException("area");
+    else if (!ctx)
+        throw gcnew ArgumentNullException("ctx");
+
+    m_area = area;
+    m_ctx = ctx;
+    m_grids = gcnew Dictionary<String^, String^>(StringComparer::OrdinalIgnoreCase);
+}
+
+void GridBundleBuilder::Add(CoordinateReferenceSystem^ sourceCrs, CoordinateReferenceSystem^ targetCrs)
+{
+    if (!sourceCrs)
+        throw gcnew ArgumentNullException("sourceCrs");
+    else if (!targetCrs)
+        throw gcnew ArgumentNullException("targetCrs");
+
+    auto area = gcnew CoordinateArea(m_area->WestLongitude, m_area->SouthLatitude, m_area->EastLongitude, m_area->NorthLatitude);
+    CoordinateTransform^ t = CoordinateTransform::Create(sourceCrs, targetCrs, area, m_ctx);
+    try
+    {
+        Add(t);
+    }
+    finally
+    {
+        delete t;
+    }
+}
+
+void GridBundleBuilder::Add(CoordinateTransform^ transform)
+{
+    if (!transform)
+        throw gcnew ArgumentNullException("transform");
+
+    AddGrids(transform);
+
+    ChooseCoordinateTransform^ choose = dynamic_cast<ChooseCoordinateTransform^>(transform);
+
+    if (choose)
+    {
+        for each (CoordinateTransform ^ c in choose)
+        {
+            auto usage = c->UsageArea;
+
+            // Skip candidates that are never used in our area
+            if (usage && !double::IsNaN(usage->WestLongitude)
+                && (usage->EastLongitude < m_area->WestLongitude || usage->WestLongitude > m_area->EastLongitude
+                    || usage->NorthLatitude < m_area->SouthLatitude || usage->SouthLatitude > m_area->NorthLatitude))
+            {
+                continue;
+            }
+
+            AddGrids(c);
+        }
+    }
+}
+
+void GridBundleBuilder::AddGrids(CoordinateTransform^ transform)
+{
+    for each (GridUsage ^ g in transform->GridUsages)
+    {
+        String^ name = g->Name;
+
+        if (String::IsNullOrEmpty(name) || m_grids->ContainsKey(name))
+            continue;
+
+        String^ fullName = g->FullName;
+
+        if (!String::IsNullOrEmpty(fullName) && File::Exists(fullName))
+            m_grids[name] = fullName;
+        else if (!String::IsNullOrEmpty(g->Url))
+            m_grids[name] = g->Url;
+        else
+            m_grids[name] = name;
+    }
+}
+
+GridBundle^ GridBundleBuilder::Build(String^ directory)
+{
+    if (String::IsNullOrEmpty(directory))
+        throw gcnew ArgumentNullException("directory");
+
+    directory = Path::GetFullPath(directory);
+    Directory::CreateDirectory(directory);
+
+    auto names = gcnew List<String^>(m_grids->Keys);
+    names->Sort(StringComparer::Ordinal);
+
+    array<String^>^ hashes = gcnew array<String^>(names->Count);
+    auto manifest = gcnew System::Text::StringBuilder();
+
+    manifest->AppendFormat(System::Globalization::CultureInfo::InvariantCulture,
+        "# SharpProj grid bundle for PROJ " PROJ_VERSION ", area W {0} S {1} E {2} N {3}\n",
+        m_area->WestLongitude, m_area->SouthLatitude, m_area->EastLongitude, m_area->NorthLatitude);
+
+    for (int i = 0; i < names->Count; i++)
+    {
+        String^ name = names[i];
+        String^ source = m_grids[name];
+        String^ target = Path::Combine(directory, Path::GetFileName(name));
+
+        if (!File::Exists(source))
+        {
+            // Let PROJ download the whole file into its user writable directory, using the network settings of the context
+            ::utf8_string src(source);
+
+            if (!proj_download_file(m_ctx, src.c_str(), false, nullptr, nullptr))
+                throw m_ctx->ConstructException(String::Format("Unable to download grid {0}", name));
+
+            source = Path::Combine(Utf8_PtrToString(proj_context_get_user_writable_directory(m_ctx, false)), Path::GetFileName(name));
+        }
+
+        if (!String::Equals(Path::GetFullPath(source), target, StringComparison::OrdinalIgnoreCase))
+            File::Copy(source, target, true);
+
+        hashes[i] = GridBundle::HashFile(target);
+        manifest->AppendFormat("{0}  {1}\n", hashes[i], Path::GetFileName(name));
+        names[i] = Path::GetFileName(name);
+    }
+
+    File::WriteAllText(Path::Combine(directory, GridBundle::ManifestName), manifest->ToString());
+
+    return gcnew GridBundle(directory, names->ToArray(), hashes);
+}
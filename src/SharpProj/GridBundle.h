@@ -0,0 +1,127 @@
+#pragma once
+
+namespace SharpProj {
+    ref class CoordinateTransform;
+    ref class CoordinateReferenceSystem;
+
+    namespace Proj {
+        ref class ProjArea;
+
+        /// <summary>
+        /// A local directory with the grid files used by a set of transforms, described by a manifest with checksums. Mount it
+        /// on a <see cref="ProjContext" /> to use these grids without network access.
+        /// </summary>
+        [DebuggerDisplay("{Directory,nq}")]
+        public ref class GridBundle sealed
+        {
+        private:
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly String^ m_directory;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly ReadOnlyCollection<String^>^ m_files;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly array<String^>^ m_hashes;
+
+        internal:
+            GridBundle(String^ directory, array<String^>^ files, array<String^>^ hashes);
+
+            static String^ HashFile(String^ path);
+
+        public:
+            /// <summary>
+            /// Name of the manifest file in the bundle directory. The manifest uses the sha256sum format.
+            /// </summary>
+            literal String^ ManifestName = "sharpproj-grids.sha256";
+
+            /// <summary>
+            /// Opens an existing bundle from its manifest
+            /// </summary>
+            /// <param name="directory"></param>
+            /// <returns></returns>
+            static GridBundle^ Open(String^ directory);
+
+            property String^ Directory
+            {
+                String^ get()
+                {
+                    return m_directory;
+                }
+            }
+
+            /// <summary>
+            /// Gets the names of the grid files in the bundle
+            /// </summary>
+            property ReadOnlyCollection<String^>^ Files
+            {
+                ReadOnlyCollection<String^>^ get()
+                {
+                    return m_files;
+                }
+            }
+
+            /// <summary>
+            /// Checks that all files in the bundle exist and match their checksums
+            /// </summary>
+            /// <returns>true if the bundle is intact, otherwise false</returns>
+            bool Verify();
+
+            /// <summary>
+            /// Adds the bundle directory to the search paths of <paramref name="ctx"/>
+            /// </summary>
+            /// <param name="ctx"></param>
+            void Mount(ProjContext^ ctx);
+        };
+
+        /// <summary>
+        /// Collects the grid files used by the transforms between CRS pairs in an area into a <see cref="GridBundle" />.
+        /// </summary>
+        public ref class GridBundleBuilder sealed
+        {
+        private:
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly ProjArea^ m_area;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly ProjContext^ m_ctx;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly System::Collections::Generic::Dictionary<String^, String^>^ m_grids; // Grid name -> local file or url
+
+        public:
+            /// <summary>
+            /// Creates a builder for the grids needed in <paramref name="area"/>. Grids that are not available locally are downloaded
+            /// through <paramref name="ctx"/>, which must have network connections enabled in that case.
+            /// </summary>
+            GridBundleBuilder(ProjArea^ area, ProjContext^ ctx);
+
+            /// <summary>
+            /// Adds the grids of all operations PROJ considers between <paramref name="sourceCrs"/> and <paramref name="targetCrs"/> in the area
+            /// </summary>
+            void Add(CoordinateReferenceSystem^ sourceCrs, CoordinateReferenceSystem^ targetCrs);
+
+            /// <summary>
+            /// Adds the grids used by <paramref name="transform"/>, including those of all its candidate operations
+            /// </summary>
+            void Add(CoordinateTransform^ transform);
+
+            /// <summary>
+            /// Gets the names of the grids collected so far
+            /// </summary>
+            property System::Collections::Generic::IEnumerable<String^>^ GridNames
+            {
+                System::Collections::Generic::IEnumerable<String^>^ get()
+                {
+                    return m_grids->Keys;
+                }
+            }
+
+            /// <summary>
+            /// Copies or downloads all collected grids into <paramref name="directory"/> and writes the manifest
+            /// </summary>
+            /// <param name="directory"></param>
+            /// <returns></returns>
+            GridBundle^ Build(String^ directory);
+
+        private:
+            void AddGrids(CoordinateTransform^ transform);
+        };
+    }
+}
@@ -16,6 +16,8 @@ namespace SharpProj {
             String^ m_name;
             [DebuggerBrowsable(DebuggerBrowsableState::Never)]
             String^ m_fullname;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            String^ m_url;
 
         internal:
             GridUsage(CoordinateTransform^ transform, int index)
@@ -59,6 +61,26 @@ namespace SharpProj {
                 }
             }
 
+            /// <summary>
+            /// Gets the url from which the grid can be downloaded, if known
+            /// </summary>
+            property String^ Url
+            {
+                String^ get()
+                {
+                    if (!m_url)
+                    {
+                        const char* pUrl;
+                        if (proj_coordoperation_get_grid_used(m_transform->Context, m_transform, m_index,
+                            nullptr, nullptr, nullptr, &pUrl, nullptr, nullptr, nullptr))
+                        {
+                            m_url = Utf8_PtrToString(pUrl);
+                        }
+                    }
+                    return m_url;
+                }
+            }
+
             property bool IsAvailable
             {
                 bool get()
@@ -0,0 +1,41 @@
+#pragma once
+
+// Position of the cell (x, y) on a Hilbert curve over a 65536 x 65536 grid
+static inline unsigned int hilbert_index(unsigned int x, unsigned int y)
+{
+    const unsigned int n = 65536;
+    unsigned int d = 0;
+
+    for (unsigned int s = n / 2; s > 0; s /= 2)
+    {
+        unsigned int rx = (x & s) ? 1 : 0;
+        unsigned int ry = (y & s) ? 1 : 0;
+        d += s * s * ((3 * rx) ^ ry);
+
+        if (!ry)
+        {
+            if (rx)
+            {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+
+            unsigned int t = x;
+            x = y;
+            y = t;
+        }
+    }
+    return d;
+}
+
+// Position of (x, y) on a 65536 x 65536 Hilbert curve over the box from (minX, minY) to (maxX, maxY)
+static inline unsigned int hilbert_index(double x, double y, double minX, double minY, double maxX, double maxY)
+{
+    const double n = 65536;
+    double fx = (maxX > minX) ? (x - minX) / (maxX - minX) * n : 0;
+    double fy = (maxY > minY) ? (y - minY) / (maxY - minY) * n : 0;
+
+    return hilbert_index(
+        (unsigned int)(fx < 0 ? 0 : fx > n - 1 ? n - 1 : fx),
+        (unsigned int)(fy < 0 ? 0 : fy > n - 1 ? n - 1 : fy));
+}
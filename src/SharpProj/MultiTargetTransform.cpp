@@ -0,0 +1,395 @@
+#include "pch.h"
+#include "MultiTargetTransform.h"
+#include "CoordinateReferenceSystem.h"
+#include "CoordinateArea.h"
+#include "PipelineStep.h"
+#include "ProjException.h"
+
+using namespace SharpProj;
+
+using System::Collections::Generic::List;
+
+#pragma region Planning
+// Builds the plan: a tree of pipeline segments where transforms starting with the same steps share the segment with those steps
+private ref class MultiTargetPlanner sealed
+{
+private:
+    ref class Node sealed
+    {
+    public:
+        PipelineStep^ Step;
+        List<Node^>^ Children;
+        List<int>^ Targets;
+        int TargetCount; // Including those of the children
+
+        Node()
+        {
+            Children = gcnew List<Node^>();
+            Targets = gcnew List<int>();
+        }
+    };
+
+    ProjContext^ m_ctx;
+    Node^ m_root;
+
+public:
+    List<CoordinateTransform^>^ Segments;
+    List<int>^ Parent;
+    List<bool>^ Owned;
+    array<int>^ TargetSegment;
+    int SharedSteps;
+
+    MultiTargetPlanner(ProjContext^ ctx, array<CoordinateTransform^>^ transforms)
+    {
+        m_ctx = ctx;
+        m_root = gcnew Node();
+        Segments = gcnew List<CoordinateTransform^>();
+        Parent = gcnew List<int>();
+        Owned = gcnew List<bool>();
+        TargetSegment = gcnew array<int>(transforms->Length);
+
+        for (int i = 0; i < transforms->Length; i++)
+        {
+            // No PROJ definition for ChooseCoordinateTransform, chains and operations PROJ can't export
+            String^ def = transforms[i]->AsProjString();
+            auto steps = gcnew List<PipelineStep^>();
+
+            if (!def || !PipelineStep::Parse(def, steps) || !CanSplit(steps))
+            {
+                // Run the transform itself on the source
+                Segments->Add(transforms[i]);
+                Parent->Add(-1);
+                Owned->Add(false);
+                TargetSegment[i] = Segments->Count - 1;
+                continue;
+            }
+
+            Node^ n = m_root;
+            n->TargetCount++;
+            for each (PipelineStep ^ s in steps)
+            {
+                if (s->Method == "noop")
+                    continue;
+
+                String^ key = s->Key;
+                Node^ next = nullptr;
+
+                for each (Node ^ c in n->Children)
+                {
+                    if (c->Step->Key == key)
+                    {
+                        next = c;
+                        break;
+                    }
+                }
+
+                if (!next)
+                {
+                    next = gcnew Node();
+                    next->Step = s;
+                    n->Children->Add(next);
+                }
+                n = next;
+                n->TargetCount++;
+            }
+            n->Targets->Add(i);
+        }
+
+        for each (int t in m_root->Targets)
+            TargetSegment[t] = -1; // Nothing to do
+
+        for each (Node ^ c in m_root->Children)
+            Emit(c, -1);
+    }
+
+private:
+    // Steps that keep state for later steps can't be run in separate pipelines
+    static bool CanSplit(List<PipelineStep^>^ steps)
+    {
+        for each (PipelineStep ^ s in steps)
+        {
+            if (s->Method == "push" || s->Method == "pop")
+                return false;
+        }
+        return true;
+    }
+
+    void Emit(Node^ first, int parent)
+    {
+        // Merge the steps up to the next branch or result in one segment
+        auto run = gcnew List<PipelineStep^>();
+        Node^ n = first;
+        run->Add(n->Step);
+
+        while (n->Children->Count == 1 && !n->Targets->Count)
+        {
+            n = n->Children[0];
+            run->Add(n->Step);
+        }
+
+        PJ* pj = proj_create(m_ctx, ::utf8_string(PipelineStep::ToDefinition(run)).c_str());
+
+        if (!pj)
+            throw m_ctx->ConstructException();
+
+        Segments->Add(m_ctx->Create<CoordinateTransform^>(pj));
+        Parent->Add(parent);
+        Owned->Add(true);
+
+        int index = Segments->Count - 1;
+
+        if (first->TargetCount > 1)
+            SharedSteps += run->Count;
+
+        for each (int t in n->Targets)
+            TargetSegment[t] = index;
+
+        for each (Node ^ c in n->Children)
+            Emit(c, index);
+    }
+};
+#pragma endregion
+
+MultiTargetTransform::MultiTargetTransform(ProjContext^ ctx, array<CoordinateTransform^>^ transforms, bool owned)
+{
+    m_transforms = transforms;
+    m_ownsTransforms = owned;
+
+    MultiTargetPlanner^ p = gcnew MultiTargetPlanner(ctx, transforms);
+
+    m_segments = p->Segments->ToArray();
+    m_parent = p->Parent->ToArray();
+    m_segmentOwned = p->Owned->ToArray();
+    m_targetSegment = p->TargetSegment;
+    m_sharedSteps = p->SharedSteps;
+}
+
+MultiTargetTransform::~MultiTargetTransform()
+{
+    if (m_segments)
+    {
+        for (int i = 0; i < m_segments->Length; i++)
+        {
+            if (m_segmentOwned[i])
+            {
+                CoordinateTransform^ s = m_segments[i];
+                delete s;
+            }
+        }
+        m_segments = nullptr;
+    }
+
+    if (m_transforms && m_ownsTransforms)
+    {
+        for each (CoordinateTransform ^ t in m_transforms)
+            delete t;
+    }
+    m_transforms = nullptr;
+}
+
+MultiTargetTransform^ MultiTargetTransform::Create(CoordinateReferenceSystem^ sourceCrs, IEnumerable<CoordinateReferenceSystem^>^ targetCrs, CoordinateTransformOptions^ options, ProjContext^ ctx)
+{
+    if (!sourceCrs)
+        throw gcnew ArgumentNullException("sourceCrs");
+    else if (!targetCrs)
+        throw gcnew ArgumentNullException("targetCrs");
+
+    if (!ctx)
+        ctx = sourceCrs->Context;
+    if (!options)
+        options = gcnew CoordinateTransformOptions();
+
+    auto transforms = gcnew List<CoordinateTransform^>();
+    try
+    {
+        for each (CoordinateReferenceSystem ^ t in targetCrs)
+            transforms->Add(CoordinateTransform::Create(sourceCrs, t, options, ctx));
+
+        return gcnew MultiTargetTransform(ctx, transforms->ToArray(), true);
+    }
+    catch (Exception^)
+    {
+        for each (CoordinateTransform ^ t in transforms)
+            delete t;
+        throw;
+    }
+}
+
+MultiTargetTransform^ MultiTargetTransform::Create(IEnumerable<CoordinateTransform^>^ transforms, ProjContext^ ctx)
+{
+    if (!transforms)
+        throw gcnew ArgumentNullException("transforms");
+
+    array<CoordinateTransform^>^ items = System::Linq::Enumerable::ToArray(transforms);
+
+    if (!items->Length)
+        throw gcnew ArgumentOutOfRangeException("transforms");
+
+    return gcnew MultiTargetTransform(ctx ? ctx : items[0]->Context, items, false);
+}
+
+void MultiTargetTransform::Transform(const double* source, int ordinates, int count, double** targets)
+{
+    const double missing[4] = { 0, 0, 0, HUGE_VAL };
+    const int stride = 4 * BlockSize;
+
+    // One block for the source and one for the output of each segment, each with 4 rows of ordinates
+    array<double>^ scratch = gcnew array<double>((m_segments->Length + 1) * stride);
+    pin_ptr<double> pScratch = &scratch[0];
+    double* buffers = pScratch + stride; // buffers - stride is the source
+
+    for (int start = 0; start < count; start += BlockSize)
+    {
+        int cnt = Math::Min(BlockSize, count - start);
+        const double* s = source + (ptrdiff_t)start * ordinates;
+
+        for (int d = 0; d < 4; d++)
+        {
+            double* row = pScratch + d * BlockSize;
+
+            if (d < ordinates)
+            {
+                for (int i = 0; i < cnt; i++)
+                    row[i] = s[i * ordinates + d];
+            }
+            else
+            {
+                for (int i = 0; i < cnt; i++)
+                    row[i] = missing[d];
+            }
+        }
+
+        // Each segment continues from the result of its parent, which is always handled before it
+        for (int n = 0; n < m_segments->Length; n++)
+        {
+            double* from = buffers + m_parent[n] * stride;
+            double* to = buffers + n * stride;
+
+            for (int d = 0; d < 4; d++)
+                memcpy(to + d * BlockSize, from + d * BlockSize, cnt * sizeof(double));
+
+            m_segments[n]->Apply(
+                to, 1, cnt,
+                to + BlockSize, 1, cnt,
+                to + 2 * BlockSize, 1, cnt,
+                to + 3 * BlockSize, 1, cnt);
+        }
+
+        for (int t = 0; t < m_targetSegment->Length; t++)
+        {
+            const double* from = buffers + m_targetSegment[t] * stride;
+            double* o = targets[t] + (ptrdiff_t)start * ordinates;
+
+            for (int d = 0; d < ordinates; d++)
+            {
+                const double* row = from + d * BlockSize;
+
+                for (int i = 0; i < cnt; i++)
+                    o[i * ordinates + d] = row[i];
+            }
+        }
+    }
+}
+
+array<PPoint>^ MultiTargetTransform::Apply(PPoint coordinate)
+{
+    double source[4] = { coordinate.X, coordinate.Y, coordinate.Z, coordinate.T };
+    int n = m_transforms->Length;
+    double* results = new double[4 * n];
+    double** targets = new double* [n];
+
+    try
+    {
+        for (int i = 0; i < n; i++)
+            targets[i] = results + 4 * i;
+
+        Transform(source, 4, 1, targets);
+
+        array<PPoint>^ r = gcnew array<PPoint>(n);
+        for (int i = 0; i < n; i++)
+        {
+            if (targets[i][0] == HUGE_VAL)
+            {
+                // The segment that failed ran on the context of the segment producing this target, or before it
+                int seg = m_targetSegment[i];
+                throw (seg >= 0 ? m_segments[seg] : m_transforms[i])->Context->ConstructException("Transform failed; Check Coordinates");
+            }
+
+            PJ_COORD c;
+            c.xyzt.x = targets[i][0];
+            c.xyzt.y = targets[i][1];
+            c.xyzt.z = targets[i][2];
+            c.xyzt.t = targets[i][3];
+
+            r[i] = m_transforms[i]->FromCoordinate(c, true);
+        }
+        return r;
+    }
+    finally
+    {
+        delete[] targets;
+        delete[] results;
+    }
+}
+
+array<array<double, 2>^>^ MultiTargetTransform::Apply(array<double, 2>^ ordinateArray)
+{
+    if (!ordinateArray)
+        throw gcnew ArgumentNullException("ordinateArray");
+
+    array<array<double, 2>^>^ r = gcnew array<array<double, 2>^>(m_transforms->Length);
+
+    for (int i = 0; i < r->Length; i++)
+        r[i] = gcnew array<double, 2>(ordinateArray->GetLength(0), ordinateArray->GetLength(1));
+
+    Apply(ordinateArray, r);
+    return r;
+}
+
+void MultiTargetTransform::Apply(array<double, 2>^ ordinateArray, ...array<array<double, 2>^>^ targets)
+{
+    if (!ordinateArray)
+        throw gcnew ArgumentNullException("ordinateArray");
+    else if (!targets || targets->Length != m_transforms->Length)
+        throw gcnew ArgumentException("Expected one target array per transform", "targets");
+
+    int count = ordinateArray->GetLength(0);
+    int ordinates = ordinateArray->GetLength(1);
+
+    if (ordinates < 2 || ordinates > 4)
+        throw gcnew ArgumentException("Invalid number of ordinate values", "ordinateArray");
+
+    for each (array<double, 2> ^ t in targets)
+    {
+        if (!t || t->GetLength(0) != count || t->GetLength(1) != ordinates)
+            throw gcnew ArgumentException("Target arrays must have the dimensions of the source", "targets");
+    }
+
+    if (!count)
+        return;
+
+    int n = targets->Length;
+    // Pin all arrays while the native code writes in them
+    array<System::Runtime::InteropServices::GCHandle>^ handles = gcnew array<System::Runtime::InteropServices::GCHandle>(n);
+    double** pTargets = new double* [n];
+    try
+    {
+        for (int i = 0; i < n; i++)
+        {
+            handles[i] = System::Runtime::InteropServices::GCHandle::Alloc(targets[i], System::Runtime::InteropServices::GCHandleType::Pinned);
+            pTargets[i] = (double*)handles[i].AddrOfPinnedObject().ToPointer();
+        }
+
+        pin_ptr<double> pSource = &ordinateArray[0, 0];
+        Transform(pSource, ordinates, count, pTargets);
+    }
+    finally
+    {
+        for (int i = 0; i < n; i++)
+        {
+            if (handles[i].IsAllocated)
+                handles[i].Free();
+        }
+        delete[] pTargets;
+    }
+}
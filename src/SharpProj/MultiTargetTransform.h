@@ -0,0 +1,100 @@
+#pragma once
+#include "CoordinateTransform.h"
+
+namespace SharpProj {
+    using System::Collections::Generic::IEnumerable;
+
+    /// <summary>
+    /// Transforms coordinates from one source to a number of targets at once. The leading pipeline steps the transforms have
+    /// in common (like the axis swap, unit conversion and datum shift from the source) are applied once per block of coordinates,
+    /// after which each target only applies its own remaining steps.
+    /// </summary>
+    [DebuggerDisplay("[MultiTargetTransform] Count={Count}")]
+    public ref class MultiTargetTransform sealed
+    {
+    private:
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        array<CoordinateTransform^>^ m_transforms;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        bool m_ownsTransforms;
+        // The shared plan, in an order where each segment follows the segment it continues from
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        array<CoordinateTransform^>^ m_segments;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        array<int>^ m_parent; // Segment whose output is the input of the segment, or -1 for the source
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        array<bool>^ m_segmentOwned; // False when the segment is one of the transforms that couldn't be split
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        array<int>^ m_targetSegment; // Segment producing the result of each transform, or -1 for the source
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        int m_sharedSteps;
+
+        // Points per block. 4 ordinates of 512 points fill 16 KB; well within the L1 cache
+        literal int BlockSize = 512;
+
+        MultiTargetTransform(ProjContext^ ctx, array<CoordinateTransform^>^ transforms, bool owned);
+        ~MultiTargetTransform();
+
+        void Transform(const double* source, int ordinates, int count, double** targets);
+
+    public:
+        /// <summary>
+        /// Creates a transform from <paramref name="sourceCrs"/> to each of <paramref name="targetCrs"/>
+        /// </summary>
+        static MultiTargetTransform^ Create(CoordinateReferenceSystem^ sourceCrs, IEnumerable<CoordinateReferenceSystem^>^ targetCrs, [Optional] CoordinateTransformOptions^ options, [Optional] ProjContext^ ctx);
+        /// <summary>
+        /// Creates a transform applying all <paramref name="transforms"/>, which should have the same source. The transforms are
+        /// used by the result, so keep them alive while using it.
+        /// </summary>
+        static MultiTargetTransform^ Create(IEnumerable<CoordinateTransform^>^ transforms, [Optional] ProjContext^ ctx);
+
+    public:
+        property int Count
+        {
+            int get()
+            {
+                return m_transforms->Length;
+            }
+        }
+
+        property CoordinateTransform^ default[int]
+        {
+            CoordinateTransform^ get(int index)
+            {
+                return m_transforms[index];
+            }
+        }
+
+        /// <summary>
+        /// Gets the number of pipeline steps applied once for all targets
+        /// </summary>
+        property int SharedStepCount
+        {
+            int get()
+            {
+                return m_sharedSteps;
+            }
+        }
+
+    public:
+        /// <summary>
+        /// Transforms a single coordinate to all targets
+        /// </summary>
+        /// <param name="coordinate"></param>
+        /// <returns>The coordinate in each target, in the order of the transforms</returns>
+        array<PPoint>^ Apply(PPoint coordinate);
+
+        /// <summary>
+        /// Transforms a series of coordinates, stored like <see cref="CoordinateTransform::Apply(array{double,2})" />, to all targets
+        /// </summary>
+        /// <param name="ordinateArray"></param>
+        /// <returns>The coordinates in each target, in the order of the transforms</returns>
+        array<array<double, 2>^>^ Apply(array<double, 2>^ ordinateArray);
+
+        /// <summary>
+        /// Transforms a series of coordinates to all targets, writing the results in the existing <paramref name="targets"/> arrays,
+        /// which have the same dimensions as <paramref name="ordinateArray"/>. One array per transform
+        /// </summary>
+        void Apply(array<double, 2>^ ordinateArray, ...array<array<double, 2>^>^ targets);
+    };
+}
@@ -0,0 +1,64 @@
+#include "pch.h"
+#include "NetworkStatistics.h"
+
+using System::Diagnostics::Stopwatch;
+using System::Threading::Interlocked;
+
+void NetworkCounters::Add(NetworkStatistics::Counter counter, long long value)
+{
+    Interlocked::Add(m_values[(int)counter], value);
+
+    if (m_parent)
+        m_parent->Add(counter, value);
+}
+
+void NetworkCounters::AddRequest(long long start)
+{
+    long long ticks = Stopwatch::GetTimestamp() - start;
+    double ms = ticks * 1000.0 / Stopwatch::Frequency;
+    int bucket = (ms <= 1.0) ? 0 : Math::Min(BucketCount - 1, (int)Math::Ceiling(Math::Log(ms, 2.0) * 4));
+
+    for (NetworkCounters^ c = this; c; c = c->m_parent)
+    {
+        Interlocked::Increment(c->m_values[(int)NetworkStatistics::Counter::Requests]);
+        Interlocked::Add(c->m_latencyTicks, ticks);
+        Interlocked::Increment(c->m_buckets[bucket]);
+    }
+
+#ifdef NETCORE
+    _duration->Record(ms);
+#endif
+}
+
+NetworkStatistics^ NetworkCounters::Snapshot()
+{
+    array<long long>^ values = gcnew array<long long>(m_values->Length);
+
+    for (int i = 0; i < values->Length; i++)
+        values[i] = Interlocked::Read(m_values[i]);
+
+    long long requests = values[(int)NetworkStatistics::Counter::Requests];
+    TimeSpan average = TimeSpan::Zero;
+    TimeSpan p99 = TimeSpan::Zero;
+
+    if (requests > 0)
+    {
+        average = TimeSpan::FromMilliseconds(Interlocked::Read(m_latencyTicks) * 1000.0 / Stopwatch::Frequency / requests);
+
+        long long seen = 0;
+        long long need = (long long)Math::Ceiling(requests * 0.99);
+
+        for (int i = 0; i < BucketCount; i++)
+        {
+            seen += Interlocked::Read(m_buckets[i]);
+
+            if (seen >= need)
+            {
+                p99 = TimeSpan::FromMilliseconds(Math::Pow(2.0, i / 4.0));
+                break;
+            }
+        }
+    }
+
+    return gcnew NetworkStatistics(values, average, p99);
+}
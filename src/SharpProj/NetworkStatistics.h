@@ -0,0 +1,229 @@
+#pragma once
+
+namespace SharpProj {
+    namespace Proj {
+        /// <summary>
+        /// Snapshot of the network and grid I/O counters of a <see cref="ProjContext" />, or of all contexts together
+        /// </summary>
+        [DebuggerDisplay("Requests={Requests}, Bytes={BytesDownloaded}")]
+        public ref class NetworkStatistics sealed
+        {
+        private:
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly array<long long>^ m_values;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly TimeSpan m_average;
+            [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+            initonly TimeSpan m_p99;
+
+        internal:
+            enum class Counter
+            {
+                Requests,
+                Bytes,
+                BlockCacheHits,
+                BlockCacheMisses,
+                FileCacheHits,
+                FileCacheMisses,
+                OperationCacheHits,
+                OperationCacheMisses,
+                Retries,
+                ETagMismatches,
+                Failures,
+                Count
+            };
+
+            NetworkStatistics(array<long long>^ values, TimeSpan average, TimeSpan p99)
+            {
+                m_values = values;
+                m_average = average;
+                m_p99 = p99;
+            }
+
+        public:
+            /// <summary>
+            /// Gets the number of HTTP(S) requests issued for grids
+            /// </summary>
+            property long long Requests
+            {
+                long long get() { return m_values[(int)Counter::Requests]; }
+            }
+
+            /// <summary>
+            /// Gets the number of grid bytes downloaded
+            /// </summary>
+            property long long BytesDownloaded
+            {
+                long long get() { return m_values[(int)Counter::Bytes]; }
+            }
+
+            /// <summary>
+            /// Gets the number of grid blocks served from the in-memory block cache
+            /// </summary>
+            property long long BlockCacheHits
+            {
+                long long get() { return m_values[(int)Counter::BlockCacheHits]; }
+            }
+
+            /// <summary>
+            /// Gets the number of grid blocks that had to be fetched
+            /// </summary>
+            property long long BlockCacheMisses
+            {
+                long long get() { return m_values[(int)Counter::BlockCacheMisses]; }
+            }
+
+            /// <summary>
+            /// Gets the number of file lookups (proj.db, grids, init files) answered from the file cache
+            /// </summary>
+            property long long FileCacheHits
+            {
+                long long get() { return m_values[(int)Counter::FileCacheHits]; }
+            }
+
+            /// <summary>
+            /// Gets the number of file lookups that had to search the disk
+            /// </summary>
+            property long long FileCacheMisses
+            {
+                long long get() { return m_values[(int)Counter::FileCacheMisses]; }
+            }
+
+            /// <summary>
+            /// Gets the number of transforms created from the operations stored in <see cref="ProjContext::OperationCacheDirectory" />
+            /// </summary>
+            property long long OperationCacheHits
+            {
+                long long get() { return m_values[(int)Counter::OperationCacheHits]; }
+            }
+
+            /// <summary>
+            /// Gets the number of transforms for which the operations were searched while <see cref="ProjContext::OperationCacheDirectory" /> was set
+            /// </summary>
+            property long long OperationCacheMisses
+            {
+                long long get() { return m_values[(int)Counter::OperationCacheMisses]; }
+            }
+
+            /// <summary>
+            /// Gets the number of requests that were retried after a connection failure
+            /// </summary>
+            property long long Retries
+            {
+                long long get() { return m_values[(int)Counter::Retries]; }
+            }
+
+            /// <summary>
+            /// Gets the number of requests rejected because the file changed on the server while it was being read
+            /// </summary>
+            property long long ETagMismatches
+            {
+                long long get() { return m_values[(int)Counter::ETagMismatches]; }
+            }
+
+            /// <summary>
+            /// Gets the number of requests that failed
+            /// </summary>
+            property long long Failures
+            {
+                long long get() { return m_values[(int)Counter::Failures]; }
+            }
+
+            /// <summary>
+            /// Gets the average time until the response headers of a request were received
+            /// </summary>
+            property TimeSpan AverageLatency
+            {
+                TimeSpan get() { return m_average; }
+            }
+
+            /// <summary>
+            /// Gets the 99th percentile of the time until the response headers of a request were received, with a precision of about 20%
+            /// </summary>
+            property TimeSpan P99Latency
+            {
+                TimeSpan get() { return m_p99; }
+            }
+        };
+
+        // Thread safe counters, per context and for the whole process
+        private ref class NetworkCounters sealed
+        {
+        private:
+            literal int BucketCount = 128; // Quarter octaves of milliseconds, up to about 40 days
+
+            initonly NetworkCounters^ m_parent;
+            initonly array<long long>^ m_values;
+            initonly array<long long>^ m_buckets;
+            long long m_latencyTicks;
+
+            static initonly NetworkCounters^ _global = gcnew NetworkCounters(nullptr);
+#ifdef NETCORE
+            static initonly System::Diagnostics::Metrics::Meter^ _meter;
+            static initonly System::Diagnostics::Metrics::Histogram<double>^ _duration;
+
+            static NetworkCounters()
+            {
+                using namespace System::Diagnostics::Metrics;
+
+                _meter = gcnew Meter("SharpProj", PROJ_VERSION);
+                _duration = _meter->CreateHistogram<double>("sharpproj.network.duration", "ms", "Time until the response headers of a grid request were received");
+
+                _meter->CreateObservableCounter<long long>("sharpproj.network.requests", gcnew Func<long long>(&ObserveRequests), "{request}", "Grid requests issued");
+                _meter->CreateObservableCounter<long long>("sharpproj.network.bytes", gcnew Func<long long>(&ObserveBytes), "By", "Grid bytes downloaded");
+                _meter->CreateObservableCounter<long long>("sharpproj.network.block_cache.hits", gcnew Func<long long>(&ObserveBlockCacheHits), "{block}", "Grid blocks served from memory");
+                _meter->CreateObservableCounter<long long>("sharpproj.network.block_cache.misses", gcnew Func<long long>(&ObserveBlockCacheMisses), "{block}", "Grid blocks fetched");
+                _meter->CreateObservableCounter<long long>("sharpproj.file_cache.hits", gcnew Func<long long>(&ObserveFileCacheHits), "{lookup}", "File lookups answered from the file cache");
+                _meter->CreateObservableCounter<long long>("sharpproj.file_cache.misses", gcnew Func<long long>(&ObserveFileCacheMisses), "{lookup}", "File lookups searching the disk");
+                _meter->CreateObservableCounter<long long>("sharpproj.operation_cache.hits", gcnew Func<long long>(&ObserveOperationCacheHits), "{transform}", "Transforms created from the operation cache");
+                _meter->CreateObservableCounter<long long>("sharpproj.operation_cache.misses", gcnew Func<long long>(&ObserveOperationCacheMisses), "{transform}", "Transforms searching the operations");
+                _meter->CreateObservableCounter<long long>("sharpproj.network.retries", gcnew Func<long long>(&ObserveRetries), "{request}", "Grid requests retried");
+                _meter->CreateObservableCounter<long long>("sharpproj.network.etag_mismatches", gcnew Func<long long>(&ObserveETagMismatches), "{request}", "Grid requests rejected because the file changed");
+                _meter->CreateObservableCounter<long long>("sharpproj.network.failures", gcnew Func<long long>(&ObserveFailures), "{request}", "Grid requests failed");
+            }
+
+            static long long ObserveRequests() { return _global->m_values[(int)NetworkStatistics::Counter::Requests]; }
+            static long long ObserveBytes() { return _global->m_values[(int)NetworkStatistics::Counter::Bytes]; }
+            static long long ObserveBlockCacheHits() { return _global->m_values[(int)NetworkStatistics::Counter::BlockCacheHits]; }
+            static long long ObserveBlockCacheMisses() { return _global->m_values[(int)NetworkStatistics::Counter::BlockCacheMisses]; }
+            static long long ObserveFileCacheHits() { return _global->m_values[(int)NetworkStatistics::Counter::FileCacheHits]; }
+            static long long ObserveFileCacheMisses() { return _global->m_values[(int)NetworkStatistics::Counter::FileCacheMisses]; }
+            static long long ObserveOperationCacheHits() { return _global->m_values[(int)NetworkStatistics::Counter::OperationCacheHits]; }
+            static long long ObserveOperationCacheMisses() { return _global->m_values[(int)NetworkStatistics::Counter::OperationCacheMisses]; }
+            static long long ObserveRetries() { return _global->m_values[(int)NetworkStatistics::Counter::Retries]; }
+            static long long ObserveETagMismatches() { return _global->m_values[(int)NetworkStatistics::Counter::ETagMismatches]; }
+            static long long ObserveFailures() { return _global->m_values[(int)NetworkStatistics::Counter::Failures]; }
+#endif
+
+            NetworkCounters(NetworkCounters^ parent)
+            {
+                m_parent = parent;
+                m_values = gcnew array<long long>((int)NetworkStatistics::Counter::Count);
+                m_buckets = gcnew array<long long>(BucketCount);
+            }
+
+        public:
+            NetworkCounters()
+                : NetworkCounters(_global)
+            {
+            }
+
+            static property NetworkCounters^ Global
+            {
+                NetworkCounters^ get() { return _global; }
+            }
+
+            void Add(NetworkStatistics::Counter counter, long long value);
+
+            void Increment(NetworkStatistics::Counter counter)
+            {
+                Add(counter, 1);
+            }
+
+            // Records a request, timed from start (a Stopwatch timestamp) until now
+            void AddRequest(long long start);
+
+            NetworkStatistics^ Snapshot();
+        };
+    }
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+namespace SharpProj {
+    // One step of a PROJ pipeline definition
+    private ref class PipelineStep sealed
+    {
+    public:
+        bool Inverse;
+        String^ Method;
+        array<String^>^ Args; // In definition order, without +inv
+        array<String^>^ Sorted; // For comparing steps
+
+        PipelineStep(System::Collections::Generic::List<String^>^ tokens)
+        {
+            Inverse = tokens->Remove("+inv");
+            Args = tokens->ToArray();
+            Sorted = SortArgs(Args);
+
+            for each (String ^ t in Args)
+            {
+                if (t->StartsWith("+proj="))
+                    Method = t->Substring(6);
+            }
+        }
+
+        static array<String^>^ SortArgs(array<String^>^ args)
+        {
+            array<String^>^ r = static_cast<array<String^>^>(args->Clone());
+            Array::Sort(r, StringComparer::Ordinal);
+            return r;
+        }
+
+        bool HasOmit()
+        {
+            return Array::IndexOf(Args, "+omit_fwd") >= 0 || Array::IndexOf(Args, "+omit_inv") >= 0;
+        }
+
+        static bool SameArgs(array<String^>^ a, array<String^>^ b)
+        {
+            if (a->Length != b->Length)
+                return false;
+
+            for (int i = 0; i < a->Length; i++)
+            {
+                if (!String::Equals(a[i], b[i]))
+                    return false;
+            }
+            return true;
+        }
+
+        static String^ SwapUnit(String^ arg)
+        {
+            for each (String ^ p in gcnew array<String^> { "xy", "z", "t" })
+            {
+                if (arg->StartsWith("+" + p + "_in="))
+                    return "+" + p + "_out=" + arg->Substring(p->Length + 5);
+                else if (arg->StartsWith("+" + p + "_out="))
+                    return "+" + p + "_in=" + arg->Substring(p->Length + 6);
+            }
+            return arg;
+        }
+
+        // Whether applying this step followed by next is a no-op
+        bool Cancels(PipelineStep^ next)
+        {
+            if (!Method || !String::Equals(Method, next->Method) || HasOmit() || next->HasOmit())
+                return false;
+
+            if (Inverse != next->Inverse)
+                return SameArgs(Sorted, next->Sorted); // X followed by inverse X
+
+            if (Method == "axisswap")
+                return Args->Length == 2 && Array::IndexOf(Args, "+order=2,1") >= 0 && SameArgs(Sorted, next->Sorted); // Swapping twice
+
+            if (Method == "unitconvert")
+                return SameArgs(Sorted, SortArgs(Array::ConvertAll(next->Args, gcnew Converter<String^, String^>(&PipelineStep::SwapUnit))));
+
+            return false;
+        }
+
+        // Parses a PROJ definition into its steps. Returns false when it can't be merged in another pipeline
+        static bool Parse(String^ definition, System::Collections::Generic::List<PipelineStep^>^ into)
+        {
+            array<String^>^ tokens = definition->Split(gcnew array<wchar_t> { L' ', L'\t', L'\r', L'\n' }, StringSplitOptions::RemoveEmptyEntries);
+
+            if (!tokens->Length)
+                return false;
+
+            bool pipeline = (tokens[0] == "+proj=pipeline");
+            int i = pipeline ? 1 : 0;
+
+            if (pipeline && i < tokens->Length && tokens[i] != "+step")
+                return false; // Options that apply to all steps of the pipeline
+
+            System::Collections::Generic::List<String^>^ step = pipeline ? nullptr : gcnew System::Collections::Generic::List<String^>();
+
+            for (; i < tokens->Length; i++)
+            {
+                String^ t = tokens[i];
+
+                if (t == "+type=crs")
+                    return false;
+                else if (pipeline && t == "+step")
+                {
+                    if (step)
+                        into->Add(gcnew PipelineStep(step));
+                    step = gcnew System::Collections::Generic::List<String^>();
+                }
+                else
+                    step->Add(t);
+            }
+
+            if (step)
+                into->Add(gcnew PipelineStep(step));
+            return true;
+        }
+
+        // Creates a single pipeline running first and then second, without the steps that cancel each other
+        static String^ Fuse(String^ first, String^ second)
+        {
+            auto steps = gcnew System::Collections::Generic::List<PipelineStep^>();
+
+            if (!Parse(first, steps) || !Parse(second, steps))
+                return nullptr;
+
+            auto kept = gcnew System::Collections::Generic::List<PipelineStep^>();
+            for each (PipelineStep ^ s in steps)
+            {
+                if (s->Method == "noop")
+                    continue;
+                else if (kept->Count && kept[kept->Count - 1]->Cancels(s))
+                    kept->RemoveAt(kept->Count - 1);
+                else
+                    kept->Add(s);
+            }
+
+            return ToDefinition(kept);
+        }
+
+        // Creates the PROJ definition of a pipeline with the steps
+        static String^ ToDefinition(System::Collections::Generic::IList<PipelineStep^>^ steps)
+        {
+            if (!steps->Count)
+                return "+proj=noop";
+
+            auto sb = gcnew System::Text::StringBuilder("+proj=pipeline");
+            for each (PipelineStep ^ s in steps)
+            {
+                sb->Append(" +step");
+                if (s->Inverse)
+                    sb->Append(" +inv");
+
+                for each (String ^ a in s->Args)
+                    sb->Append(L' ')->Append(a);
+            }
+            return sb->ToString();
+        }
+
+        // Identifies the step independent of the order of its arguments
+        property String^ Key
+        {
+            String^ get()
+            {
+                return (Inverse ? "+inv " : "") + String::Join(" ", Sorted);
+            }
+        }
+    };
+}
@@ -12,8 +12,8 @@ PrimeMeridian^ PrimeMeridian::CreateFromDatabase(String^ authority, String^ code
 	if (!ctx)
 		ctx = gcnew ProjContext();
 
-	std::string authStr = utf8_string(authority);
-	std::string codeStr = utf8_string(code);
+	utf8_string authStr(authority);
+	utf8_string codeStr(code);
 	PJ* pj = proj_create_from_database(ctx, authStr.c_str(), codeStr.c_str(), PJ_CATEGORY_PRIME_MERIDIAN, false, nullptr);
 
 	if (pj)
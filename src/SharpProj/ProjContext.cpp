@@ -1,22 +1,104 @@
 #include "pch.h"
 
-#include <locale>
-#include <codecvt>
 #include "ProjContext.h"
 #include "ProjException.h"
 #include "ProjFactory.h"
+#include "NetworkStatistics.h"
 
 using namespace SharpProj;
 using namespace System::IO;
 using System::Collections::Generic::List;
 
-std::string utf8_string(String^ v)
+static size_t utf8_encode(const wchar_t* p, size_t len, char* dest, size_t dest_size)
 {
-    std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> conv;
-    pin_ptr<const wchar_t> pPath = PtrToStringChars(v);
-    std::wstring vstr(pPath);
-    std::string sstr(conv.to_bytes(vstr));
-    return sstr;
+    size_t n = 0;
+
+    if (!dest_size)
+        return 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned int c = p[i];
+        size_t need = (c < 0x80) ? 1 : (c < 0x800) ? 2 : 3;
+
+        if (c >= 0xD800 && c <= 0xDFFF)
+        {
+            if (c <= 0xDBFF && i + 1 < len && p[i + 1] >= 0xDC00 && p[i + 1] <= 0xDFFF)
+            {
+                if (n + 4 >= dest_size)
+                    break;
+
+                c = 0x10000 + ((c - 0xD800) << 10) + (p[++i] - 0xDC00);
+                dest[n++] = (char)(0xF0 | (c >> 18));
+                dest[n++] = (char)(0x80 | ((c >> 12) & 0x3F));
+                dest[n++] = (char)(0x80 | ((c >> 6) & 0x3F));
+                dest[n++] = (char)(0x80 | (c & 0x3F));
+                continue;
+            }
+            c = 0xFFFD; // Lone surrogate. Same replacement as Encoding::UTF8
+        }
+
+        if (n + need >= dest_size)
+            break;
+
+        switch (need)
+        {
+        case 1:
+            dest[n++] = (char)c;
+            break;
+        case 2:
+            dest[n++] = (char)(0xC0 | (c >> 6));
+            dest[n++] = (char)(0x80 | (c & 0x3F));
+            break;
+        default:
+            dest[n++] = (char)(0xE0 | (c >> 12));
+            dest[n++] = (char)(0x80 | ((c >> 6) & 0x3F));
+            dest[n++] = (char)(0x80 | (c & 0x3F));
+            break;
+        }
+    }
+
+    dest[n] = 0;
+    return n;
+}
+
+size_t utf8_encode(String^ v, char* dest, size_t dest_size)
+{
+    if (!dest || !dest_size)
+        return 0;
+    else if (!v)
+    {
+        dest[0] = 0;
+        return 0;
+    }
+
+    pin_ptr<const wchar_t> pStr = PtrToStringChars(v);
+    return utf8_encode(pStr, v->Length, dest, dest_size);
+}
+
+utf8_string::utf8_string(String^ v)
+{
+    m_str = m_buf;
+
+    if (!v)
+    {
+        m_buf[0] = 0;
+        m_len = 0;
+        return;
+    }
+
+    size_t sz = utf8_max_size(v->Length);
+
+    if (sz > sizeof(m_buf))
+    {
+        m_str = (char*)malloc(sz);
+
+        if (!m_str)
+            throw gcnew OutOfMemoryException();
+    }
+
+    pin_ptr<const wchar_t> pStr = PtrToStringChars(v);
+    m_len = utf8_encode(pStr, v->Length, m_str, sz);
 }
 
 const char* ProjContext::utf8_string(String^ value)
@@ -34,12 +116,16 @@ const char* ProjContext::utf8_string(String^ value)
 
 const char* ProjContext::utf8_chain(String^ value, void*& chain)
 {
-    std::string v = ::utf8_string(value);
-    size_t slen = v.length() + 1;
-    void** pp = (void**)malloc(slen + sizeof(void*));
+    size_t sz = utf8_max_size(value ? value->Length : 0);
+    void** pp = (void**)malloc(sz + sizeof(void*));
+    if (!pp)
+        throw gcnew OutOfMemoryException();
+
     pp[0] = chain;
     chain = pp;
-    return (char*)memcpy(&pp[1], v.c_str(), slen);
+
+    utf8_encode(value, (char*)&pp[1], sz);
+    return (const char*)&pp[1];
 }
 
 void ProjContext::free_chain(void*& chain)
@@ -56,7 +142,7 @@ void ProjContext::free_chain(void*& chain)
 static const char* my_file_finder(PJ_CONTEXT* ctx, const char* file, void* user_data)
 {
     UNUSED_ALWAYS(ctx);
-    const auto& ref = *(ctx_wrapper<PJ_CONTEXT, ProjContext>*)user_data;
+    auto& ref = *(ctx_wrapper<PJ_CONTEXT, ProjContext>*)user_data;
 
     ProjContext^ pc;
     if (ref.TryGetTarget(pc))
@@ -67,6 +153,9 @@ static const char* my_file_finder(PJ_CONTEXT* ctx, const char* file, void* user_
 
         String^ newFile = pc->FindFile(origFile);
 
+        if (newFile && origFile == "proj.db")
+            ref.DatabaseOpened();
+
         if (newFile && !origFile->Equals(newFile))
             return pc->utf8_string(newFile);
         else
@@ -110,6 +199,7 @@ ProjContext::ProjContext(PJ_CONTEXT* ctx)
         throw gcnew ArgumentNullException("ctx");
 
     m_ctx.SetTarget(this);
+    m_counters = gcnew NetworkCounters();
 
     proj_context_set_file_finder(m_ctx, my_file_finder, &m_ctx);
     proj_log_func(m_ctx, &m_ctx, my_log_func);
@@ -123,6 +213,11 @@ ProjContext^ ProjContext::Clone()
     auto pc = gcnew ProjContext(proj_context_clone(this));
 
     pc->m_logLevel = m_logLevel;
+    pc->m_enableNetwork = m_enableNetwork;
+
+    // PROJ copies the search paths of the native context; keep ours in sync for AddSearchPath and the grid search key
+    if (m_searchPaths)
+        pc->m_searchPaths = gcnew List<String^>(m_searchPaths);
     return pc;
 }
 
@@ -162,7 +257,7 @@ String^ ProjContext::GetMetaData(String^ key)
     if (String::IsNullOrEmpty(key))
         throw gcnew ArgumentNullException("key");
 
-    std::string skey = utf8_string(key);
+    ::utf8_string skey(key);
 
     const char* v = proj_context_get_database_metadata(this, skey.c_str());
 
@@ -172,6 +267,96 @@ String^ ProjContext::GetMetaData(String^ key)
     return Utf8_PtrToString(v);
 }
 
+String^ ProjContext::GetDatabaseVersionKey()
+{
+    System::Text::StringBuilder^ key = gcnew System::Text::StringBuilder(Utf8_PtrToString(proj_context_get_database_path(this)));
+
+    for each (String ^ md in gcnew array<String^> { "DATABASE.LAYOUT.VERSION.MAJOR", "DATABASE.LAYOUT.VERSION.MINOR", "EPSG.VERSION", "ESRI.VERSION", "IGNF.VERSION", "PROJ_DATA.VERSION" })
+    {
+        const char* v = proj_context_get_database_metadata(this, ::utf8_string(md).c_str());
+        key->Append('|')->Append(Utf8_PtrToString(v));
+    }
+
+    return key->ToString();
+}
+
+String^ ProjContext::GetGridSearchKey()
+{
+    System::Text::StringBuilder^ key = gcnew System::Text::StringBuilder();
+    List<String^>^ dirs = gcnew List<String^>(ProjLibDirs);
+
+    if (m_searchPaths)
+        dirs->AddRange(m_searchPaths);
+
+    String^ userDir = Utf8_PtrToString(proj_context_get_user_writable_directory(this, false));
+    if (!String::IsNullOrEmpty(userDir))
+        dirs->Add(userDir);
+
+    // The write time of a directory changes when files are added to, removed from or renamed in it
+    for each (String ^ dir in dirs)
+    {
+        key->Append(dir)->Append('|');
+        try
+        {
+            if (Directory::Exists(dir))
+                key->Append(Directory::GetLastWriteTimeUtc(dir).Ticks);
+        }
+        catch (IOException^)
+        {
+        }
+        catch (UnauthorizedAccessException^)
+        {
+        }
+        key->AppendLine();
+    }
+
+    return key->ToString();
+}
+
+String^ ProjContext::TmercDefaultAlgorithm::get()
+{
+    if (m_tmercDefaultAlgo)
+        return m_tmercDefaultAlgo;
+
+    String^ algo = "poder_engsager";
+    String^ ini = FindFile("proj.ini");
+
+    if (!ini && m_searchPaths)
+    {
+        for each (String ^ dir in m_searchPaths)
+        {
+            if (File::Exists(Path::Combine(dir, "proj.ini")))
+            {
+                ini = Path::Combine(dir, "proj.ini");
+                break;
+            }
+        }
+    }
+
+    if (ini)
+    {
+        try
+        {
+            for each (String ^ line in File::ReadAllLines(ini))
+            {
+                String^ l = line->Trim();
+                int eq = l->IndexOf('=');
+
+                if (eq > 0 && !l->StartsWith("#") && l->Substring(0, eq)->Trim() == "tmerc_default_algo")
+                    algo = l->Substring(eq + 1)->Trim();
+            }
+        }
+        catch (IOException^)
+        {
+        }
+        catch (UnauthorizedAccessException^)
+        {
+        }
+    }
+
+    return m_tmercDefaultAlgo = algo;
+}
+
 Version^ ProjContext::EpsgVersion::get()
 {
     String^ md = GetMetaData("EPSG.VERSION");
@@ -396,6 +581,47 @@ void ProjContext::TouchFile(String^ file)
 }
 
 String^ ProjContext::FindFile(String^ file)
+{
+    if (!file)
+        return nullptr;
+
+    auto cache = _fileCache;
+    if (!cache)
+    {
+        System::Threading::Interlocked::CompareExchange<System::Collections::Concurrent::ConcurrentDictionary<String^, String^>^>(_fileCache, gcnew System::Collections::Concurrent::ConcurrentDictionary<String^, String^>(StringComparer::Ordinal), nullptr);
+        cache = _fileCache;
+    }
+
+    // Watch before trusting the cache, so entries found before the first miss are dropped when their files go away
+    if (!_fileWatchers)
+        SetupFileWatchers(Utf8_PtrToString(proj_context_get_user_writable_directory(this, false)));
+
+    String^ result;
+    if (cache->TryGetValue(file, result))
+    {
+        m_counters->Increment(Proj::NetworkStatistics::Counter::FileCacheHits);
+
+        if (String::IsNullOrEmpty(result))
+            return nullptr; // Empty string is a negative entry
+
+        // Keep the files copied to the user directory recently used, like on an uncached lookup
+        if (Path::GetFileName(result)->StartsWith("#proj" "-" PROJ_VERSION "-", StringComparison::Ordinal))
+            TouchFile(result);
+
+        return result;
+    }
+
+    m_counters->Increment(Proj::NetworkStatistics::Counter::FileCacheMisses);
+    bool cacheable = true;
+    result = FindFileUncached(file, cacheable);
+
+    if (cacheable)
+        cache[file] = result ? result : String::Empty;
+
+    return result;
+}
+
+String^ ProjContext::FindFileUncached(String^ file, bool% cacheable)
 {
     String^ testFile;
 
@@ -408,7 +634,6 @@ String^ ProjContext::FindFile(String^ file)
     const char* pUserDir = proj_context_get_user_writable_directory(this, false);
     String^ userDir = Utf8_PtrToString(pUserDir);
 
-
     // UserDir is already contained in ProjLibDirs, so need to probe for the normal name here
     if (File::Exists(testFile = Path::Combine(userDir, ("#proj" "-" PROJ_VERSION "-") + file)))
     {
@@ -441,9 +666,117 @@ String^ ProjContext::FindFile(String^ file)
             return testFile;
     }
 
+    // Whether proj.db can be found depends on the network state of the context, so never remember it missing
+    if (file == "proj.db")
+        cacheable = false;
+
     return nullptr;
 }
 
+void ProjContext::AddSearchPath(String^ path)
+{
+    if (String::IsNullOrEmpty(path))
+        throw gcnew ArgumentNullException("path");
+
+    path = Path::GetFullPath(path);
+
+    if (!m_searchPaths)
+        m_searchPaths = gcnew List<String^>();
+    else if (m_searchPaths->Contains(path))
+        return;
+
+    m_searchPaths->Add(path);
+
+    // PROJ copies the paths, so we only need them during the call
+    void* chain = nullptr;
+    const char** paths = (const char**)malloc(m_searchPaths->Count * sizeof(const char*));
+    try
+    {
+        for (int i = 0; i < m_searchPaths->Count; i++)
+            paths[i] = utf8_chain(m_searchPaths[i], chain);
+
+        proj_context_set_search_paths(this, m_searchPaths->Count, paths);
+    }
+    finally
+    {
+        free(paths);
+        free_chain(chain);
+    }
+}
+
+Proj::NetworkStatistics^ ProjContext::GlobalNetworkStatistics::get()
+{
+    return NetworkCounters::Global->Snapshot();
+}
+
+Proj::NetworkStatistics^ ProjContext::NetworkStatistics::get()
+{
+    return m_counters->Snapshot();
+}
+
+void ProjContext::ClearFileCache()
+{
+    auto cache = _fileCache;
+
+    if (cache)
+        cache->Clear();
+}
+
+void ProjContext::OnSearchPathChanged(Object^ sender, FileSystemEventArgs^ e)
+{
+    UNUSED_ALWAYS(sender);
+    UNUSED_ALWAYS(e);
+    ClearFileCache();
+}
+
+void ProjContext::OnSearchPathRenamed(Object^ sender, RenamedEventArgs^ e)
+{
+    OnSearchPathChanged(sender, e);
+}
+
+// Watches the search directories once per process, to drop cached (negative) lookups when files appear or disappear
+void ProjContext::SetupFileWatchers(String^ userDir)
+{
+    if (_fileWatchers)
+        return;
+
+    List<String^>^ dirs = gcnew List<String^>(ProjLibDirs);
+    if (!String::IsNullOrEmpty(userDir) && !dirs->Contains(userDir))
+        dirs->Add(userDir);
+
+    List<FileSystemWatcher^>^ watchers = gcnew List<FileSystemWatcher^>();
+    for each (String ^ dir in dirs)
+    {
+        try
+        {
+            if (!Directory::Exists(dir))
+                continue;
+
+            FileSystemWatcher^ fsw = gcnew FileSystemWatcher(dir);
+            fsw->NotifyFilter = NotifyFilters::FileName;
+            fsw->IncludeSubdirectories = false;
+
+            auto handler = gcnew FileSystemEventHandler(&ProjContext::OnSearchPathChanged);
+            fsw->Created += handler;
+            fsw->Deleted += handler;
+            fsw->Renamed += gcnew RenamedEventHandler(&ProjContext::OnSearchPathRenamed);
+            fsw->EnableRaisingEvents = true;
+
+            watchers->Add(fsw);
+        }
+        catch (Exception^)
+        { /* Not supported on this filesystem, access denied, etc. Use ClearFileCache() instead */
+        }
+    }
+
+    if (nullptr != System::Threading::Interlocked::CompareExchange<array<FileSystemWatcher^>^>(_fileWatchers, watchers->ToArray(), nullptr))
+    {
+        // Another thread won the race
+        for each (FileSystemWatcher ^ fsw in watchers)
+            delete fsw;
+    }
+}
+
 void ProjContext::OnLogMessage(ProjLogLevel level, String^ message)
 {
     if (level == ProjLogLevel::Error)
@@ -466,3 +799,211 @@ ProjFactory^ ProjContext::Factory::get()
 
         return m_factory;
     }
+
+#pragma region Identify
+// Identifies the crs in a wkt string. Returns nullptr when there is no likely match
+static Identifier^ identify_crs(ProjContext^ ctx, String^ wkt, String^ authority)
+{
+    ::utf8_string wkt_c(wkt);
+    ::utf8_string auth_c(authority);
+    const char* auth = auth_c.length() ? auth_c.c_str() : nullptr;
+    PJ* pj = proj_create_from_wkt(ctx, wkt_c.c_str(), nullptr, nullptr, nullptr);
+
+    if (!pj)
+        return nullptr;
+
+    try
+    {
+        if (!proj_is_crs(pj))
+            return nullptr;
+
+        // Carries its own ID[] or AUTHORITY[]
+        const char* id_auth = proj_get_id_auth_name(pj, 0);
+        const char* id_code = proj_get_id_code(pj, 0);
+
+        if (id_auth && id_code && (!auth || !_stricmp(id_auth, auth)))
+            return gcnew Identifier(Utf8_PtrToString(id_auth), Utf8_PtrToString(id_code));
+
+        int* confidence = nullptr;
+        PJ_OBJ_LIST* list = proj_identify(ctx, pj, auth, nullptr, &confidence);
+
+        if (!list)
+            return nullptr;
+
+        try
+        {
+            // Sorted by decreasing confidence
+            if (proj_list_get_count(list) < 1 || confidence[0] < ProjContext::IdentifyMinConfidence)
+                return nullptr;
+
+            PJ* match = proj_list_get(ctx, list, 0);
+            try
+            {
+                id_auth = proj_get_id_auth_name(match, 0);
+                id_code = proj_get_id_code(match, 0);
+
+                if (id_auth && id_code)
+                    return gcnew Identifier(Utf8_PtrToString(id_auth), Utf8_PtrToString(id_code));
+            }
+            finally
+            {
+                proj_destroy(match);
+            }
+            return nullptr;
+        }
+        finally
+        {
+            proj_int_list_destroy(confidence);
+            proj_list_destroy(list);
+        }
+    }
+    finally
+    {
+        proj_destroy(pj);
+    }
+}
+
+// WKT ignores whitespace outside quoted strings, and .prj files differ in exactly that
+static String^ normalize_wkt(String^ wkt)
+{
+    System::Text::StringBuilder^ sb = gcnew System::Text::StringBuilder(wkt->Length);
+    bool quoted = false;
+
+    for each (wchar_t c in wkt)
+    {
+        if (c == L'"')
+            quoted = !quoted;
+        else if (!quoted && (Char::IsWhiteSpace(c) || c == 0xFEFF))
+            continue;
+
+        sb->Append(c);
+    }
+
+    return sb->ToString();
+}
+
+private ref class CrsIdentifyJob sealed
+{
+private:
+    initonly ProjContext^ m_ctx;
+    initonly array<String^>^ m_wkts;
+    initonly String^ m_authority;
+    initonly array<Identifier^>^ m_result;
+
+public:
+    CrsIdentifyJob(ProjContext^ ctx, array<String^>^ wkts, String^ authority)
+    {
+        m_ctx = ctx;
+        m_wkts = wkts;
+        m_authority = authority;
+        m_result = gcnew array<Identifier^>(wkts->Length);
+    }
+
+    property array<Identifier^>^ Result
+    {
+        array<Identifier^>^ get()
+        {
+            return m_result;
+        }
+    }
+
+    // A context is not thread safe, so each worker uses its own clone
+    ProjContext^ CreateContext()
+    {
+        System::Threading::Monitor::Enter(this);
+        try
+        {
+            return m_ctx->Clone();
+        }
+        finally
+        {
+            System::Threading::Monitor::Exit(this);
+        }
+    }
+
+    ProjContext^ Run(int i, System::Threading::Tasks::ParallelLoopState^ state, ProjContext^ ctx)
+    {
+        m_result[i] = identify_crs(ctx, m_wkts[i], m_authority);
+        return ctx;
+    }
+
+    void ReleaseContext(ProjContext^ ctx)
+    {
+        delete ctx;
+    }
+};
+
+Identifier^ ProjContext::Identify(String^ wkt, [Optional] String^ authority)
+{
+    if (String::IsNullOrWhiteSpace(wkt))
+        throw gcnew ArgumentNullException("wkt");
+
+    return Identify(gcnew array<String^> { wkt }, authority)[0];
+}
+
+System::Collections::ObjectModel::ReadOnlyCollection<Identifier^>^ ProjContext::Identify(System::Collections::Generic::IEnumerable<String^>^ wkts, [Optional] String^ authority)
+{
+    if (!wkts)
+        throw gcnew ArgumentNullException("wkts");
+
+    array<String^>^ items = System::Linq::Enumerable::ToArray(wkts);
+    array<Identifier^>^ result = gcnew array<Identifier^>(items->Length);
+    array<String^>^ keys = gcnew array<String^>(items->Length);
+
+    // Results depend on the database and the requested authority
+    String^ prefix = String::Concat(GetDatabaseVersionKey(), "\n", authority, "\n");
+    System::Collections::Generic::Dictionary<String^, int>^ todo = gcnew System::Collections::Generic::Dictionary<String^, int>();
+    List<String^>^ todoWkt = gcnew List<String^>();
+
+    for (int i = 0; i < items->Length; i++)
+    {
+        if (String::IsNullOrWhiteSpace(items[i]))
+            continue;
+
+        Tuple<Identifier^>^ cached;
+        String^ key = keys[i] = prefix + normalize_wkt(items[i]);
+
+        if (_identifyCache->TryGetValue(key, cached))
+            result[i] = cached->Item1;
+        else if (!todo->ContainsKey(key))
+        {
+            todo[key] = todoWkt->Count;
+            todoWkt->Add(items[i]);
+        }
+    }
+
+    if (!todo->Count)
+        return Array::AsReadOnly(result);
+
+    CrsIdentifyJob^ job = gcnew CrsIdentifyJob(this, todoWkt->ToArray(), authority);
+
+    if (todo->Count < 4)
+    {
+        for (int i = 0; i < todo->Count; i++)
+            job->Run(i, nullptr, this);
+    }
+    else
+    {
+        System::Threading::Tasks::Parallel::For<ProjContext^>(0, todo->Count,
+            gcnew Func<ProjContext^>(job, &CrsIdentifyJob::CreateContext),
+            gcnew Func<int, System::Threading::Tasks::ParallelLoopState^, ProjContext^, ProjContext^>(job, &CrsIdentifyJob::Run),
+            gcnew Action<ProjContext^>(job, &CrsIdentifyJob::ReleaseContext));
+    }
+
+    if (_identifyCache->Count + todo->Count > IdentifyCacheSize)
+        _identifyCache->Clear();
+
+    for each (System::Collections::Generic::KeyValuePair<String^, int> kv in todo)
+        _identifyCache[kv.Key] = gcnew Tuple<Identifier^>(job->Result[kv.Value]);
+
+    for (int i = 0; i < items->Length; i++)
+    {
+        int n;
+
+        if (keys[i] && todo->TryGetValue(keys[i], n))
+            result[i] = job->Result[n];
+    }
+
+    return Array::AsReadOnly(result);
+}
+#pragma endregion
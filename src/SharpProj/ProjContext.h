@@ -12,12 +12,19 @@ using namespace System;
 namespace SharpProj {
     ref class ProjException;
     ref class CoordinateReferenceSystem;
+    ref class CoordinateTransform;
+    ref class CoordinateTransformRequest;
+    ref class CoordinateTransformResult;
 
     namespace Proj {
+        ref class ProjArea;
+        ref class NetworkStatistics;
+        ref class NetworkCounters;
         ref class ProjFactory;
         ref class ProjObject;
         ref class CoordinateReferenceSystemFilter;
         ref class CoordinateReferenceSystemInfo;
+        ref class CrsCatalog;
         ref class CoordinateSystem;
         ref class CelestialBodyInfo;
         ref class UnitOfMeasurement;
@@ -35,15 +42,41 @@ namespace SharpProj {
         Trace = PJ_LOG_TRACE
     };
 
+    typedef void (*deferred_destroy)(void* item);
+
+    // Network bytes held for a context. Shared with the process wide block cache, which gives them back on eviction
+    private ref class NetworkBytes sealed
+    {
+    internal:
+        long long Value;
+    };
+
     template<typename TCtx, typename TNetCtx> class ctx_wrapper
     {
+        struct deferred_node
+        {
+            void* item;
+            deferred_destroy destroy;
+        };
+
         TCtx* m_handle;
         int m_cnt;
-        bool m_meDisposed;
+        volatile bool m_meDisposed;
         TCtx* (*m_close_handle)(TCtx* h);
         gcroot<WeakReference<TNetCtx^>^> m_netRef;
-
-        const int CTX_Pressure = 2 * 1024 * 1024; // Guess 2 MB memory pressure outside .Net
+        gcroot<System::Collections::Concurrent::ConcurrentQueue<IntPtr>^> m_deferred;
+        int m_deferredCount;
+        int m_items;
+        bool m_database;
+        gcroot<NetworkBytes^> m_networkBytes;
+        long long m_pressure;
+
+        // Building blocks of the native memory estimate, combined in NativeBytes()
+        static const long long CTX_Base = 64 * 1024;               // The context itself, search paths, logging, etc.
+        static const long long CTX_Database = 2 * 1024 * 1024;     // SQLite connection and page cache of proj.db
+        static const long long ITEM_Size = 8 * 1024;               // Average PJ instance
+        static const long long NET_CacheLimit = 16 * 1024 * 1024;  // Network chunks are kept in a bounded LRU cache
+        static const long long PRESSURE_Granularity = 64 * 1024;   // Don't bother the GC with smaller updates
 
     public:
         ctx_wrapper(TCtx* value, TCtx* (*close_handle)(TCtx* h))
@@ -53,7 +86,13 @@ namespace SharpProj {
             m_cnt = 1;
             m_meDisposed = false;
             m_netRef = gcnew WeakReference<TNetCtx^>(nullptr);
-            GC::AddMemoryPressure(CTX_Pressure);
+            m_deferred = gcnew System::Collections::Concurrent::ConcurrentQueue<IntPtr>();
+            m_deferredCount = 0;
+            m_items = 0;
+            m_database = false;
+            m_networkBytes = gcnew NetworkBytes();
+            m_pressure = 0;
+            UpdatePressure(true);
         }
 
     private:
@@ -66,8 +105,71 @@ namespace SharpProj {
             m_handle = nullptr;
             m_close_handle(h);
 
-            GC::RemoveMemoryPressure(CTX_Pressure);
+            long long pressure = System::Threading::Interlocked::Exchange(m_pressure, 0LL);
+            if (pressure > 0)
+                GC::RemoveMemoryPressure(pressure);
         }
+
+        void UpdatePressure(bool force)
+        {
+            long long bytes = NativeBytes();
+            long long delta = bytes - System::Threading::Interlocked::Read(m_pressure);
+
+            if (!force && delta < PRESSURE_Granularity && delta > -PRESSURE_Granularity)
+                return;
+
+            delta = bytes - System::Threading::Interlocked::Exchange(m_pressure, bytes);
+
+            if (delta > 0)
+                GC::AddMemoryPressure(delta);
+            else if (delta < 0)
+                GC::RemoveMemoryPressure(-delta);
+        }
+
+    public:
+        long long NativeBytes()
+        {
+            long long net = System::Threading::Interlocked::Read(m_networkBytes->Value);
+
+            return CTX_Base
+                + (m_database ? CTX_Database : 0)
+                + System::Threading::Interlocked::CompareExchange(m_items, 0, 0) * ITEM_Size
+                + (net <= 0 ? 0 : net < NET_CacheLimit ? net : NET_CacheLimit);
+        }
+
+        void AddItem()
+        {
+            System::Threading::Interlocked::Increment(m_items);
+            UpdatePressure(false);
+        }
+
+        void RemoveItem()
+        {
+            System::Threading::Interlocked::Decrement(m_items);
+            UpdatePressure(false);
+        }
+
+        void DatabaseOpened()
+        {
+            if (m_database)
+                return;
+
+            m_database = true;
+            UpdatePressure(false);
+        }
+
+        // Evictions from the block cache subtract from the returned counter on any thread. The pressure follows on the next update
+        void AddNetworkBytes(long long bytes)
+        {
+            System::Threading::Interlocked::Add(m_networkBytes->Value, bytes);
+            UpdatePressure(false);
+        }
+
+        NetworkBytes^ NetworkBytesCounter()
+        {
+            return m_networkBytes;
+        }
+
     public:
         __inline operator TCtx* () const
         {
@@ -89,7 +191,53 @@ namespace SharpProj {
         {
             if (m_meDisposed)
                 throw gcnew InvalidOperationException();
+            FlushDeferred();
             m_meDisposed = true;
+            // Nothing is read through this context any more. Blocks still in the cache no longer count for it
+            m_networkBytes = gcnew NetworkBytes();
+            UpdatePressure(false);
+            Release();
+        }
+
+        // Queues the destruction of a native object that belongs to this context, to be performed by the thread
+        // using the context at its next safe point. Used by finalizers, which run on their own thread.
+        void Defer(void* item, deferred_destroy destroy)
+        {
+            if (m_meDisposed)
+            {
+                // Nobody uses the context any more, so there is nothing to race with. The native context stays
+                // valid while the item holds its reference
+                destroy(item);
+                return;
+            }
+
+            deferred_node* n = new deferred_node();
+            n->item = item;
+            n->destroy = destroy;
+
+            m_deferred->Enqueue(IntPtr(n));
+            System::Threading::Interlocked::Increment(m_deferredCount);
+
+            if (m_meDisposed)
+                FlushDeferred(); // Raced with the disposal of the context
+        }
+
+        // Destroys all queued objects. Only call from the thread owning the context, or after it is disposed
+        void FlushDeferred()
+        {
+            if (!m_deferredCount)
+                return;
+
+            AddRef(); // The last item may hold the last reference to us
+            IntPtr p;
+            while (m_deferred->TryDequeue(p))
+            {
+                System::Threading::Interlocked::Decrement(m_deferredCount);
+                deferred_node* n = (deferred_node*)p.ToPointer();
+
+                n->destroy(n->item);
+                delete n;
+            }
             Release();
         }
 
@@ -117,6 +265,7 @@ namespace SharpProj {
         int m_cnt;
         ctx_wrapper<TCtx, TNetCtx>* m_ctx;
         TItem* (*m_close_handle)(TItem* h);
+        static int s_defaultContextDestroys;
 
     public:
         item_wrapper(ctx_wrapper<TCtx, TNetCtx>* ctx, TItem* value, TItem* (*close_handle)(TItem* h))
@@ -126,6 +275,7 @@ namespace SharpProj {
             m_close_handle = close_handle;
             m_cnt = 1;
             m_ctx->AddRef();
+            m_ctx->AddItem();
         }
 
     private:
@@ -136,7 +286,10 @@ namespace SharpProj {
 
             auto h = m_handle;
             m_handle = nullptr;
+            if (!static_cast<TCtx*>(*m_ctx))
+                System::Threading::Interlocked::Increment(s_defaultContextDestroys);
             m_close_handle(h);
+            m_ctx->RemoveItem();
             m_ctx->Release();
             m_ctx = nullptr;
         }
@@ -152,13 +305,40 @@ namespace SharpProj {
             if (!System::Threading::Interlocked::Decrement(m_cnt))
                 delete this;
         }
+
+        // Like Release(), but leaves the destruction to the thread owning the context
+        __inline void ReleaseDeferred()
+        {
+            if (!System::Threading::Interlocked::Decrement(m_cnt))
+                m_ctx->Defer(this, &item_wrapper::DestroyDeferred);
+        }
+
+        __inline void Defer(void* item, deferred_destroy destroy)
+        {
+            m_ctx->Defer(item, destroy);
+        }
+
+    private:
+        static void DestroyDeferred(void* item)
+        {
+            delete static_cast<item_wrapper*>(item);
+        }
+
     public:
         __inline operator TItem* () const
         {
             return this ? m_handle : nullptr;
         }
+
+        // Items destroyed without a native context of their own, which makes PROJ use its shared default context
+        static int DefaultContextDestroys()
+        {
+            return s_defaultContextDestroys;
+        }
     };
 
+    template<typename TCtx, typename TNetCtx, typename TItem> int item_wrapper<TCtx, TNetCtx, TItem>::s_defaultContextDestroys = 0;
+
     /// <summary>
     /// Context objects enable safe multi-threaded usage of SharpProj. Each Proj object is connected to some context
     /// (if not specified, a default related or new context is used). All operations within a context should be
@@ -178,6 +358,12 @@ namespace SharpProj {
 
         [DebuggerBrowsable(DebuggerBrowsableState::Never)]
         static array<String^>^ _projLibDirs;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        static System::Collections::Concurrent::ConcurrentDictionary<String^, String^>^ _fileCache;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        static array<System::IO::FileSystemWatcher^>^ _fileWatchers;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        static initonly System::Collections::Concurrent::ConcurrentDictionary<String^, Tuple<Proj::Identifier^>^>^ _identifyCache = gcnew System::Collections::Concurrent::ConcurrentDictionary<String^, Tuple<Proj::Identifier^>^>(StringComparer::Ordinal);
 
         [DebuggerBrowsable(DebuggerBrowsableState::Never)]
         bool m_disposed;
@@ -185,6 +371,12 @@ namespace SharpProj {
         bool m_enableNetwork; // not reset on filefinder, unlike proj inner setting
         [DebuggerBrowsable(DebuggerBrowsableState::Never)]
         ProjFactory^ m_factory;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        System::Collections::Generic::List<String^>^ m_searchPaths;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        initonly Proj::NetworkCounters^ m_counters;
+        [DebuggerBrowsable(DebuggerBrowsableState::Never)]
+        String^ m_tmercDefaultAlgo;
         ProjContext(PJ_CONTEXT* ctx);
         void SetupNetworkHandling();
 
@@ -192,14 +384,101 @@ namespace SharpProj {
         static initonly String^ DefaultEndpointUrl = "https://cdn.proj.org";
         static property bool EnableNetworkConnectionsOnNewContexts;
 
+        /// <summary>
+        /// Gets or sets the timeout of network requests for grids, shared by all contexts. Defaults to 100 seconds.
+        /// </summary>
+        static property TimeSpan NetworkTimeout
+        {
+            TimeSpan get();
+            void set(TimeSpan value);
+        }
+
+        /// <summary>
+        /// Gets or sets the maximum number of concurrent connections per server used for network requests, shared by all contexts.
+        /// </summary>
+        static property int NetworkMaxConnectionsPerServer
+        {
+            int get();
+            void set(int value);
+        }
+
+        /// <summary>
+        /// Gets or sets the size of the aligned blocks in which grid files are read over the network. Defaults to 64 KB.
+        /// Applies to files opened after setting.
+        /// </summary>
+        static property int NetworkBlockSize
+        {
+            int get();
+            void set(int value);
+        }
+
+        /// <summary>
+        /// Gets or sets the maximum number of bytes of grid blocks kept in memory, shared by all contexts in the process. Blocks
+        /// are keyed by url and ETag, so a changed file is never mixed with old blocks. Defaults to 64 MB. When 0, ranges are read
+        /// exactly as PROJ requests them, straight into its buffer.
+        /// </summary>
+        static property long long NetworkBlockCacheSize
+        {
+            long long get();
+            void set(long long value);
+        }
+
+        /// <summary>
+        /// Gets or sets a directory in which the operations found by <c>CoordinateTransform.Create(sourceCrs, targetCrs)</c>
+        /// are stored, so later processes can create the same transforms without searching the database. Entries are keyed by both
+        /// crs definitions, the options, the PROJ and database versions and, without network access, the state of the directories
+        /// searched for grids. Disabled when null, the default.
+        /// </summary>
+        static property String^ OperationCacheDirectory
+        {
+            String^ get();
+            void set(String^ value);
+        }
+
+        /// <summary>
+        /// Gets the network and grid I/O counters of all contexts together. On .NET Core these are also published
+        /// as instruments of the "SharpProj" <see cref="System::Diagnostics::Metrics::Meter" />.
+        /// </summary>
+        static property Proj::NetworkStatistics^ GlobalNetworkStatistics
+        {
+            Proj::NetworkStatistics^ get();
+        }
+
+        /// <summary>
+        /// Gets the network and grid I/O counters of this context
+        /// </summary>
+        property Proj::NetworkStatistics^ NetworkStatistics
+        {
+            Proj::NetworkStatistics^ get();
+        }
+
     internal:
         const char* utf8_string(String^ value);
+        property Proj::NetworkCounters^ Counters
+        {
+            Proj::NetworkCounters^ get()
+            {
+                return m_counters;
+            }
+        }
+
 
         const char* utf8_chain(String^ value, void*& chain);
         void free_chain(void*& chain);
         void FlushChain();
 
     public:
+        /// <summary>
+        /// Destroys the native objects of finalized proj objects of this context. Finalizers queue this work
+        /// to avoid using the context from the finalizer thread. This is also done when new objects are created,
+        /// when transforming ranges of coordinates and when the context is disposed.
+        /// </summary>
+        void Flush()
+        {
+            if (!m_disposed)
+                m_ctx.FlushDeferred();
+        }
+
         /// <summary>
         /// Creates a new unrelated context
         /// </summary>
@@ -252,7 +531,7 @@ namespace SharpProj {
             }
             void set(String^ value)
             {
-                std::string url = utf8_string(value);
+                ::utf8_string url(value);
 
                 proj_context_set_url_endpoint(this, url.c_str());
             }
@@ -270,13 +549,49 @@ namespace SharpProj {
             proj_grid_cache_set_enable(this, enabled);
             if (enabled && path)
             {
-                std::string p = utf8_string(path);
+                ::utf8_string p(path);
                 proj_grid_cache_set_filename(this, p.c_str());
             }
             proj_grid_cache_set_max_size(this, max_mb > 0 ? max_mb : -1);
             proj_grid_cache_set_ttl(this, ttl_seconds > 0 ? ttl_seconds : -1);
         }
 
+        /// <summary>
+        /// Fetches the parts of the grids used by <paramref name="transforms"/> that cover <paramref name="area"/> into the grid cache,
+        /// concurrently, so transforming coordinates in that area needs no further network round trips. Does nothing when network
+        /// connections are disabled. Fetched grid data is only kept when the grid cache is enabled.
+        /// </summary>
+        void PrefetchGrids(System::Collections::Generic::IEnumerable<CoordinateTransform^>^ transforms, Proj::ProjArea^ area);
+
+        /// <summary>
+        /// Creates the transforms for many crs pairs concurrently. Operations are resolved on a bounded set of worker contexts, after which
+        /// the transforms are cloned onto this context; like other objects of this context, use them from one thread at a time.
+        /// </summary>
+        /// <param name="requests"></param>
+        /// <returns>The transform or the error for each request, in the order of <paramref name="requests"/></returns>
+        System::Collections::ObjectModel::ReadOnlyCollection<CoordinateTransformResult^>^ CreateTransforms(System::Collections::Generic::IEnumerable<CoordinateTransformRequest^>^ requests);
+
+        /// <summary>
+        /// Adds a directory that this context searches for grids and other data files, after the default locations
+        /// </summary>
+        /// <param name="path"></param>
+        void AddSearchPath(String^ path);
+
+        /// <summary>
+        /// Gets the estimated amount of native memory used by PROJ for this context and the objects created in it. This is the
+        /// amount reported to the garbage collector as memory pressure.
+        /// </summary>
+        property long long NativeMemoryBytes
+        {
+            long long get()
+            {
+                if (m_disposed)
+                    return 0;
+
+                return m_ctx.NativeBytes();
+            }
+        }
+
         /// <summary>
         /// Clears the current grid cache. Grid files will be reloaded when required
         /// </summary>
@@ -293,11 +608,22 @@ namespace SharpProj {
             System::Collections::Generic::IEnumerable<String^>^ get();
         }
         void TouchFile(String^ file);
+        String^ FindFileUncached(String^ file, bool% cacheable);
+        void SetupFileWatchers(String^ userDir);
+        static void OnSearchPathChanged(Object^ sender, System::IO::FileSystemEventArgs^ e);
+        static void OnSearchPathRenamed(Object^ sender, System::IO::RenamedEventArgs^ e);
 
     internal:
         String^ FindFile(String^ file);
         void OnLogMessage(ProjLogLevel level, String^ message);
 
+    public:
+        /// <summary>
+        /// Clears the process wide cache of files resolved for PROJ (grids, proj.db, init files). Call this after
+        /// files are added to or removed from a search path in a way that is not noticed by the file watchers.
+        /// </summary>
+        static void ClearFileCache();
+
     public:
         /// <summary>
         /// Creates a new proj object from its definition. Definiton could be an auth string, a projstring, wellknowntext or even projjson.
@@ -457,6 +783,30 @@ namespace SharpProj {
         System::Collections::ObjectModel::ReadOnlyCollection<CoordinateReferenceSystemInfo^>^ GetCoordinateReferenceSystems(CoordinateReferenceSystemFilter^ filter);
         System::Collections::ObjectModel::ReadOnlyCollection<CoordinateReferenceSystemInfo^>^ GetCoordinateReferenceSystems();
 
+        /// <summary>
+        /// Gets the indexed catalog of all <see cref="CoordinateReferenceSystem"/>s in the database of this context. The catalog is
+        /// built on first use and shared with all contexts using the same database version.
+        /// </summary>
+        CrsCatalog^ GetCrsCatalog();
+
+        /// <summary>
+        /// Finds the authority code of the <see cref="CoordinateReferenceSystem"/> described by <paramref name="wkt"/>, e.g. the
+        /// contents of a shapefile .prj. Results are cached process wide by normalized wkt.
+        /// </summary>
+        /// <param name="wkt"></param>
+        /// <param name="authority">Authority to find a code in, e.g. "EPSG". Any authority when null</param>
+        /// <returns>The identifier, or null when there is no match with at least likely confidence</returns>
+        Proj::Identifier^ Identify(String^ wkt, [Optional] String^ authority);
+
+        /// <summary>
+        /// Identifies a batch of wkt strings like <see cref="Identify(String^, String^)" />. Duplicates are identified once, and
+        /// uncached strings are identified in parallel on clones of this context.
+        /// </summary>
+        /// <param name="wkts"></param>
+        /// <param name="authority">Authority to find a code in, e.g. "EPSG". Any authority when null</param>
+        /// <returns>The identifiers, in the order of <paramref name="wkts"/>. null for items without a likely match</returns>
+        System::Collections::ObjectModel::ReadOnlyCollection<Proj::Identifier^>^ Identify(System::Collections::Generic::IEnumerable<String^>^ wkts, [Optional] String^ authority);
+
         System::Collections::ObjectModel::ReadOnlyCollection<CelestialBodyInfo^>^ GetCelestialBodies();
 
         System::Collections::ObjectModel::ReadOnlyCollection<UnitOfMeasurement^>^ GetUnitsOfMeasurement();
@@ -473,6 +823,27 @@ namespace SharpProj {
         }
 
     internal:
+        literal int IdentifyMinConfidence = 70; // proj_identify(): 70 is 'likely', 25 is a partial match
+        literal int IdentifyCacheSize = 16384;
+        // Database path and the versions of its contents
+        String^ GetDatabaseVersionKey();
+        // Directories searched for grids, with their last change
+        String^ GetGridSearchKey();
+        // Objects destroyed on PROJ's shared default context instead of their own. Should stay 0
+        static property int DefaultContextDestroys
+        {
+            int get()
+            {
+                return item_wrapper<PJ_CONTEXT, ProjContext, PJ>::DefaultContextDestroys();
+            }
+        }
+        // Reads a range of a remote file in one call, like PROJ's network read callback does
+        array<Byte>^ ReadNetworkRange(String^ url, long long offset, int count);
+        // The tmerc_default_algo setting of proj.ini: poder_engsager (PROJ's default), evenden_snyder or auto
+        property String^ TmercDefaultAlgorithm
+        {
+            String^ get();
+        }
         static void DownloadProjDB(String^ toPath);
         static operator PJ_CONTEXT* (ProjContext^ me)
         {
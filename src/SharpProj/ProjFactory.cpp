@@ -17,7 +17,7 @@ CoordinateSystem^ ProjFactory::CreateCartesianCoordinateSystem(Cartesian2DType t
     else if (String::IsNullOrEmpty(unitName))
         throw gcnew ArgumentNullException(nameof(unitName));
 
-    auto unit_name = utf8_string(unitName);
+    utf8_string unit_name(unitName);
 
     auto pj = proj_create_cartesian_2D_cs(this, (PJ_CARTESIAN_CS_2D_TYPE)type, unit_name.c_str(), conversionFactor);
 
@@ -34,7 +34,7 @@ CoordinateSystem^ ProjFactory::CreateEllipsoidalCoordinateSystem(Ellipsoidal2DTy
     else if (String::IsNullOrEmpty(unitName))
         throw gcnew ArgumentNullException(nameof(unitName));
 
-    auto unit_name = utf8_string(unitName);
+    utf8_string unit_name(unitName);
 
     auto pj = proj_create_ellipsoidal_2D_cs(this, (PJ_ELLIPSOIDAL_CS_2D_TYPE)type, unit_name.c_str(), conversionFactor);
 
@@ -53,8 +53,8 @@ CoordinateSystem^ ProjFactory::CreateEllipsoidalCoordinateSystem(Ellipsoidal3DTy
     else if (String::IsNullOrEmpty(verticalUnitName))
         throw gcnew ArgumentNullException(nameof(verticallUnitName));
 
-    auto h_unit_name = utf8_string(horizontalUnitName);
-    auto v_unit_name = utf8_string(verticalUnitName);
+    utf8_string h_unit_name(horizontalUnitName);
+    utf8_string v_unit_name(verticalUnitName);
 
     auto pj = proj_create_ellipsoidal_3D_cs(this, (PJ_ELLIPSOIDAL_CS_3D_TYPE)type,
         h_unit_name.c_str(), horizontalConversionFactor,
@@ -1,166 +1,1074 @@
 #include "pch.h"
 #include "ProjContext.h"
+#include "NetworkStatistics.h"
 
 using namespace SharpProj;
 using namespace System::IO;
 
 #pragma warning(disable: 4950) // WebRequest, HttpWebRequest, ServicePoint, and WebClient are obsolete. Use HttpClient instead
-using System::Net::WebRequest;
-using System::Net::WebResponse;
-using System::Net::HttpWebRequest;
-using System::Net::HttpWebResponse;
 using System::Net::HttpStatusCode;
+using System::Net::Http::HttpClient;
+using System::Net::Http::HttpCompletionOption;
+using System::Net::Http::HttpMethod;
+using System::Net::Http::HttpRequestMessage;
+using System::Net::Http::HttpResponseMessage;
+using System::Collections::Generic::Dictionary;
+using System::Collections::Generic::IEnumerable;
+using System::Collections::Generic::KeyValuePair;
+using System::Collections::Generic::List;
+using System::Diagnostics::Stopwatch;
 
-struct my_network_data
+// One HttpClient for all contexts, so connections (and TLS sessions) are reused over range requests and contexts
+private ref class ProjHttp abstract sealed
 {
-    gcroot<ProjContext^> ctx;
-    gcroot<String^> url;
-    gcroot<System::Net::WebHeaderCollection^> Headers;
-    gcroot<String^> etag;
-    void* chain;
+private:
+    static HttpClient^ _client;
+    static Object^ _lock = gcnew Object();
+    // Number of running operations per client, so replaced clients are disposed when they are no longer used
+    static initonly Dictionary<HttpClient^, int>^ _users = gcnew Dictionary<HttpClient^, int>();
 
-public:
-    my_network_data()
-    {}
-    ~my_network_data()
-    {}
+internal:
+    static TimeSpan _timeout = TimeSpan::FromSeconds(100);
+    static int _maxConnections = 8;
+
+    // Gets the current client for one operation. Pass it to Release() when its responses are disposed
+    static HttpClient^ Acquire()
+    {
+        System::Threading::Monitor::Enter(_lock);
+        try
+        {
+            if (!_client)
+            {
+                _client = CreateClient();
+                _users[_client] = 0;
+            }
+
+            _users[_client]++;
+            return _client;
+        }
+        finally
+        {
+            System::Threading::Monitor::Exit(_lock);
+        }
+    }
+
+    static void Release(HttpClient^ client)
+    {
+        System::Threading::Monitor::Enter(_lock);
+        try
+        {
+            if (--_users[client] == 0 && client != _client)
+                Dispose(client);
+        }
+        finally
+        {
+            System::Threading::Monitor::Exit(_lock);
+        }
+    }
+
+    // Settings changed. New requests use a new client, running requests complete on the old one
+    static void Reset()
+    {
+        System::Threading::Monitor::Enter(_lock);
+        try
+        {
+            HttpClient^ old = _client;
+            _client = nullptr;
+
+            if (old && _users[old] == 0)
+                Dispose(old);
+        }
+        finally
+        {
+            System::Threading::Monitor::Exit(_lock);
+        }
+    }
+
+private:
+    // Disposes the client, its handler and the pooled connections. Called with _lock held
+    static void Dispose(HttpClient^ client)
+    {
+        _users->Remove(client);
+        delete client;
+    }
+
+private:
+    static HttpClient^ CreateClient()
+    {
+#ifdef NETCORE
+        auto handler = gcnew System::Net::Http::SocketsHttpHandler();
+        handler->MaxConnectionsPerServer = _maxConnections;
+        handler->PooledConnectionIdleTimeout = TimeSpan::FromMinutes(2);
+        handler->EnableMultipleHttp2Connections = true;
+        handler->AutomaticDecompression = System::Net::DecompressionMethods::None; // Ranges are of the raw bytes
+#else
+        auto handler = gcnew System::Net::Http::HttpClientHandler();
+        handler->AutomaticDecompression = System::Net::DecompressionMethods::None;
+#endif
+        auto client = gcnew HttpClient(handler, true);
+        client->Timeout = _timeout;
+#ifdef NETCORE
+        client->DefaultRequestVersion = System::Net::HttpVersion::Version20;
+        client->DefaultVersionPolicy = System::Net::Http::HttpVersionPolicy::RequestVersionOrLower;
+#endif
+        client->DefaultRequestHeaders->TryAddWithoutValidation("User-Agent", "System.Net/SharpProj using PROJ " PROJ_VERSION);
+        return client;
+    }
+
+internal:
+    static HttpResponseMessage^ SendRange(HttpClient^ client, String^ url, unsigned long long offset, size_t size_to_read, String^ etag)
+    {
+        HttpRequestMessage^ rq = CreateRangeRequest(url, offset, size_to_read, etag);
+
+#ifndef NETCORE
+        return client->SendAsync(rq, HttpCompletionOption::ResponseHeadersRead)->GetAwaiter().GetResult();
+#else
+        return client->Send(rq, HttpCompletionOption::ResponseHeadersRead);
+#endif
+    }
+
+    static System::Threading::Tasks::Task<HttpResponseMessage^>^ SendRangeAsync(HttpClient^ client, String^ url, unsigned long long offset, size_t size_to_read, String^ etag)
+    {
+        return client->SendAsync(CreateRangeRequest(url, offset, size_to_read, etag), HttpCompletionOption::ResponseHeadersRead);
+    }
+
+private:
+    static HttpRequestMessage^ CreateRangeRequest(String^ url, unsigned long long offset, size_t size_to_read, String^ etag)
+    {
+        HttpRequestMessage^ rq = gcnew HttpRequestMessage(HttpMethod::Get, url);
+        rq->Headers->Range = gcnew System::Net::Http::Headers::RangeHeaderValue(
+            Nullable<long long>((long long)offset), Nullable<long long>((long long)(offset + size_to_read - 1)));
+
+        if (etag)
+            rq->Headers->TryAddWithoutValidation("If-Match", etag);
+
+#ifndef NETCORE
+        // .Net Framework limits connections via the servicepoint, not the handler
+        auto sp = System::Net::ServicePointManager::FindServicePoint(rq->RequestUri);
+        if (sp->ConnectionLimit < _maxConnections)
+            sp->ConnectionLimit = _maxConnections;
+#endif
+        return rq;
+    }
+
+internal:
+    static Stream^ GetStream(HttpResponseMessage^ rp)
+    {
+#ifdef NETCORE
+        return rp->Content->ReadAsStream();
+#else
+        return rp->Content->ReadAsStreamAsync()->GetAwaiter().GetResult();
+#endif
+    }
+
+    static Dictionary<String^, String^>^ GetHeaders(HttpResponseMessage^ rp)
+    {
+        auto headers = gcnew Dictionary<String^, String^>(StringComparer::OrdinalIgnoreCase);
+
+        for each (KeyValuePair<String^, IEnumerable<String^>^> h in rp->Headers)
+            headers[h.Key] = String::Join(", ", h.Value);
+
+        if (rp->Content)
+        {
+            for each (KeyValuePair<String^, IEnumerable<String^>^> h in rp->Content->Headers)
+                headers[h.Key] = String::Join(", ", h.Value);
+        }
+
+        return headers;
+    }
 };
 
+static void report_http_error(ProjContext^ pc, Exception^ ex, size_t error_string_max_size, char* out_error_string)
+{
+    pc->OnLogMessage(ProjLogLevel::Error, ex->ToString());
+    pc->Counters->Increment(NetworkStatistics::Counter::Failures);
 
-static PROJ_NETWORK_HANDLE* my_network_open(
-    PJ_CONTEXT* ctx,
-    const char* url,
-    unsigned long long offset,
-    size_t size_to_read,
-    void* buffer,
-    size_t* out_size_read,
-    size_t error_string_max_size,
-    char* out_error_string,
-    void* user_data)
+    if (dynamic_cast<System::Net::Http::HttpRequestException^>(ex))
+        utf8_encode(String::Format("HttpRequestException: {0}", ex->Message), out_error_string, error_string_max_size);
+    else if (dynamic_cast<System::Threading::Tasks::TaskCanceledException^>(ex))
+        utf8_encode(String::Format("HTTP Timeout: {0}", ex->Message), out_error_string, error_string_max_size);
+    else
+        utf8_encode(String::Format("HTTP Error: {0}", ex->Message), out_error_string, error_string_max_size);
+}
+
+// True when an established connection was closed under the request, like a kept alive connection the server already
+// dropped. Not for timeouts, refused connections or name resolution failures, so real outages are reported at once
+static bool is_connection_reset(Exception^ ex)
 {
-    UNUSED_ALWAYS(ctx);
-    const auto& ref = *(ctx_wrapper<PJ_CONTEXT, ProjContext>*)user_data;
-    ProjContext^ pc;
-    if (!ref.TryGetTarget(pc))
+    for (; ex; ex = ex->InnerException)
     {
-        strncpy_s(out_error_string, error_string_max_size, "Already disposed", error_string_max_size);
+        System::Net::Sockets::SocketException^ sx = dynamic_cast<System::Net::Sockets::SocketException^>(ex);
+
+        if (sx)
+            return sx->SocketErrorCode == System::Net::Sockets::SocketError::ConnectionReset
+                || sx->SocketErrorCode == System::Net::Sockets::SocketError::ConnectionAborted;
+
+        System::Net::WebException^ wx = dynamic_cast<System::Net::WebException^>(ex);
+
+        if (wx && (wx->Status == System::Net::WebExceptionStatus::KeepAliveFailure
+                   || wx->Status == System::Net::WebExceptionStatus::ConnectionClosed))
+            return true;
+    }
+    return false;
+}
+
+static HttpResponseMessage^ send_range_request(ProjContext^ pc, HttpClient^ client, String^ url, unsigned long long offset, size_t size_to_read, String^ etag, size_t error_string_max_size, char* out_error_string)
+{
+    for (int attempt = 0; ; attempt++)
+    {
+        long long start = Stopwatch::GetTimestamp();
+        try
+        {
+            HttpResponseMessage^ rp = ProjHttp::SendRange(client, url, offset, size_to_read, etag);
+
+            pc->Counters->AddRequest(start);
+            return rp;
+        }
+        catch (System::Net::Http::HttpRequestException^ hx)
+        {
+            // Retry once on a new connection
+            if (attempt == 0 && is_connection_reset(hx))
+            {
+                pc->OnLogMessage(ProjLogLevel::Debug, hx->Message);
+                pc->Counters->Increment(NetworkStatistics::Counter::Retries);
+                continue;
+            }
+
+            report_http_error(pc, hx, error_string_max_size, out_error_string);
+        }
+        catch (Exception^ ex)
+        {
+            report_http_error(pc, ex, error_string_max_size, out_error_string);
+        }
+        return nullptr;
+    }
+}
+
+static HttpResponseMessage^ complete_range_request(ProjContext^ pc, System::Threading::Tasks::Task<HttpResponseMessage^>^ task, long long start, size_t error_string_max_size, char* out_error_string)
+{
+    try
+    {
+        HttpResponseMessage^ rp = task->GetAwaiter().GetResult();
+
+        pc->Counters->AddRequest(start);
+        return rp;
+    }
+    catch (Exception^ ex)
+    {
+        report_http_error(pc, ex, error_string_max_size, out_error_string);
+    }
+    return nullptr;
+}
+
+static int read_fully(Stream^ s, array<unsigned char>^ buf, int to_read)
+{
+    int r = 0;
+
+    while (r < to_read)
+    {
+        int n = s->Read(buf, r, to_read - r);
+
+        if (n > 0)
+            r += n;
+        else
+            break;
+    }
+    return r;
+}
+
+// Process wide cache of grid blocks, shared by all contexts. Blocks are keyed by url, file version (ETag, or
+// Last-Modified when the server has no ETag), block size and block index, so blocks of a changed file never mix
+private ref class ProjBlockCache abstract sealed
+{
+public:
+    value struct Key : IEquatable<Key>
+    {
+        String^ Url;
+        String^ Version;
+        long long BlockSize;
+        long long Index;
+
+        Key(String^ url, String^ version, long long blockSize, long long index)
+        {
+            Url = url;
+            Version = version;
+            BlockSize = blockSize;
+            Index = index;
+        }
+
+        virtual bool Equals(Key other)
+        {
+            return Index == other.Index && BlockSize == other.BlockSize
+                && String::Equals(Url, other.Url) && String::Equals(Version, other.Version);
+        }
+
+        virtual bool Equals(Object^ other) override
+        {
+            return (other && other->GetType() == Key::typeid) ? Equals(safe_cast<Key>(other)) : false;
+        }
+
+        virtual int GetHashCode() override
+        {
+            return Url->GetHashCode() ^ (Version ? Version->GetHashCode() : 0) ^ Index.GetHashCode() ^ (int)BlockSize;
+        }
+    };
+
+    ref class FileInfo sealed
+    {
+    public:
+        String^ ETag;
+        String^ Version;
+        long long Length;
+        Dictionary<String^, String^>^ Headers;
+        DateTime Expires;
+    };
+
+private:
+    value struct Entry
+    {
+        Key BlockKey;
+        array<unsigned char>^ Data;
+        NetworkBytes^ Owner;
+    };
+
+    static initonly Object^ _lock = gcnew Object();
+    static initonly Dictionary<Key, System::Collections::Generic::LinkedListNode<Entry>^>^ _blocks = gcnew Dictionary<Key, System::Collections::Generic::LinkedListNode<Entry>^>();
+    static initonly System::Collections::Generic::LinkedList<Entry>^ _lru = gcnew System::Collections::Generic::LinkedList<Entry>(); // Most recently used first
+    static initonly System::Collections::Concurrent::ConcurrentDictionary<String^, FileInfo^>^ _files = gcnew System::Collections::Concurrent::ConcurrentDictionary<String^, FileInfo^>();
+    static long long _size;
+    // Evicted blocks are reused for later fetches, but not while a reader is still copying from them
+    static initonly Dictionary<array<unsigned char>^, int>^ _lent = gcnew Dictionary<array<unsigned char>^, int>();
+    static initonly System::Collections::Generic::HashSet<array<unsigned char>^>^ _evictedLent = gcnew System::Collections::Generic::HashSet<array<unsigned char>^>();
+    static initonly System::Collections::Generic::Stack<array<unsigned char>^>^ _free = gcnew System::Collections::Generic::Stack<array<unsigned char>^>();
+    literal int MaxFree = 16;
+
+internal:
+    static long long _limit = 64 * 1024 * 1024;
+    literal int FileInfoSeconds = 3600; // Recheck the file version after this time
+
+    // Gets a block for copying. Give it back with Return() when done
+    static array<unsigned char>^ Get(Key key)
+    {
+        System::Threading::Monitor::Enter(_lock);
+        try
+        {
+            System::Collections::Generic::LinkedListNode<Entry>^ node;
+
+            if (!_blocks->TryGetValue(key, node))
+                return nullptr;
+
+            _lru->Remove(node);
+            _lru->AddFirst(node);
+            Lend(node->Value.Data);
+            return node->Value.Data;
+        }
+        finally
+        {
+            System::Threading::Monitor::Exit(_lock);
+        }
+    }
+
+    static bool Contains(Key key)
+    {
+        System::Threading::Monitor::Enter(_lock);
+        try
+        {
+            return _blocks->ContainsKey(key);
+        }
+        finally
+        {
+            System::Threading::Monitor::Exit(_lock);
+        }
+    }
+
+    // Stores a block. With lend, the caller keeps copying from it and gives it back with Return()
+    static void Put(Key key, array<unsigned char>^ data, NetworkBytes^ owner, bool lend)
+    {
+        System::Threading::Monitor::Enter(_lock);
+        try
+        {
+            if (lend)
+                Lend(data);
+
+            System::Collections::Generic::LinkedListNode<Entry>^ node;
+
+            if (_blocks->TryGetValue(key, node))
+            {
+                Release(node->Value);
+                _lru->Remove(node);
+            }
+
+            Entry e;
+            e.BlockKey = key;
+            e.Data = data;
+            e.Owner = owner;
+            _blocks[key] = _lru->AddFirst(e);
+            _size += data->Length;
+
+            TrimLocked();
+        }
+        finally
+        {
+            System::Threading::Monitor::Exit(_lock);
+        }
+    }
+
+    static void Trim()
+    {
+        System::Threading::Monitor::Enter(_lock);
+        try
+        {
+            TrimLocked();
+
+            if (!_limit)
+                _free->Clear();
+        }
+        finally
+        {
+            System::Threading::Monitor::Exit(_lock);
+        }
+    }
+
+    static void Return(array<array<unsigned char>^>^ blocks)
+    {
+        System::Threading::Monitor::Enter(_lock);
+        try
+        {
+            for each (array<unsigned char>^ data in blocks)
+            {
+                int n;
+
+                if (!data || !_lent->TryGetValue(data, n))
+                    continue;
+                else if (n > 1)
+                    _lent[data] = n - 1;
+                else
+                {
+                    _lent->Remove(data);
+
+                    if (_evictedLent->Remove(data))
+                        Recycle(data);
+                }
+            }
+        }
+        finally
+        {
+            System::Threading::Monitor::Exit(_lock);
+        }
+    }
+
+    // A buffer for a new block of n bytes, preferably one evicted earlier
+    static array<unsigned char>^ Rent(int n)
+    {
+        System::Threading::Monitor::Enter(_lock);
+        try
+        {
+            while (_free->Count)
+            {
+                array<unsigned char>^ data = _free->Pop();
+
+                if (data->Length == n)
+                    return data;
+            }
+        }
+        finally
+        {
+            System::Threading::Monitor::Exit(_lock);
+        }
+
+        return gcnew array<unsigned char>(n);
+    }
+
+    static FileInfo^ GetFile(String^ url)
+    {
+        FileInfo^ fi;
+
+        if (_files->TryGetValue(url, fi) && fi->Expires > DateTime::UtcNow)
+            return fi;
+
         return nullptr;
     }
 
-    if (error_string_max_size > 0 && out_error_string)
-        out_error_string[0] = '\0';
+    static void SetFile(String^ url, FileInfo^ info)
+    {
+        info->Expires = DateTime::UtcNow.AddSeconds(FileInfoSeconds);
+        _files[url] = info;
+    }
+
+    // The file changed on the server. Blocks of the old version age out of the cache
+    static void Invalidate(String^ url)
+    {
+        FileInfo^ fi;
+        _files->TryRemove(url, fi);
+    }
+
+private:
+    static void TrimLocked()
+    {
+        while (_size > _limit && _lru->Count)
+        {
+            System::Collections::Generic::LinkedListNode<Entry>^ node = _lru->Last;
+
+            _lru->RemoveLast();
+            _blocks->Remove(node->Value.BlockKey);
+            Release(node->Value);
+        }
+    }
+
+    static void Release(Entry e)
+    {
+        _size -= e.Data->Length;
+
+        if (e.Owner)
+            System::Threading::Interlocked::Add(e.Owner->Value, -(long long)e.Data->Length);
+
+        if (_lent->ContainsKey(e.Data))
+            _evictedLent->Add(e.Data);
+        else
+            Recycle(e.Data);
+    }
+
+    static void Lend(array<unsigned char>^ data)
+    {
+        int n;
+        _lent->TryGetValue(data, n);
+        _lent[data] = n + 1;
+    }
+
+    static void Recycle(array<unsigned char>^ data)
+    {
+        if (_limit && _free->Count < MaxFree)
+            _free->Push(data);
+    }
+};
+
+// Reads one url for PROJ. PROJ reads grids in small chunks, which would each be a round trip. We fetch aligned
+// blocks instead, merge adjacent missing blocks into one request and read ahead when access is sequential or clustered.
+// Blocks are kept in the process wide ProjBlockCache
+private ref class ProjBlockReader sealed
+{
+private:
+    initonly String^ m_url;
+    initonly long long m_blockSize;
+    long long m_length;
+    long long m_nextBlock;
+    int m_readAhead;
+    String^ m_etag;
+    String^ m_version;
+    Dictionary<String^, String^>^ m_headers;
+    // Blocks of the current Read call, so blocks evicted by other readers are still available for copying
+    array<array<unsigned char>^>^ m_pending;
+    long long m_pendingFirst;
+#ifndef NETCORE
+    [ThreadStatic]
+    static array<unsigned char>^ _scratch;
+    literal int ScratchSize = 64 * 1024;
+#endif
+    literal long long SplitBytes = 256 * 1024;
+
+internal:
+    static int _blockSize = 64 * 1024;
+    literal int MaxReadAheadBytes = 1024 * 1024;
+
+    ProjBlockReader(String^ url)
+    {
+        m_url = url;
+        m_blockSize = _blockSize;
+        m_length = -1;
+        m_nextBlock = -1;
+
+        // Known from an earlier reader? Then we may not need any request
+        ProjBlockCache::FileInfo^ fi = ProjBlockCache::GetFile(url);
+
+        if (fi)
+        {
+            m_etag = fi->ETag;
+            m_version = fi->Version;
+            m_length = fi->Length;
+            m_headers = fi->Headers;
+        }
+    }
+
+    // Headers of the last response
+    property Dictionary<String^, String^>^ Headers
+    {
+        Dictionary<String^, String^>^ get()
+        {
+            return m_headers;
+        }
+    }
+
+    size_t Read(ProjContext^ pc, ctx_wrapper<PJ_CONTEXT, ProjContext>* wrapper, unsigned long long offset, size_t size_to_read, void* buffer, size_t error_string_max_size, char* out_error_string)
+    {
+        if (!size_to_read)
+            return 0;
+        else if (!ProjBlockCache::_limit)
+        {
+            HttpClient^ client = ProjHttp::Acquire();
+            try
+            {
+                return ReadDirect(pc, client, offset, size_to_read, buffer, error_string_max_size, out_error_string);
+            }
+            finally
+            {
+                ProjHttp::Release(client);
+            }
+        }
+
+        long long first = (long long)offset / m_blockSize;
+        long long last = (long long)(offset + size_to_read - 1) / m_blockSize;
+
+        if (m_length >= 0)
+        {
+            if ((long long)offset >= m_length)
+            {
+                strncpy_s(out_error_string, error_string_max_size, "Read beyond end of file", error_string_max_size);
+                return 0;
+            }
+            last = Math::Min(last, (m_length - 1) / m_blockSize);
+        }
+
+        // Continuing near where the last read ended? Then grow the read-ahead, otherwise stop reading ahead
+        if (m_nextBlock >= 0 && Math::Abs(first - m_nextBlock) <= 1)
+            m_readAhead = (int)Math::Min(Math::Max(1LL, 2LL * m_readAhead), MaxReadAhead());
+        else
+            m_readAhead = 0;
+
+        m_nextBlock = last + 1;
+        m_pending = gcnew array<array<unsigned char>^>((int)(last - first + 1));
+        m_pendingFirst = first;
+
+        try
+        {
+            // Contiguous runs of missing blocks, each fetched with a single request
+            List<KeyValuePair<long long, long long>>^ runs = nullptr;
+            int hits = 0;
+            for (long long b = first; b <= last; b++)
+            {
+                if (m_version && (m_pending[(int)(b - first)] = ProjBlockCache::Get(KeyOf(b))))
+                {
+                    hits++;
+                    continue;
+                }
+
+                if (!runs)
+                    runs = gcnew List<KeyValuePair<long long, long long>>();
+
+                if (runs->Count && runs[runs->Count - 1].Value == b - 1)
+                    runs[runs->Count - 1] = KeyValuePair<long long, long long>(runs[runs->Count - 1].Key, b);
+                else
+                    runs->Add(KeyValuePair<long long, long long>(b, b));
+            }
+
+            if (hits)
+                pc->Counters->Add(NetworkStatistics::Counter::BlockCacheHits, hits);
+
+            if (runs)
+            {
+                pc->Counters->Add(NetworkStatistics::Counter::BlockCacheMisses, (last - first + 1) - hits);
+
+                long long runFirst = runs[runs->Count - 1].Key;
+                long long fetchLast = runs[runs->Count - 1].Value;
+
+                for (int i = 0; i < m_readAhead; i++)
+                {
+                    long long b = fetchLast + 1;
+
+                    if ((m_length >= 0 && b * m_blockSize >= m_length) || (m_version && ProjBlockCache::Contains(KeyOf(b))))
+                        break;
+
+                    fetchLast = b;
+                }
+                runs[runs->Count - 1] = KeyValuePair<long long, long long>(runFirst, fetchLast);
+
+                HttpClient^ client = ProjHttp::Acquire();
+                try
+                {
+                    if (!FetchRuns(pc, client, wrapper, runs, error_string_max_size, out_error_string))
+                        return 0;
+                }
+                finally
+                {
+                    ProjHttp::Release(client);
+                }
+            }
+
+            unsigned char* dest = (unsigned char*)buffer;
+            long long end = (long long)(offset + size_to_read);
+            size_t done = 0;
+
+            for (long long b = first; b <= last; b++)
+            {
+                array<unsigned char>^ data = m_pending[(int)(b - first)];
+
+                if (!data)
+                    break;
+
+                long long blockStart = b * m_blockSize;
+                long long from = Math::Max((long long)offset, blockStart) - blockStart;
+                long long to = Math::Min(end, blockStart + data->Length) - blockStart;
+
+                if (to <= from)
+                    break;
+
+                pin_ptr<unsigned char> pData = &data[(int)from];
+                memcpy(dest + done, pData, (size_t)(to - from));
+                done += (size_t)(to - from);
+
+                if (data->Length < m_blockSize)
+                    break; // End of file
+            }
+
+            if (!done)
+                strncpy_s(out_error_string, error_string_max_size, "Read error", error_string_max_size);
+
+            return done;
+        }
+        finally
+        {
+            ProjBlockCache::Return(m_pending);
+            m_pending = nullptr;
+        }
+    }
+
+private:
+    ProjBlockCache::Key KeyOf(long long index)
+    {
+        return ProjBlockCache::Key(m_url, m_version, m_blockSize, index);
+    }
+
+    long long MaxReadAhead()
+    {
+        return Math::Max(1LL, Math::Min((long long)MaxReadAheadBytes, ProjBlockCache::_limit / 4) / m_blockSize);
+    }
+
+    bool AcceptResponse(ProjContext^ pc, HttpResponseMessage^ rp, size_t error_string_max_size, char* out_error_string)
+    {
+        if (rp->StatusCode != HttpStatusCode::PartialContent)
+        {
+            pc->Counters->Increment(NetworkStatistics::Counter::Failures);
+
+            if (rp->StatusCode == HttpStatusCode::PreconditionFailed)
+            {
+                pc->Counters->Increment(NetworkStatistics::Counter::ETagMismatches);
+                ProjBlockCache::Invalidate(m_url);
+            }
+
+            if (rp->IsSuccessStatusCode)
+                strncpy_s(out_error_string, error_string_max_size, "No partial web response", error_string_max_size);
+            else
+            {
+                pc->OnLogMessage(ProjLogLevel::Error, String::Format("HTTP(S) result {0}: {1}", rp->StatusCode, rp->ReasonPhrase));
+                utf8_encode(String::Format("Unexpected HTTP(S) result {0}: {1}", rp->StatusCode, rp->ReasonPhrase), out_error_string, error_string_max_size);
+            }
+            return false;
+        }
+
+        m_headers = ProjHttp::GetHeaders(rp);
+
+        String^ etag;
+        String^ version;
+        m_headers->TryGetValue("ETag", etag);
+
+        if (!etag)
+            m_headers->TryGetValue("Last-Modified", version);
+        else
+            version = etag;
+
+        if (!m_version)
+        {
+            m_etag = etag;
+            m_version = version ? version : String::Empty;
+
+            if (rp->Content && rp->Content->Headers->ContentRange && rp->Content->Headers->ContentRange->HasLength)
+                m_length = rp->Content->Headers->ContentRange->Length.Value;
+
+            ProjBlockCache::FileInfo^ fi = gcnew ProjBlockCache::FileInfo();
+            fi->ETag = m_etag;
+            fi->Version = m_version;
+            fi->Length = m_length;
+            fi->Headers = m_headers;
+            ProjBlockCache::SetFile(m_url, fi);
+        }
+        else if (version && !String::Equals(version, m_version))
+        {
+            // Changed without an ETag to catch it
+            pc->Counters->Increment(NetworkStatistics::Counter::ETagMismatches);
+            ProjBlockCache::Invalidate(m_url);
+            strncpy_s(out_error_string, error_string_max_size, "File changed on server", error_string_max_size);
+            return false;
+        }
+
+        return true;
+    }
+
+    // Without block cache: stream the response straight into PROJ's buffer
+    size_t ReadDirect(ProjContext^ pc, HttpClient^ client, unsigned long long offset, size_t size_to_read, void* buffer, size_t error_string_max_size, char* out_error_string)
+    {
+        HttpResponseMessage^ rp = send_range_request(pc, client, m_url, offset, size_to_read, m_etag, error_string_max_size, out_error_string);
+
+        if (!rp)
+            return 0;
+
+        try
+        {
+            if (!AcceptResponse(pc, rp, error_string_max_size, out_error_string))
+                return 0;
+
+            size_t r = read_native(ProjHttp::GetStream(rp), (unsigned char*)buffer, size_to_read);
+
+            // The bytes land in PROJ's own buffer; nothing is retained here
+            if (r)
+                pc->Counters->Add(NetworkStatistics::Counter::Bytes, r);
+            else
+                strncpy_s(out_error_string, error_string_max_size, "Read error", error_string_max_size);
+
+            return r;
+        }
+        catch (Exception^ ex)
+        {
+            pc->OnLogMessage(ProjLogLevel::Error, ex->ToString());
+            utf8_encode(String::Format("HTTP Error: {0}", ex->Message), out_error_string, error_string_max_size);
+            return 0;
+        }
+        finally
+        {
+            delete rp;
+        }
+    }
+
+    static size_t read_native(Stream^ s, unsigned char* dest, size_t size)
+    {
+#ifdef NETCORE
+        // CopyTo uses a pooled buffer here
+        UnmanagedMemoryStream^ ums = gcnew UnmanagedMemoryStream(dest, 0, (long long)size, FileAccess::Write);
+        s->CopyTo(ums);
+        return (size_t)ums->Position;
+#else
+        array<unsigned char>^ scratch = _scratch;
+
+        if (!scratch)
+            _scratch = scratch = gcnew array<unsigned char>(ScratchSize);
 
+        pin_ptr<unsigned char> pScratch = &scratch[0];
+        size_t done = 0;
 
-    String^ sUrl = Utf8_PtrToString(url);
-    WebRequest^ rq = WebRequest::Create(sUrl);
+        while (done < size)
+        {
+            int n = s->Read(scratch, 0, (int)Math::Min((long long)(size - done), (long long)scratch->Length));
 
-    HttpWebRequest^ hrq = dynamic_cast<HttpWebRequest^>(rq);
+            if (n <= 0)
+                break;
 
-    if (hrq != nullptr)
-    {
-        hrq->UserAgent = "System.Net/SharpProj using PROJ " PROJ_VERSION;
-        hrq->AddRange((long long)offset, (long long)(offset + size_to_read));
+            memcpy(dest + done, pScratch, n);
+            done += n;
+        }
+        return done;
+#endif
     }
-    else
-        rq->Headers->Add(String::Format("Range: bytes={0}-{1}", offset, offset + size_to_read - 1));
 
+    void GetByteRange(long long first, long long last, long long% from, long long% to)
+    {
+        from = first * m_blockSize;
+        to = (last + 1) * m_blockSize;
 
-    bool in_error = true;
-    WebResponse^ rp;
+        if (m_length >= 0 && to > m_length)
+            to = m_length;
+    }
 
-    try
+    // Fetches the runs of blocks, concurrently when there is more than one. Large runs are split, to use multiple connections
+    bool FetchRuns(ProjContext^ pc, HttpClient^ client, ctx_wrapper<PJ_CONTEXT, ProjContext>* wrapper, List<KeyValuePair<long long, long long>>^ runs, size_t error_string_max_size, char* out_error_string)
     {
-        rp = rq->GetResponse();
-        in_error = false;
+        if (m_length >= 0)
+        {
+            long long split = Math::Max(1LL, SplitBytes / m_blockSize);
+
+            for (int i = 0; i < runs->Count; i++)
+            {
+                KeyValuePair<long long, long long> r = runs[i];
+
+                if (r.Value - r.Key + 1 > split)
+                {
+                    runs[i] = KeyValuePair<long long, long long>(r.Key, r.Key + split - 1);
+                    runs->Insert(i + 1, KeyValuePair<long long, long long>(r.Key + split, r.Value));
+                }
+            }
+        }
+
+        if (runs->Count == 1)
+        {
+            long long from, to;
+            GetByteRange(runs[0].Key, runs[0].Value, from, to);
+
+            HttpResponseMessage^ rp = send_range_request(pc, client, m_url, from, (size_t)(to - from), m_etag, error_string_max_size, out_error_string);
+
+            return rp && StoreResponse(pc, wrapper, runs[0].Key, from, to, rp, error_string_max_size, out_error_string);
+        }
+
+        // Keep at most NetworkMaxConnectionsPerServer requests in flight and handle the responses in order
+        int parallel = Math::Max(1, Math::Min(ProjContext::NetworkMaxConnectionsPerServer, runs->Count));
+        array<System::Threading::Tasks::Task<HttpResponseMessage^>^>^ tasks = gcnew array<System::Threading::Tasks::Task<HttpResponseMessage^>^>(runs->Count);
+        array<long long>^ started = gcnew array<long long>(runs->Count);
+        bool ok = true;
+
+        for (int i = 0; i < runs->Count; i++)
+        {
+            for (int j = i; j < runs->Count && j < i + parallel; j++)
+            {
+                if (!tasks[j] && !started[j])
+                {
+                    started[j] = Stopwatch::GetTimestamp();
+                    tasks[j] = StartFetch(pc, client, runs[j], error_string_max_size, out_error_string);
+                }
+            }
+
+            HttpResponseMessage^ rp = tasks[i] ? complete_range_request(pc, tasks[i], started[i], error_string_max_size, out_error_string) : nullptr;
+
+            if (!rp)
+            {
+                ok = false;
+                continue;
+            }
+
+            long long from, to;
+            GetByteRange(runs[i].Key, runs[i].Value, from, to);
+
+            // Also on failure, to release the other responses
+            if (!StoreResponse(pc, wrapper, runs[i].Key, from, to, rp, error_string_max_size, out_error_string))
+                ok = false;
+        }
+
+        return ok;
     }
-    catch (System::Net::WebException^ wx)
+
+    System::Threading::Tasks::Task<HttpResponseMessage^>^ StartFetch(ProjContext^ pc, HttpClient^ client, KeyValuePair<long long, long long> run, size_t error_string_max_size, char* out_error_string)
     {
-        pc->OnLogMessage(ProjLogLevel::Error, wx->ToString());
-        rp = wx->Response;
+        long long from, to;
+        GetByteRange(run.Key, run.Value, from, to);
 
-        if (!rp)
+        try
+        {
+            return ProjHttp::SendRangeAsync(client, m_url, from, (size_t)(to - from), m_etag);
+        }
+        catch (Exception^ ex)
         {
-            pc->OnLogMessage(ProjLogLevel::Error, wx->ToString());
-            std::string msg = utf8_string(String::Format("WebException/open: {0}", wx->Message));
-            strncpy_s(out_error_string, error_string_max_size, msg.c_str(), error_string_max_size);
+            report_http_error(pc, ex, error_string_max_size, out_error_string);
             return nullptr;
         }
     }
-    catch (Exception^ ex)
-    {
-        pc->OnLogMessage(ProjLogLevel::Error, ex->ToString());
-        std::string msg = utf8_string(String::Format("HTTP Error: {0}", ex->Message));
-        strncpy_s(out_error_string, error_string_max_size, msg.c_str(), error_string_max_size);
-        return nullptr;
-    }
 
-    try
+    // Reads the response into the blocks starting at first. Takes ownership of rp
+    bool StoreResponse(ProjContext^ pc, ctx_wrapper<PJ_CONTEXT, ProjContext>* wrapper, long long first, long long from, long long to, HttpResponseMessage^ rp, size_t error_string_max_size, char* out_error_string)
     {
-        HttpWebResponse^ hrp = dynamic_cast<HttpWebResponse^>(rp);
-
-        if (hrp && hrp->StatusCode == HttpStatusCode::PartialContent)
+        try
         {
-            System::IO::Stream^ s = hrp->GetResponseStream();
-
-            int to_read = (int)Math::Min((long long)size_to_read, (long long)int::MaxValue);
-            array<unsigned char>^ buf = gcnew array<unsigned char>(to_read);
+            if (!AcceptResponse(pc, rp, error_string_max_size, out_error_string))
+                return false;
 
-            int r = s->Read(buf, 0, to_read);
+            Stream^ s = ProjHttp::GetStream(rp);
+            long long total = 0;
 
-            while (r > 0 && r < to_read)
+            for (long long b = first; from < to; b++)
             {
-                int n = s->Read(buf, r, to_read - r);
+                int n = (int)Math::Min(m_blockSize, to - from);
+                array<unsigned char>^ data = ProjBlockCache::Rent(n);
+                int r = read_fully(s, data, n);
 
-                if (n > 0)
-                    r += n;
-                else
+                if (r <= 0)
                     break;
-            }
+                else if (r < n)
+                    Array::Resize(data, r);
 
-            if (r > 0)
-            {
-                pin_ptr<unsigned char> pBuf = &buf[0];
-                memcpy(buffer, pBuf, r);
-                *out_size_read = r;
+                Store(wrapper, b, data);
+                from += r;
+                total += r;
+
+                if (r < n)
+                    break;
             }
-            else
+
+            if (!total)
             {
                 strncpy_s(out_error_string, error_string_max_size, "Read error", error_string_max_size);
-                *out_size_read = 0;
-                return nullptr;
+                return false;
             }
 
+            wrapper->AddNetworkBytes(total);
+            pc->Counters->Add(NetworkStatistics::Counter::Bytes, total);
+            return true;
         }
-        else if (!in_error)
+        catch (Exception^ ex)
         {
-            strncpy_s(out_error_string, error_string_max_size, "No partial web response", error_string_max_size);
-            return nullptr;
-        }
-        else if (hrp)
-        {
-            std::string msg = utf8_string(String::Format("Unexpected HTTP(S) result {0}: {1}", hrp->StatusCode, hrp->StatusDescription));
-            strncpy_s(out_error_string, error_string_max_size, msg.c_str(), error_string_max_size);
-            return nullptr;
+            pc->OnLogMessage(ProjLogLevel::Error, ex->ToString());
+            utf8_encode(String::Format("HTTP Error: {0}", ex->Message), out_error_string, error_string_max_size);
+            return false;
         }
-        else if (rp)
+        finally
         {
-            std::string msg = utf8_string(String::Format("Unexpected WebResponse {0}", rp->ToString()));
-            strncpy_s(out_error_string, error_string_max_size, msg.c_str(), error_string_max_size);
-            return nullptr;
+            delete rp;
         }
+    }
+
+    void Store(ctx_wrapper<PJ_CONTEXT, ProjContext>* wrapper, long long index, array<unsigned char>^ data)
+    {
+        bool pending = m_pending && index >= m_pendingFirst && index - m_pendingFirst < m_pending->Length;
+
+        ProjBlockCache::Put(KeyOf(index), data, wrapper->NetworkBytesCounter(), pending);
 
-        my_network_data* d = new my_network_data();
-        d->ctx = pc;
-        d->url = sUrl;
-        d->Headers = rp->Headers;
-        d->chain = nullptr;
-        return (PROJ_NETWORK_HANDLE*)(void*)d;
+        if (pending)
+            m_pending[(int)(index - m_pendingFirst)] = data;
     }
-    finally
+};
+
+struct my_network_data
+{
+    gcroot<ProjContext^> ctx;
+    gcroot<ProjBlockReader^> reader;
+    void* chain;
+
+public:
+    my_network_data()
+    {}
+    ~my_network_data()
+    {}
+};
+
+static PROJ_NETWORK_HANDLE* my_network_open(
+    PJ_CONTEXT* ctx,
+    const char* url,
+    unsigned long long offset,
+    size_t size_to_read,
+    void* buffer,
+    size_t* out_size_read,
+    size_t error_string_max_size,
+    char* out_error_string,
+    void* user_data)
+{
+    UNUSED_ALWAYS(ctx);
+    auto& ref = *(ctx_wrapper<PJ_CONTEXT, ProjContext>*)user_data;
+    ProjContext^ pc;
+    if (!ref.TryGetTarget(pc))
     {
-        if (rp)
-            delete rp;
+        strncpy_s(out_error_string, error_string_max_size, "Already disposed", error_string_max_size);
+        return nullptr;
     }
+
+    if (error_string_max_size > 0 && out_error_string)
+        out_error_string[0] = '\0';
+
+    ProjBlockReader^ reader = gcnew ProjBlockReader(Utf8_PtrToString(url));
+
+    size_t r = reader->Read(pc, &ref, offset, size_to_read, buffer, error_string_max_size, out_error_string);
+
+    *out_size_read = r;
+    if (!r)
+        return nullptr;
+
+    my_network_data* d = new my_network_data();
+    d->ctx = pc;
+    d->reader = reader;
+    d->chain = nullptr;
+    return (PROJ_NETWORK_HANDLE*)(void*)d;
 }
 
 static void my_network_close(
@@ -186,12 +1094,13 @@ const char* my_network_get_header_value(
     UNUSED_ALWAYS(ctx);
     UNUSED_ALWAYS(user_data);
     my_network_data* d = (my_network_data*)handle;
+    Dictionary<String^, String^>^ headers = d->reader->Headers;
 
-    if (d->Headers)
+    if (headers)
     {
-        String^ h = d->Headers->Get(Utf8_PtrToString(header_name));
+        String^ h;
 
-        if (h)
+        if (headers->TryGetValue(Utf8_PtrToString(header_name), h) && h)
             return d->ctx->utf8_chain(h, d->chain);
     }
 
@@ -209,186 +1118,355 @@ size_t my_network_read_range(
     void* user_data)
 {
     UNUSED_ALWAYS(ctx);
-    UNUSED_ALWAYS(user_data);
     my_network_data* d = (my_network_data*)handle;
 
     if (error_string_max_size > 0 && out_error_string)
         out_error_string[0] = '\0';
 
-    d->Headers = nullptr;
+    return d->reader->Read(d->ctx, (ctx_wrapper<PJ_CONTEXT, ProjContext>*)user_data, offset, size_to_read, buffer, error_string_max_size, out_error_string);
+}
 
+TimeSpan ProjContext::NetworkTimeout::get()
+{
+    return ProjHttp::_timeout;
+}
 
-    WebRequest^ rq = WebRequest::Create(d->url);
-    HttpWebRequest^ hrq = dynamic_cast<HttpWebRequest^>(rq);
+void ProjContext::NetworkTimeout::set(TimeSpan value)
+{
+    if (value <= TimeSpan::Zero && value != System::Threading::Timeout::InfiniteTimeSpan)
+        throw gcnew ArgumentOutOfRangeException("value");
 
-    if (hrq != nullptr)
-    {
-        hrq->AddRange((long long)offset, (long long)(offset + size_to_read));
-    }
-    else
-        rq->Headers->Add(String::Format("Range: bytes={0}-{1}", offset, offset + size_to_read - 1));
+    ProjHttp::_timeout = value;
+    ProjHttp::Reset();
+}
 
-    if ((String^)d->etag != nullptr)
-        rq->Headers->Add("If-Match: " + d->etag);
+int ProjContext::NetworkMaxConnectionsPerServer::get()
+{
+    return ProjHttp::_maxConnections;
+}
 
-    WebResponse^ rp;
-    bool in_error = true;
+void ProjContext::NetworkMaxConnectionsPerServer::set(int value)
+{
+    if (value < 1)
+        throw gcnew ArgumentOutOfRangeException("value");
 
-    try
-    {
-        rp = rq->GetResponse();
-        in_error = false;
-    }
-    catch (System::Net::WebException^ wx)
+    ProjHttp::_maxConnections = value;
+    ProjHttp::Reset();
+}
+
+int ProjContext::NetworkBlockSize::get()
+{
+    return ProjBlockReader::_blockSize;
+}
+
+void ProjContext::NetworkBlockSize::set(int value)
+{
+    if (value < 4096 || value > 16 * 1024 * 1024)
+        throw gcnew ArgumentOutOfRangeException("value");
+
+    ProjBlockReader::_blockSize = value;
+}
+
+array<Byte>^ ProjContext::ReadNetworkRange(String^ url, long long offset, int count)
+{
+    ProjBlockReader^ reader = gcnew ProjBlockReader(url);
+    array<Byte>^ data = gcnew array<Byte>(count);
+    char error[256] = "";
+    pin_ptr<Byte> pData = &data[0];
+
+    if (reader->Read(this, &m_ctx, offset, count, pData, sizeof(error), error) != (size_t)count)
+        throw gcnew IOException(Utf8_PtrToString(error));
+
+    return data;
+}
+
+long long ProjContext::NetworkBlockCacheSize::get()
+{
+    return ProjBlockCache::_limit;
+}
+
+void ProjContext::NetworkBlockCacheSize::set(long long value)
+{
+    if (value < 0)
+        throw gcnew ArgumentOutOfRangeException("value");
+
+    ProjBlockCache::_limit = value;
+    ProjBlockCache::Trim();
+}
+
+void ProjContext::SetupNetworkHandling()
+{
+    proj_context_set_network_callbacks(
+        m_ctx,
+        my_network_open,
+        my_network_close,
+        my_network_get_header_value,
+        my_network_read_range,
+        &m_ctx);
+}
+
+// Downloads proj.db from the SharpProj.Database package. The package is spooled to disk, so an interrupted download
+// resumes with a range request on the next attempt, and checked against the SHA512 hash nuget.org publishes in its
+// catalog before proj.db is extracted. After a failure further attempts are held off, to avoid downloading megabytes
+// on every FindFile while the network is bad.
+private ref class ProjDBDownload abstract sealed
+{
+private:
+    static initonly Object^ _lock = gcnew Object();
+    static DateTime _retryAfter;
+    static int _failures;
+    literal int MinRetrySeconds = 60;
+    literal int MaxRetrySeconds = 3600;
+
+    static initonly String^ PackageUrl = "https://www.nuget.org/api/v2/package/SharpProj.Database/" PROJ_VERSION;
+    static initonly String^ RegistrationUrl = "https://api.nuget.org/v3/registration5-semver1/sharpproj.database/" PROJ_VERSION ".json";
+    static initonly String^ EntryName = "contentFiles/any/any/proj.db";
+
+internal:
+    static void Download(String^ target)
     {
-        d->ctx->OnLogMessage(ProjLogLevel::Error, wx->ToString());
-        rp = wx->Response;
+        // One download at a time. Waiters find the file when it succeeded, or the failure state when it did not
+        System::Threading::Monitor::Enter(_lock);
+        try
+        {
+            if (File::Exists(target) || DateTime::UtcNow < _retryAfter)
+                return;
 
-        if (!rp)
+            try
+            {
+                String^ spool = target + ".nupkg.part";
+                HttpClient^ client = ProjHttp::Acquire();
+                bool ok;
+                try
+                {
+                    ok = Spool(client, spool) && Verify(client, spool);
+                }
+                finally
+                {
+                    ProjHttp::Release(client);
+                }
+
+                if (ok && Extract(spool, target))
+                {
+                    _failures = 0;
+                    try
+                    {
+                        File::Delete(spool);
+                        File::Delete(spool + ".etag");
+                    }
+                    catch (IOException^)
+                    {
+                    }
+                    return;
+                }
+            }
+            catch (Exception^)
+            {
+                // Ignore all errors, but remember them
+            }
+
+            _retryAfter = DateTime::UtcNow.AddSeconds(Math::Min((double)MaxRetrySeconds, MinRetrySeconds * Math::Pow(2, Math::Min(_failures, 10))));
+            _failures++;
+        }
+        finally
         {
-            d->ctx->OnLogMessage(ProjLogLevel::Error, wx->ToString());
-            std::string msg = utf8_string(String::Format("WebException/read_range: {0}", wx->Message));
-            strncpy_s(out_error_string, error_string_max_size, msg.c_str(), error_string_max_size);
-            return 0;
+            System::Threading::Monitor::Exit(_lock);
         }
     }
-    catch (Exception^ ex)
-    {
-        d->ctx->OnLogMessage(ProjLogLevel::Error, ex->ToString());
-        std::string msg = utf8_string(String::Format("HTTP Error: {0}", ex->Message));
-        strncpy_s(out_error_string, error_string_max_size, msg.c_str(), error_string_max_size);
-        return 0;
-    }
 
-    try
+private:
+    // Downloads the package to spool, continuing a previous partial download when the server still has the same file
+    static bool Spool(HttpClient^ client, String^ spool)
     {
-        HttpWebResponse^ hrp = dynamic_cast<HttpWebResponse^>(rp);
+        String^ etagFile = spool + ".etag";
+        long long have = File::Exists(spool) ? (gcnew FileInfo(spool))->Length : 0;
+        String^ etag = (have > 0 && File::Exists(etagFile)) ? File::ReadAllText(etagFile) : nullptr;
 
-        if (hrp && hrp->StatusCode == HttpStatusCode::PartialContent)
+        HttpRequestMessage^ rq = gcnew HttpRequestMessage(HttpMethod::Get, PackageUrl);
+
+        if (etag)
         {
-            System::IO::Stream^ s = hrp->GetResponseStream();
+            rq->Headers->Range = gcnew System::Net::Http::Headers::RangeHeaderValue(Nullable<long long>(have), Nullable<long long>());
+            rq->Headers->TryAddWithoutValidation("If-Range", etag); // Full response when the file changed
+        }
 
-            int to_read = (int)Math::Min((long long)size_to_read, (long long)int::MaxValue);
-            array<unsigned char>^ buf = gcnew array<unsigned char>(to_read);
+#ifndef NETCORE
+        HttpResponseMessage^ rp = client->SendAsync(rq, HttpCompletionOption::ResponseHeadersRead)->GetAwaiter().GetResult();
+#else
+        HttpResponseMessage^ rp = client->Send(rq, HttpCompletionOption::ResponseHeadersRead);
+#endif
+        try
+        {
+            bool append;
 
-            int r = s->Read(buf, 0, to_read);
+            if (rp->StatusCode == HttpStatusCode::PartialContent && etag)
+                append = true;
+            else if (rp->StatusCode == HttpStatusCode::OK)
+                append = false;
+            else if ((int)rp->StatusCode == 416 && etag)
+                return true; // Already complete
+            else
+                return false;
 
-            while (r > 0 && r < to_read)
+            if (!append)
             {
-                int n = s->Read(buf, r, to_read - r);
+                Dictionary<String^, String^>^ headers = ProjHttp::GetHeaders(rp);
+                String^ newEtag;
 
-                if (n > 0)
-                    r += n;
+                if (headers->TryGetValue("ETag", newEtag) || headers->TryGetValue("Last-Modified", newEtag))
+                    File::WriteAllText(etagFile, newEtag);
                 else
-                    break;
+                    File::Delete(etagFile);
             }
 
-            if (r > 0)
+            Nullable<long long> length = rp->Content->Headers->ContentLength;
+            long long expected = length.HasValue ? length.Value : -1;
+            long long written = 0;
+
+            FileStream^ fs = gcnew FileStream(spool, append ? FileMode::Append : FileMode::Create, FileAccess::Write, FileShare::None, 64 * 1024);
+            try
             {
-                pin_ptr<unsigned char> pBuf = &buf[0];
-                memcpy(buffer, pBuf, r);
+                Stream^ s = ProjHttp::GetStream(rp);
+                array<unsigned char>^ buf = gcnew array<unsigned char>(64 * 1024);
+                int n;
 
-                return r;
+                while ((n = s->Read(buf, 0, buf->Length)) > 0)
+                {
+                    fs->Write(buf, 0, n);
+                    written += n;
+                }
             }
-            else
+            finally
             {
-                strncpy_s(out_error_string, error_string_max_size, "Read error", error_string_max_size);
-                return 0;
+                delete fs;
             }
+
+            return expected < 0 || written == expected;
         }
-        else if (!in_error)
-        {
-            strncpy_s(out_error_string, error_string_max_size, "No partial web response", error_string_max_size);
-            return 0;
-        }
-        else if (hrp)
+        finally
         {
-            std::string msg = utf8_string(String::Format("Unexpected HTTP(s) result {0}: {1}", hrp->StatusCode, hrp->StatusDescription));
-            strncpy_s(out_error_string, error_string_max_size, msg.c_str(), error_string_max_size);
-            return 0;
+            delete rp;
         }
-        else if (rp)
+    }
+
+    // Checks the package against the hash in the nuget.org catalog, found via the registration of the package version
+    static bool Verify(HttpClient^ client, String^ spool)
+    {
+        using System::Text::RegularExpressions::Regex;
+        using System::Text::RegularExpressions::Match;
+
+        Match^ m = Regex::Match(client->GetStringAsync(RegistrationUrl)->GetAwaiter().GetResult(), "\"catalogEntry\"\\s*:\\s*\"([^\"]+)\"");
+
+        if (!m->Success)
+            return false;
+
+        String^ catalog = client->GetStringAsync(m->Groups[1]->Value)->GetAwaiter().GetResult();
+        Match^ alg = Regex::Match(catalog, "\"packageHashAlgorithm\"\\s*:\\s*\"([^\"]+)\"");
+        Match^ hash = Regex::Match(catalog, "\"packageHash\"\\s*:\\s*\"([^\"]+)\"");
+
+        if (!alg->Success || !hash->Success || !String::Equals(alg->Groups[1]->Value, "SHA512", StringComparison::OrdinalIgnoreCase))
+            return false;
+
+        array<unsigned char>^ actual;
+        auto sha = System::Security::Cryptography::SHA512::Create();
+        try
         {
-            std::string msg = utf8_string(String::Format("Unexpected WebResponse {0}", rp->ToString()));
-            strncpy_s(out_error_string, error_string_max_size, msg.c_str(), error_string_max_size);
-            return 0;
+            FileStream^ fs = gcnew FileStream(spool, FileMode::Open, FileAccess::Read, FileShare::Read, 64 * 1024);
+            try
+            {
+                actual = sha->ComputeHash(fs);
+            }
+            finally
+            {
+                delete fs;
+            }
         }
-        else
+        finally
         {
-            strncpy_s(out_error_string, error_string_max_size, "Http error (No HttpWebResponse/readrange)", error_string_max_size);
-            return 0;
+            delete sha;
         }
-    }
-    finally
-    {
-        if (rp)
-            delete rp;
-    }
-}
 
-void ProjContext::SetupNetworkHandling()
-{
-    proj_context_set_network_callbacks(
-        m_ctx,
-        my_network_open,
-        my_network_close,
-        my_network_get_header_value,
-        my_network_read_range,
-        &m_ctx);
-}
+        if (Convert::ToBase64String(actual) == hash->Groups[1]->Value)
+            return true;
 
-void ProjContext::DownloadProjDB(String^ target)
-{
-    using namespace System::IO::Compression;
-    WebResponse^ rp = nullptr;
-    try
+        // Corrupt, truncated or not the published package. Start over next time
+        File::Delete(spool);
+        File::Delete(spool + ".etag");
+        return false;
+    }
+
+    // Extracts proj.db from the verified package to a temporary file and then moves it in place
+    static bool Extract(String^ spool, String^ target)
     {
-        WebRequest^ wr = WebRequest::Create("https://www.nuget.org/api/v2/package/SharpProj.Database/" PROJ_VERSION);
-        rp = wr->GetResponse();
-        Stream^ stream = rp->GetResponseStream();
-        Stream^ sz = nullptr;
-        Stream^ tmp = nullptr;
+        using namespace System::IO::Compression;
+        String^ tmp = target + ".tmp";
+        bool ok = false;
+
         try
         {
-            auto za = gcnew System::IO::Compression::ZipArchive(stream, ZipArchiveMode::Read);
-
-            sz = za->GetEntry("contentFiles/any/any/proj.db")->Open();
-            tmp = File::Create(target + ".tmp");
+            FileStream^ zs = gcnew FileStream(spool, FileMode::Open, FileAccess::Read, FileShare::Read);
+            try
+            {
+                ZipArchive^ za = gcnew ZipArchive(zs, ZipArchiveMode::Read, true);
+                try
+                {
+                    ZipArchiveEntry^ entry = za->GetEntry(EntryName);
 
-            sz->CopyTo(tmp);
-            tmp->Close();
-            tmp = nullptr;
-            delete sz;
-            sz = nullptr;
+                    if (!entry)
+                        return false;
 
-            File::Move(target + ".tmp", target);
-        }
-        catch (Exception^)
-        {
-            if (tmp)
-                delete tmp;
-            if (sz)
-                delete sz;
-            if (stream)
-                delete stream;
+                    Stream^ sz = entry->Open();
+                    FileStream^ ts = File::Create(tmp);
+                    try
+                    {
+                        sz->CopyTo(ts, 64 * 1024);
+                    }
+                    finally
+                    {
+                        delete ts;
+                        delete sz;
+                    }
+                }
+                finally
+                {
+                    delete za;
+                }
+            }
+            finally
+            {
+                delete zs;
+            }
 
             try
             {
-                File::Delete(target + ".tmp");
+                File::Move(tmp, target);
             }
-            catch (Exception^)
+            catch (IOException^)
             {
+                // Another process won the race
+                if (!File::Exists(target))
+                    throw;
             }
+            ok = true;
         }
+        finally
+        {
+            if (!ok || File::Exists(tmp))
+            {
+                try
+                {
+                    File::Delete(tmp);
+                }
+                catch (IOException^)
+                {
+                }
+            }
+        }
+        return ok;
     }
-    catch (Exception^)
-    {
-        // Ignore all errors
-    }
-    finally
-    {
-        if (rp)
-            delete rp;
-    }
+};
 
+void ProjContext::DownloadProjDB(String^ target)
+{
+    ProjDBDownload::Download(target);
 }
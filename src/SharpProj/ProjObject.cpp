@@ -31,14 +31,18 @@ ProjObject::!ProjObject()
     if (_disposed)
         return;
     _disposed = true;
-    m_pj.Release();
+    m_pj.ReleaseDeferred(); // Finalizer thread: never call PROJ here
 }
 
 ProjObject::~ProjObject()
 {
     if (m_usageArea)
         m_usageArea->InternalDispose();
-    ProjObject::!ProjObject();
+
+    if (_disposed)
+        return;
+    _disposed = true;
+    m_pj.Release();
 }
 
 
@@ -47,7 +51,7 @@ ProjObject^ ProjContext::Create(String^ definition)
     if (String::IsNullOrWhiteSpace(definition))
         throw gcnew ArgumentNullException("definition");
 
-    std::string fromStr = utf8_string(definition);
+    ::utf8_string fromStr(definition);
     PJ* pj = proj_create(this, fromStr.c_str());
 
     if (!pj)
@@ -61,7 +65,7 @@ ProjObject^ ProjContext::CreateProj4Compatible(String^ definition)
     if (String::IsNullOrWhiteSpace(definition))
         throw gcnew ArgumentNullException("definition");
 
-    std::string fromStr = utf8_string(definition);
+    ::utf8_string fromStr(definition);
     bool wasProj4 = (0 != proj_context_get_use_proj4_init_rules(this, false));
 
     PJ* pj;
@@ -105,7 +109,7 @@ ProjObject^ ProjContext::Create(...array<String^>^ from)
     char** lst = new char* [from->Length + 1];
     for (int i = 0; i < from->Length; i++)
     {
-        std::string fromStr = utf8_string(from[i]);
+        ::utf8_string fromStr(from[i]);
         lst[i] = _strdup(fromStr.c_str());
     }
     lst[from->Length] = 0;
@@ -154,7 +158,7 @@ ProjObject^ ProjContext::CreateFromWellKnownText(String^ from, CreateFromWKTOpti
         }
     }
 
-    std::string fromStr = utf8_string(from);
+    ::utf8_string fromStr(from);
     PJ* pj = proj_create_from_wkt(this, fromStr.c_str(), c_options, &wrs, &errs);
 
     warnings = ProjObject::FromStringList(wrs);
@@ -191,6 +195,8 @@ ProjObject^ ProjContext::Create(PJ* pj)
     if (!pj)
         throw gcnew ArgumentNullException("pj");
 
+    Flush();
+
     switch ((ProjType)proj_get_type(pj))
     {
     case ProjType::Ellipsoid:
@@ -76,6 +76,7 @@ namespace SharpProj {
             // Local types
             ChooseTransform = 1001,
             CoordinateSystem,
+            ChainedTransform,
 
             Crs = CoordinateReferenceSystem,
             [ObsoleteAttribute]
@@ -208,6 +209,12 @@ namespace SharpProj {
             !ProjObject();
 
         private protected:
+            // Destroys item on the thread owning the context. For use by finalizers
+            void DeferDestroy(void* item, deferred_destroy destroy)
+            {
+                m_pj.Defer(item, destroy);
+            }
+
             void ForceUnknownInfo()
             {
                 m_noProj = true;
@@ -52,8 +52,45 @@ using namespace System;
 using namespace SharpProj;
 using namespace SharpProj::Proj;
 
-#include <string>
-std::string utf8_string(String^ v);
+#include <stdlib.h>
+
+// Encodes a managed string as zero terminated UTF-8. Short strings (the common case for definitions,
+// authorities, codes and header values) are encoded in an inline buffer, so placing this on the stack
+// avoids heap allocations. A nullptr string is encoded as "".
+class utf8_string
+{
+    char m_buf[256];
+    char* m_str;
+    size_t m_len;
+
+public:
+    explicit utf8_string(String^ v);
+    ~utf8_string()
+    {
+        if (m_str != m_buf)
+            free(m_str);
+    }
+
+    __inline const char* c_str() const
+    {
+        return m_str;
+    }
+
+    __inline size_t length() const
+    {
+        return m_len;
+    }
+
+private:
+    utf8_string(const utf8_string&) = delete;
+    utf8_string& operator=(const utf8_string&) = delete;
+};
+
+// Encodes v as UTF-8 in dest (of dest_size bytes, including the terminating zero), truncating at
+// a character boundary if necessary. Returns the number of bytes written, excluding the zero.
+size_t utf8_encode(String^ v, char* dest, size_t dest_size);
+// Returns the number of bytes needed to hold the UTF-8 representation of a string of len UTF-16 units.
+__inline size_t utf8_max_size(size_t len) { return len * 3 + 1; }
 
 using System::Runtime::InteropServices::OutAttribute;
 using System::Runtime::InteropServices::OptionalAttribute;